@@ -0,0 +1,279 @@
+//CONTENT-ADDRESSED ARTIFACT STORE
+//
+// Artifacts (cryptocontexts, keys, ciphertexts) are stored once under the
+// SHA-256 of their serialized bytes; jobs and reusable keysets only hold
+// references to them:
+//
+//   store/objects/ab/ab12...ef    immutable object, named by its hash
+//   store/jobs/<job>              "name hash size" per line
+//   store/keysets/<name>          same format, shared by many jobs
+//
+// Putting bytes that are already stored writes nothing. Objects no job or
+// keyset refers to any more are removed by `fhe-store gc`.
+
+#ifndef FHE_ARTIFACT_STORE_H
+#define FHE_ARTIFACT_STORE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "async-io.h"
+
+// Minimal SHA-256 (FIPS 180-4), enough to name objects.
+class Sha256 {
+public:
+    Sha256() { reset(); }
+
+    void reset() {
+        static const uint32_t init[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                         0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        std::memcpy(h_, init, sizeof(h_));
+        len_ = 0;
+        used_ = 0;
+    }
+
+    void update(const void* data, size_t n) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        len_ += n;
+        if (used_ > 0) {
+            size_t take = std::min(n, sizeof(block_) - used_);
+            std::memcpy(block_ + used_, p, take);
+            used_ += take;
+            p += take;
+            n -= take;
+            if (used_ < sizeof(block_)) return;
+            compress(block_);
+            used_ = 0;
+        }
+        for (; n >= 64; p += 64, n -= 64) compress(p);
+        std::memcpy(block_, p, n);
+        used_ = n;
+    }
+
+    std::string hex() {
+        uint64_t bits = len_ * 8;
+        uint8_t pad = 0x80;
+        update(&pad, 1);
+        uint8_t zero = 0;
+        while (used_ != 56) update(&zero, 1);
+        uint8_t be[8];
+        for (int i = 0; i < 8; i++) be[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+        update(be, 8);
+
+        static const char digits[] = "0123456789abcdef";
+        std::string out(64, '0');
+        for (int i = 0; i < 8; i++)
+            for (int j = 0; j < 8; j++) out[i * 8 + j] = digits[(h_[i] >> (28 - 4 * j)) & 0xf];
+        reset();
+        return out;
+    }
+
+    static std::string of(const std::string& data) {
+        Sha256 s;
+        s.update(data.data(), data.size());
+        return s.hex();
+    }
+
+private:
+    static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    void compress(const uint8_t* p) {
+        static const uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++)
+            w[i] = uint32_t(p[4 * i]) << 24 | uint32_t(p[4 * i + 1]) << 16 | uint32_t(p[4 * i + 2]) << 8 | p[4 * i + 3];
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = h_[0], b = h_[1], c = h_[2], d = h_[3], e = h_[4], f = h_[5], g = h_[6], h = h_[7];
+        for (int i = 0; i < 64; i++) {
+            uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        h_[0] += a; h_[1] += b; h_[2] += c; h_[3] += d;
+        h_[4] += e; h_[5] += f; h_[6] += g; h_[7] += h;
+    }
+
+    uint32_t h_[8];
+    uint8_t block_[64];
+    size_t used_;
+    uint64_t len_;
+};
+
+// Named references to stored objects (one job or keyset).
+struct ArtifactRefs {
+    struct Ref {
+        std::string hash;
+        uint64_t size = 0;
+    };
+    std::map<std::string, Ref> refs;
+
+    bool has(const std::string& name) const { return refs.count(name) != 0; }
+    const std::string& hash(const std::string& name) const { return refs.at(name).hash; }
+    void set(const std::string& name, const std::string& hash, uint64_t size) { refs[name] = {hash, size}; }
+
+    std::string text() const {
+        std::ostringstream out;
+        for (const auto& [name, ref] : refs) out << name << " " << ref.hash << " " << ref.size << "\n";
+        return out.str();
+    }
+
+    static bool parse(std::istream& in, ArtifactRefs& out) {
+        ArtifactRefs r;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty()) continue;
+            std::istringstream iss(line);
+            std::string name;
+            Ref ref;
+            if (!(iss >> name >> ref.hash >> ref.size) || ref.hash.size() != 64) return false;
+            r.refs[name] = ref;
+        }
+        out = std::move(r);
+        return true;
+    }
+};
+
+class ArtifactStore {
+public:
+    explicit ArtifactStore(AsyncIO& io, std::string root = "store") : io_(io), root_(std::move(root)) {
+        makeDir(root_);
+        makeDir(root_ + "/objects");
+        makeDir(root_ + "/jobs");
+        makeDir(root_ + "/keysets");
+    }
+
+    const std::string& root() const { return root_; }
+
+    std::string objectPath(const std::string& hash) const {
+        return root_ + "/objects/" + hash.substr(0, 2) + "/" + hash;
+    }
+
+    bool contains(const std::string& hash) const {
+        struct stat st;
+        return ::stat(objectPath(hash).c_str(), &st) == 0;
+    }
+
+    // Store `bytes` unless an identical object exists; returns its hash. New
+    // objects are written under a temporary name and only become visible in
+    // publish(), after the writer has drained.
+    std::string put(std::string bytes) {
+        std::string hash = Sha256::of(bytes);
+        uint64_t size = bytes.size();
+        if (contains(hash) || pendingHashes_.count(hash)) {
+            // Refresh the object's age so gc's grace period covers the job
+            // that is about to refer to it
+            ::utimensat(AT_FDCWD, objectPath(hash).c_str(), nullptr, 0);
+            dedupHits_++;
+            dedupBytes_ += size;
+            return hash;
+        }
+        std::string path = objectPath(hash);
+        makeDir(root_ + "/objects/" + hash.substr(0, 2));
+        std::string tmp = path + ".tmp." + std::to_string(::getpid());
+        if (!io_.write(tmp, std::move(bytes))) return std::string();
+        pending_.emplace_back(tmp, path);
+        pendingHashes_[hash] = size;
+        objectsWritten_++;
+        return hash;
+    }
+
+    // Issue an asynchronous read of a stored object.
+    std::shared_future<std::string> get(const std::string& hash) { return io_.read(objectPath(hash)); }
+
+    // Make the objects written since the last call visible. Call after io.drain().
+    bool publish() {
+        bool ok = true;
+        for (const auto& [tmp, path] : pending_) {
+            if (std::rename(tmp.c_str(), path.c_str()) != 0) ok = false;
+        }
+        pending_.clear();
+        pendingHashes_.clear();
+        return ok;
+    }
+
+    // Job and keyset names become file names
+    static bool validName(const std::string& name) {
+        return !name.empty() && name[0] != '.' && name.find('/') == std::string::npos;
+    }
+
+    bool readRefs(const std::string& kind, const std::string& name, ArtifactRefs& out) const {
+        if (!validName(name)) return false;
+        std::ifstream in(refsPath(kind, name));
+        return in.is_open() && ArtifactRefs::parse(in, out);
+    }
+
+    // Reference files are small and written synchronously, after the objects
+    // they point to have been published.
+    bool writeRefs(const std::string& kind, const std::string& name, const ArtifactRefs& refs) const {
+        if (!validName(name)) return false;
+        std::string path = refsPath(kind, name);
+        std::string tmp = path + ".tmp." + std::to_string(::getpid());
+        {
+            std::ofstream out(tmp, std::ios::trunc);
+            if (!out.is_open()) return false;
+            out << refs.text();
+            if (!out.good()) return false;
+        }
+        return std::rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+    uint64_t dedupHits() const { return dedupHits_; }
+    uint64_t dedupBytes() const { return dedupBytes_; }
+    uint64_t objectsWritten() const { return objectsWritten_; }
+
+private:
+    std::string refsPath(const std::string& kind, const std::string& name) const {
+        return root_ + "/" + kind + "/" + name;
+    }
+
+    static void makeDir(const std::string& path) { ::mkdir(path.c_str(), 0755); }
+
+    AsyncIO& io_;
+    std::string root_;
+    std::vector<std::pair<std::string, std::string>> pending_;
+    std::map<std::string, uint64_t> pendingHashes_;
+    uint64_t dedupHits_ = 0;
+    uint64_t dedupBytes_ = 0;
+    uint64_t objectsWritten_ = 0;
+};
+
+template <typename T>
+std::string serializeToBytes(const T& obj) {
+    BufferStream out;
+    lbcrypto::Serial::Serialize(obj, out, lbcrypto::SerType::BINARY);
+    if (!out) return std::string();
+    return out.take();
+}
+
+// Secret keys never enter the shared store; they stay on the private volume,
+// named after the public key they belong to.
+inline std::string privateKeyPath(const std::string& privateFolder, const std::string& publicKeyHash) {
+    return privateFolder + "/key-private-" + publicKeyHash.substr(0, 16) + ".txt";
+}
+
+#endif // FHE_ARTIFACT_STORE_H
@@ -0,0 +1,451 @@
+//MICRO-BENCHMARKS OF THE FHE PRIMITIVES (GOOGLE BENCHMARK)
+//
+// Times each OpenFHE operation used by fhe-enc, fhe-main and fhe-dec on its
+// own, for every (depth, modulus, security) triple of the test grid:
+//
+//   ./fhe-bench [--grid tests.csv] [--benchmark_* options]
+//
+// Benchmarks are named <operation>/d<depth>/m<modulus>/s<security>, so
+// --benchmark_filter can select an operation or a parameter set. Unless given
+// on the command line, every benchmark is repeated 5 times (mean, median,
+// stddev and cv are reported) and the results are also written to
+// bench_results.json.
+//
+// WideCircuitSerial and WideCircuitStealing evaluate the same circuit of
+// --width independent chains of EvalMults (one per level of the parameter
+// set) summed by EvalAdds: first as the plain loop fhe-main used to run, then
+// on fhe-main's work-stealing runtime with --workers workers.
+//
+// EvalMultChain runs fhe-main's chain of EvalMults and reports, besides the
+// time, the resident set against the live heap: rss_mb - heap_mb (frag_mb) is
+// what the allocator holds without handing it out. Run it once per FHE_POOL
+// setting (off, thp, hugetlb; see buffer-pool.h) to compare the allocators.
+//
+// ProfiledChain and UnprofiledChain run that chain with an FHE_SPAN around
+// every EvalMult, as fhe-main does, with span recording on and off: their
+// difference is what profiling costs (--benchmark_filter=ProfiledChain; add
+// FHE_PROFILE_COUNTERS=1 to include the hardware counters).
+
+#include "openfhe.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// header files needed for serialization
+#include "ciphertext-ser.h"
+#include "cryptocontext-ser.h"
+#include "key/key-ser.h"
+#include "scheme/bgvrns/bgvrns-ser.h"
+
+#include "memory-stats.h"
+#include "memory-stream.h"
+#include "param-grid.h"
+#include "profiling.h"
+#include "task-runtime.h"
+
+using namespace lbcrypto;
+
+const std::string GRIDFILE = "tests.csv";
+const std::string RESULTSFILE = "bench_results.json";
+const int REPETITIONS = 5;
+const int CIRCUIT_WIDTH = 8;
+
+template <typename T>
+std::string serialize(const T& obj) {
+    BufferStream out;
+    Serial::Serialize(obj, out, SerType::BINARY);
+    return out.take();
+}
+
+// Everything the operation benchmarks need for one parameter set, built
+// outside the timed loops. Benchmarks run grouped by parameter set, so only
+// the current one is kept alive.
+struct Fixture {
+    GridParams params;
+    CryptoContext<DCRTPoly> cc;
+    KeyPair<DCRTPoly> keys;
+    Plaintext plaintext;
+    Ciphertext<DCRTPoly> ct1;
+    Ciphertext<DCRTPoly> ct2;
+    Ciphertext<DCRTPoly> product;  // ct1 * ct2 before relinearization
+
+    std::string ccBytes;
+    std::string publicKeyBytes;
+    std::string privateKeyBytes;
+    std::string multKeyBytes;
+    std::string rotationKeyBytes;
+    std::string ciphertextBytes;
+};
+
+Fixture& fixture(const GridParams& p) {
+    static std::unique_ptr<Fixture> current;
+    if (current && current->params == p) return *current;
+
+    current.reset();
+    CryptoContextImpl<DCRTPoly>::ClearEvalMultKeys();
+    CryptoContextImpl<DCRTPoly>::ClearEvalAutomorphismKeys();
+    CryptoContextFactory<DCRTPoly>::ReleaseAllContexts();
+
+    auto f = std::make_unique<Fixture>();
+    f->params = p;
+    f->cc = generateContext(p);
+    f->keys = f->cc->KeyGen();
+    f->cc->EvalMultKeyGen(f->keys.secretKey);
+    f->cc->EvalRotateKeyGen(f->keys.secretKey, {1});
+
+    // Fill every slot, as a full batch is the worst case for every operation
+    std::vector<int64_t> values(f->cc->GetRingDimension());
+    for (size_t i = 0; i < values.size(); i++) values[i] = static_cast<int64_t>(i % 256);
+    f->plaintext = f->cc->MakePackedPlaintext(values);
+    f->ct1 = f->cc->Encrypt(f->keys.publicKey, f->plaintext);
+    f->ct2 = f->cc->Encrypt(f->keys.publicKey, f->plaintext);
+    f->product = f->cc->EvalMultNoRelin(f->ct1, f->ct2);
+
+    f->ccBytes = serialize(f->cc);
+    f->publicKeyBytes = serialize(f->keys.publicKey);
+    f->privateKeyBytes = serialize(f->keys.secretKey);
+    f->ciphertextBytes = serialize(f->ct1);
+    BufferStream multKeys;
+    CryptoContextImpl<DCRTPoly>::SerializeEvalMultKey(multKeys, SerType::BINARY);
+    f->multKeyBytes = multKeys.take();
+    BufferStream rotationKeys;
+    CryptoContextImpl<DCRTPoly>::SerializeEvalAutomorphismKey(rotationKeys, SerType::BINARY);
+    f->rotationKeyBytes = rotationKeys.take();
+
+    current = std::move(f);
+    return *current;
+}
+
+/////////////////////////////////////////////
+//              OPERATIONS                 //
+/////////////////////////////////////////////
+
+void BM_GenCryptoContext(benchmark::State& state, GridParams p) {
+    fixture(p);
+    for (auto _ : state) {
+        // OpenFHE hands back a cached context for known parameters
+        state.PauseTiming();
+        CryptoContextFactory<DCRTPoly>::ReleaseAllContexts();
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(generateContext(p));
+    }
+}
+
+void BM_KeyGen(benchmark::State& state, GridParams p) {
+    Fixture& f = fixture(p);
+    for (auto _ : state) benchmark::DoNotOptimize(f.cc->KeyGen());
+}
+
+void BM_EvalMultKeyGen(benchmark::State& state, GridParams p) {
+    Fixture& f = fixture(p);
+    for (auto _ : state) f.cc->EvalMultKeyGen(f.keys.secretKey);
+}
+
+void BM_EvalRotateKeyGen(benchmark::State& state, GridParams p) {
+    Fixture& f = fixture(p);
+    for (auto _ : state) f.cc->EvalRotateKeyGen(f.keys.secretKey, {1});
+}
+
+void BM_Encrypt(benchmark::State& state, GridParams p) {
+    Fixture& f = fixture(p);
+    for (auto _ : state) benchmark::DoNotOptimize(f.cc->Encrypt(f.keys.publicKey, f.plaintext));
+}
+
+void BM_EvalMult(benchmark::State& state, GridParams p) {
+    Fixture& f = fixture(p);
+    for (auto _ : state) benchmark::DoNotOptimize(f.cc->EvalMult(f.ct1, f.ct2));
+}
+
+void BM_EvalMultNoRelin(benchmark::State& state, GridParams p) {
+    Fixture& f = fixture(p);
+    for (auto _ : state) benchmark::DoNotOptimize(f.cc->EvalMultNoRelin(f.ct1, f.ct2));
+}
+
+void BM_Relinearize(benchmark::State& state, GridParams p) {
+    Fixture& f = fixture(p);
+    for (auto _ : state) benchmark::DoNotOptimize(f.cc->Relinearize(f.product));
+}
+
+void BM_EvalRotate(benchmark::State& state, GridParams p) {
+    Fixture& f = fixture(p);
+    for (auto _ : state) benchmark::DoNotOptimize(f.cc->EvalRotate(f.ct1, 1));
+}
+
+void BM_Decrypt(benchmark::State& state, GridParams p) {
+    Fixture& f = fixture(p);
+    Plaintext result;
+    for (auto _ : state) benchmark::DoNotOptimize(f.cc->Decrypt(f.keys.secretKey, f.ct1, &result));
+}
+
+/////////////////////////////////////////////
+//               CIRCUITS                  //
+/////////////////////////////////////////////
+
+void BM_WideCircuitSerial(benchmark::State& state, GridParams p, int width) {
+    Fixture& f = fixture(p);
+    std::vector<Ciphertext<DCRTPoly>> lanes(width);
+    for (auto _ : state) {
+        for (int l = 0; l < width; l++) {
+            lanes[l] = f.ct1;
+            for (int i = 0; i < p.depth; i++) lanes[l] = f.cc->EvalMult(lanes[l], f.ct2);
+        }
+        for (int l = 1; l < width; l++) lanes[0] = f.cc->EvalAdd(lanes[0], lanes[l]);
+        benchmark::DoNotOptimize(lanes[0]);
+    }
+    state.counters["width"] = width;
+}
+
+void BM_WideCircuitStealing(benchmark::State& state, GridParams p, int width, unsigned workers) {
+    Fixture& f = fixture(p);
+    std::vector<Ciphertext<DCRTPoly>> lanes(width);
+    TaskGraph circuit;
+    std::vector<std::vector<size_t>> laneDone(width);
+    for (int l = 0; l < width; l++) {
+        for (int i = 0; i < p.depth; i++) {
+            laneDone[l] = {circuit.add([&, l] { lanes[l] = f.cc->EvalMult(lanes[l], f.ct2); }, laneDone[l])};
+        }
+    }
+    for (int step = 1; step < width; step *= 2) {
+        for (int l = 0; l + step < width; l += 2 * step) {
+            std::vector<size_t> operands = laneDone[l];
+            operands.insert(operands.end(), laneDone[l + step].begin(), laneDone[l + step].end());
+            laneDone[l] = {circuit.add([&, l, step] { lanes[l] = f.cc->EvalAdd(lanes[l], lanes[l + step]); }, operands)};
+        }
+    }
+
+    TaskRuntime runtime(workers);
+    for (auto _ : state) {
+        std::fill(lanes.begin(), lanes.end(), f.ct1);
+        runtime.run(circuit);
+        benchmark::DoNotOptimize(lanes[0]);
+    }
+    state.counters["width"] = width;
+    state.counters["workers"] = runtime.workers();
+    state.counters["inner_threads"] = runtime.innerThreads();
+}
+
+void BM_EvalMultChain(benchmark::State& state, GridParams p) {
+    Fixture& f = fixture(p);
+    Ciphertext<DCRTPoly> result;
+    for (auto _ : state) {
+        result = f.ct1;
+        for (int i = 0; i < p.depth; i++) result = f.cc->EvalMult(result, f.ct2);
+        benchmark::DoNotOptimize(result);
+    }
+    // Measured with the last chain's product still live, as fhe-main holds it
+    uint64_t rss = mem::residentBytes().second;
+    uint64_t heap = mem::liveBytes.load();
+    const mem::BufferPool& pool = mem::BufferPool::instance();
+    state.counters["rss_mb"] = mem::megabytes(rss);
+    state.counters["heap_mb"] = mem::megabytes(heap);
+    state.counters["frag_mb"] = mem::megabytes(rss > heap ? rss - heap : 0);
+    state.counters["pool_mb"] = mem::megabytes(pool.committedBytes());
+    state.counters["pool_reuse"] = pool.reuseRate();
+}
+
+void BM_SpanChain(benchmark::State& state, GridParams p, bool profiled) {
+    Fixture& f = fixture(p);
+    bool wasProfiling = prof::enabled();
+    prof::setEnabled(profiled);
+    Ciphertext<DCRTPoly> result;
+    for (auto _ : state) {
+        FHE_SPAN("computation");
+        result = f.ct1;
+        for (int i = 0; i < p.depth; i++) {
+            FHE_SPAN("EvalMult");
+            result = f.cc->EvalMult(result, f.ct2);
+        }
+        benchmark::DoNotOptimize(result);
+    }
+    prof::setEnabled(wasProfiling);
+    state.counters["profiled"] = profiled;
+}
+
+void registerCircuits(const GridParams& p, int width, unsigned workers) {
+    benchmark::RegisterBenchmark(("EvalMultChain" + p.suffix()).c_str(), BM_EvalMultChain, p)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    benchmark::RegisterBenchmark(("ProfiledChain" + p.suffix()).c_str(), BM_SpanChain, p, true)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    benchmark::RegisterBenchmark(("UnprofiledChain" + p.suffix()).c_str(), BM_SpanChain, p, false)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    benchmark::RegisterBenchmark(("WideCircuitSerial" + p.suffix()).c_str(), BM_WideCircuitSerial, p, width)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    benchmark::RegisterBenchmark(("WideCircuitStealing" + p.suffix()).c_str(), BM_WideCircuitStealing, p, width,
+                                 workers)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+}
+
+/////////////////////////////////////////////
+//             SERIALIZATION               //
+/////////////////////////////////////////////
+
+// Serialize and deserialize one artifact. `bytes` selects the fixture's
+// serialized form, `save` writes the artifact and `load` reads it back.
+template <typename Save, typename Load>
+void registerArtifact(const std::string& artifact, const GridParams& p, std::string Fixture::*bytes,
+                      Save save, Load load) {
+    benchmark::RegisterBenchmark(("Serialize" + artifact + p.suffix()).c_str(),
+        [p, bytes, save](benchmark::State& state) {
+            Fixture& f = fixture(p);
+            for (auto _ : state) {
+                BufferStream out;
+                save(f, out);
+                benchmark::DoNotOptimize(out.size());
+            }
+            state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * (f.*bytes).size()));
+            state.counters["bytes"] = static_cast<double>((f.*bytes).size());
+        })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+    benchmark::RegisterBenchmark(("Deserialize" + artifact + p.suffix()).c_str(),
+        [p, bytes, load](benchmark::State& state) {
+            Fixture& f = fixture(p);
+            for (auto _ : state) {
+                MemoryStream in(f.*bytes);
+                load(f, in);
+            }
+            state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * (f.*bytes).size()));
+            state.counters["bytes"] = static_cast<double>((f.*bytes).size());
+        })->Unit(benchmark::kMillisecond)->UseRealTime();
+}
+
+void registerSerialization(const GridParams& p) {
+    registerArtifact("CryptoContext", p, &Fixture::ccBytes,
+        [](Fixture& f, std::ostream& out) { Serial::Serialize(f.cc, out, SerType::BINARY); },
+        [](Fixture&, std::istream& in) {
+            // Like GenCryptoContext, deserialization would return the cached context
+            CryptoContextFactory<DCRTPoly>::ReleaseAllContexts();
+            CryptoContext<DCRTPoly> cc;
+            Serial::Deserialize(cc, in, SerType::BINARY);
+            benchmark::DoNotOptimize(cc);
+        });
+    registerArtifact("PublicKey", p, &Fixture::publicKeyBytes,
+        [](Fixture& f, std::ostream& out) { Serial::Serialize(f.keys.publicKey, out, SerType::BINARY); },
+        [](Fixture&, std::istream& in) {
+            PublicKey<DCRTPoly> pk;
+            Serial::Deserialize(pk, in, SerType::BINARY);
+            benchmark::DoNotOptimize(pk);
+        });
+    registerArtifact("PrivateKey", p, &Fixture::privateKeyBytes,
+        [](Fixture& f, std::ostream& out) { Serial::Serialize(f.keys.secretKey, out, SerType::BINARY); },
+        [](Fixture&, std::istream& in) {
+            PrivateKey<DCRTPoly> sk;
+            Serial::Deserialize(sk, in, SerType::BINARY);
+            benchmark::DoNotOptimize(sk);
+        });
+    registerArtifact("EvalMultKey", p, &Fixture::multKeyBytes,
+        [](Fixture&, std::ostream& out) { CryptoContextImpl<DCRTPoly>::SerializeEvalMultKey(out, SerType::BINARY); },
+        [](Fixture&, std::istream& in) { CryptoContextImpl<DCRTPoly>::DeserializeEvalMultKey(in, SerType::BINARY); });
+    registerArtifact("EvalRotateKey", p, &Fixture::rotationKeyBytes,
+        [](Fixture&, std::ostream& out) { CryptoContextImpl<DCRTPoly>::SerializeEvalAutomorphismKey(out, SerType::BINARY); },
+        [](Fixture&, std::istream& in) { CryptoContextImpl<DCRTPoly>::DeserializeEvalAutomorphismKey(in, SerType::BINARY); });
+    registerArtifact("Ciphertext", p, &Fixture::ciphertextBytes,
+        [](Fixture& f, std::ostream& out) { Serial::Serialize(f.ct1, out, SerType::BINARY); },
+        [](Fixture&, std::istream& in) {
+            Ciphertext<DCRTPoly> ct;
+            Serial::Deserialize(ct, in, SerType::BINARY);
+            benchmark::DoNotOptimize(ct);
+        });
+}
+
+void registerOperations(const GridParams& p) {
+    const std::pair<const char*, void (*)(benchmark::State&, GridParams)> operations[] = {
+        {"GenCryptoContext", BM_GenCryptoContext},
+        {"KeyGen", BM_KeyGen},
+        {"EvalMultKeyGen", BM_EvalMultKeyGen},
+        {"EvalRotateKeyGen", BM_EvalRotateKeyGen},
+        {"Encrypt", BM_Encrypt},
+        {"EvalMult", BM_EvalMult},
+        {"EvalMultNoRelin", BM_EvalMultNoRelin},
+        {"Relinearize", BM_Relinearize},
+        {"EvalRotate", BM_EvalRotate},
+        {"Decrypt", BM_Decrypt},
+    };
+    for (const auto& [name, fn] : operations) {
+        benchmark::RegisterBenchmark((name + p.suffix()).c_str(), fn, p)
+            ->Unit(benchmark::kMillisecond)
+            ->UseRealTime();
+    }
+}
+
+bool hasFlag(const std::vector<char*>& args, const char* flag) {
+    size_t n = std::strlen(flag);
+    for (const char* arg : args) {
+        if (std::strncmp(arg, flag, n) == 0 && (arg[n] == '=' || arg[n] == '\0')) return true;
+    }
+    return false;
+}
+
+/////////////////////////////////////////////
+//                                         //
+//               |MAIN|                    //
+//                                         //
+/////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+    std::string gridFile = GRIDFILE;
+    int width = CIRCUIT_WIDTH;
+    unsigned workers = 0;
+
+    // Our own options first; everything else goes to Google Benchmark
+    std::vector<char*> args = {argv[0]};
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--grid" && i + 1 < argc) {
+            gridFile = argv[++i];
+        } else if (arg == "--width" && i + 1 < argc) {
+            width = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--workers" && i + 1 < argc) {
+            workers = static_cast<unsigned>(std::max(1, std::stoi(argv[++i])));
+        } else if (arg == "--help") {
+            std::cout << "Usage: " << argv[0] << " [OPTIONS] [--benchmark_* options]\n"
+                      << "Options:\n"
+                      << "  --grid FILE     Parameter grid with depth, modulus and security columns (default: tests.csv)\n"
+                      << "  --width W       Independent chains in the WideCircuit benchmarks (default: " << CIRCUIT_WIDTH << ")\n"
+                      << "  --workers N     Workers of WideCircuitStealing (default: min(width, cores))\n"
+                      << "Defaults passed to Google Benchmark unless overridden:\n"
+                      << "  --benchmark_repetitions=" << REPETITIONS << "\n"
+                      << "  --benchmark_out=" << RESULTSFILE << " --benchmark_out_format=json\n";
+            return 0;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+
+    std::vector<std::string> defaults;
+    if (!hasFlag(args, "--benchmark_repetitions")) defaults.push_back("--benchmark_repetitions=" + std::to_string(REPETITIONS));
+    if (!hasFlag(args, "--benchmark_out")) {
+        defaults.push_back("--benchmark_out=" + RESULTSFILE);
+        if (!hasFlag(args, "--benchmark_out_format")) defaults.push_back("--benchmark_out_format=json");
+    }
+    for (auto& d : defaults) args.push_back(&d[0]);
+
+    std::vector<GridParams> grid = loadGrid(gridFile);
+    if (grid.empty()) return 1;
+    if (workers == 0) workers = static_cast<unsigned>(std::min(width, availableCores()));
+    for (const GridParams& p : grid) {
+        registerOperations(p);
+        registerSerialization(p);
+        registerCircuits(p, width, workers);
+    }
+    std::cout << "Benchmarking " << grid.size() << " parameter sets from " << gridFile << std::endl;
+
+    int benchArgc = static_cast<int>(args.size());
+    benchmark::Initialize(&benchArgc, args.data());
+    if (benchmark::ReportUnrecognizedArguments(benchArgc, args.data())) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
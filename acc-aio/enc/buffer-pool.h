@@ -0,0 +1,298 @@
+//POOLED, HUGE-PAGE-BACKED ALLOCATOR FOR LARGE BUFFERS
+//
+// Every EvalMult allocates fresh tower buffers (ring dimension * 8 bytes each,
+// 512 KB at 65536) and frees its inputs' ones: megabytes of malloc/munmap
+// churn per operation, each new buffer faulted in 4 KB page by 4 KB page.
+// BufferPool recycles them instead. Blocks of MIN_BYTES and more are carved
+// from one reserved arena in size classes four per power of two (at most 25%
+// rounding), and a freed block goes on its class's free list for the next
+// allocation of that class. Address space is never returned: the arena only
+// grows, to the high-water mark of the process, and a block freed in one class
+// cannot serve another. What trim() gives back is the memory behind the free
+// blocks (MADV_DONTNEED), so a long-lived process that frees a lot at once,
+// such as fhe-main --serve evicting a tenant, can shrink its RSS again.
+//
+// The arena is committed 2 MB at a time and backed by huge pages:
+//
+//   FHE_POOL=thp       transparent huge pages (madvise MADV_HUGEPAGE); default,
+//                      except in fhe-main --serve, which turns the pool off
+//                      unless FHE_POOL is set
+//   FHE_POOL=hugetlb   explicit 2 MB pages (MAP_HUGETLB): the pages free in the
+//                      kernel's reserved pool at startup (vm.nr_hugepages) are
+//                      mapped up front and used first, then THP
+//   FHE_POOL=off       no pooling: every buffer comes from malloc
+//   FHE_POOL_RESERVE_MB=N   address space to reserve (default: a quarter of
+//                           physical memory); larger requests go to malloc
+//   FHE_POOL_HUGETLB_MB=N   cap on the explicit huge pages taken
+//
+// Where the reservation fails (e.g. inside an SGX enclave) the pool stays off.
+// memory-stats.h routes the replacement operator new/delete through it.
+
+#ifndef FHE_BUFFER_POOL_H
+#define FHE_BUFFER_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace mem {
+
+class BufferPool {
+public:
+    static constexpr size_t MIN_BYTES = size_t(1) << 16;   // smaller blocks stay with malloc
+    static constexpr size_t MAX_BYTES = size_t(1) << 30;   // larger ones too
+    static constexpr size_t GRANULE = size_t(2) << 20;     // one huge page
+    static constexpr size_t MAX_ALIGN = size_t(1) << 14;   // every class size is a multiple of it
+    static constexpr int CLASSES = 4 * (30 - 16) + 1;
+
+    enum class Mode { Off, Thp, HugeTlb };
+
+    // Built on first use, from the first allocation large enough to be pooled
+    static BufferPool& instance() {
+        static BufferPool pool;
+        return pool;
+    }
+
+    Mode mode() const { return mode_.load(std::memory_order_relaxed); }
+
+    const char* modeName() const {
+        switch (mode()) {
+            case Mode::Thp: return "thp";
+            case Mode::HugeTlb: return "hugetlb";
+            default: return "off";
+        }
+    }
+
+    static bool pooled(size_t size) { return size >= MIN_BYTES && size <= MAX_BYTES; }
+
+    bool owns(const void* p) const {
+        auto a = reinterpret_cast<uintptr_t>(p);
+        return (a >= base_ && a < base_ + reserved_) || (a >= hugeBase_ && a < hugeBase_ + hugeBytes_);
+    }
+
+    // A block of at least `size` bytes, or nullptr if the pool cannot serve it
+    void* allocate(size_t size, size_t& blockBytes) {
+        if (mode() == Mode::Off || !pooled(size)) return nullptr;
+        int c = classOf(size);
+        blockBytes = classBytes(c);
+        FreeList& list = lists_[c];
+        {
+            std::lock_guard<std::mutex> lock(list.mutex);
+            if (list.head) {
+                Block* b = list.head;
+                list.head = b->next;
+                reused_.fetch_add(1, std::memory_order_relaxed);
+                return b;
+            }
+        }
+        return carve(c);
+    }
+
+    // Return a block owns() vouched for; its size in bytes
+    size_t release(void* p) {
+        int c = granuleClass_[granuleOf(reinterpret_cast<uintptr_t>(p))];
+        FreeList& list = lists_[c];
+        std::lock_guard<std::mutex> lock(list.mutex);
+        Block* b = static_cast<Block*>(p);
+        b->next = list.head;
+        list.head = b;
+        return classBytes(c);
+    }
+
+    // Serve no new blocks; the ones handed out still come back through release()
+    void disable() { mode_.store(Mode::Off, std::memory_order_relaxed); }
+
+    // Give the memory behind every free block back to the kernel, except its
+    // first page, which holds the free-list link. The blocks stay on their
+    // lists and fault back in zeroed when reused. Explicit huge pages are kept:
+    // they are reserved for the process either way. Bytes advised away.
+    uint64_t trim() {
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        uint64_t released = 0;
+        for (int c = 0; c < CLASSES; c++) {
+            size_t bytes = classBytes(c);
+            FreeList& list = lists_[c];
+            std::lock_guard<std::mutex> lock(list.mutex);
+            for (Block* b = list.head; b; b = b->next) {
+                auto a = reinterpret_cast<uintptr_t>(b);
+                if (a >= hugeBase_ && a < hugeBase_ + hugeBytes_) continue;
+                if (madvise(reinterpret_cast<void*>(a + page), bytes - page, MADV_DONTNEED) == 0) released += bytes - page;
+            }
+        }
+        return released;
+    }
+
+    uint64_t committedBytes() const { return committed_.load(std::memory_order_relaxed); }
+    uint64_t hugeTlbBytes() const { return hugeTlb_.load(std::memory_order_relaxed); }
+    uint64_t reused() const { return reused_.load(std::memory_order_relaxed); }
+    uint64_t carved() const { return carved_.load(std::memory_order_relaxed); }
+
+    double reuseRate() const {
+        uint64_t total = reused() + carved();
+        return total ? static_cast<double>(reused()) / total : 0;
+    }
+
+    // Size classes: 64 KB * 2^(c/4) * (4 + c%4) / 4
+    static size_t classBytes(int c) { return (MIN_BYTES << (c / 4)) / 4 * (4 + c % 4); }
+
+    static int classOf(size_t size) {
+        if (size <= MIN_BYTES) return 0;
+        int e = 63 - __builtin_clzll(static_cast<unsigned long long>(size - 1));  // 2^e < size <= 2^(e+1)
+        size_t step = (size_t(1) << e) / 4;
+        size_t j = (size - (size_t(1) << e) + step - 1) / step;                    // 1..4
+        return (e - 16) * 4 + static_cast<int>(j);
+    }
+
+private:
+    struct Block {
+        Block* next;
+    };
+
+    struct FreeList {
+        std::mutex mutex;
+        Block* head = nullptr;
+    };
+
+    // Only mmap and getenv here: this runs inside operator new
+    BufferPool() {
+        const char* mode = std::getenv("FHE_POOL");
+        if (mode && std::strcmp(mode, "off") == 0) return;
+        Mode wanted = mode && std::strcmp(mode, "hugetlb") == 0 ? Mode::HugeTlb : Mode::Thp;
+
+        uint64_t reserve = 0;
+        if (const char* mb = std::getenv("FHE_POOL_RESERVE_MB")) reserve = std::strtoull(mb, nullptr, 10) << 20;
+        if (reserve == 0) {
+            long pages = sysconf(_SC_PHYS_PAGES), pageSize = sysconf(_SC_PAGESIZE);
+            reserve = pages > 0 && pageSize > 0 ? static_cast<uint64_t>(pages) * pageSize / 4 : uint64_t(4) << 30;
+        }
+        reserve = (reserve + GRANULE - 1) / GRANULE * GRANULE;
+
+        // Reserve address space only, aligned to a huge page
+        void* p = mmap(nullptr, reserve + GRANULE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED) return;
+        uintptr_t start = reinterpret_cast<uintptr_t>(p);
+        uintptr_t aligned = (start + GRANULE - 1) / GRANULE * GRANULE;
+        if (aligned > start) munmap(p, aligned - start);
+        munmap(reinterpret_cast<void*>(aligned + reserve), start + GRANULE - aligned);
+
+        if (wanted == Mode::HugeTlb) mapHugeTlb();
+
+        size_t granules = (hugeBytes_ + reserve) / GRANULE;
+        void* table = mmap(nullptr, granules, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (table == MAP_FAILED) {
+            munmap(reinterpret_cast<void*>(aligned), reserve);
+            if (hugeBytes_ > 0) munmap(reinterpret_cast<void*>(hugeBase_), hugeBytes_);
+            hugeBase_ = 0;
+            hugeBytes_ = 0;
+            return;
+        }
+        granuleClass_ = static_cast<uint8_t*>(table);
+        base_ = aligned;
+        reserved_ = reserve;
+        mode_.store(wanted, std::memory_order_relaxed);
+    }
+
+    // Map the explicit huge pages free right now. Without MAP_NORESERVE the
+    // kernel reserves them at mmap time, so touching them later cannot fail.
+    void mapHugeTlb() {
+        uint64_t bytes = freeHugeTlbBytes();
+        if (const char* mb = std::getenv("FHE_POOL_HUGETLB_MB")) bytes = std::min<uint64_t>(bytes, std::strtoull(mb, nullptr, 10) << 20);
+        bytes = bytes / GRANULE * GRANULE;
+        if (bytes == 0) return;
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p == MAP_FAILED) return;
+        hugeBase_ = reinterpret_cast<uintptr_t>(p);
+        hugeBytes_ = bytes;
+    }
+
+    // HugePages_Free of /proc/meminfo, read without allocating
+    static uint64_t freeHugeTlbBytes() {
+        int fd = ::open("/proc/meminfo", O_RDONLY);
+        if (fd < 0) return 0;
+        char buf[8192];
+        ssize_t n = ::read(fd, buf, sizeof(buf) - 1);
+        ::close(fd);
+        if (n <= 0) return 0;
+        buf[n] = '\0';
+        const char* line = std::strstr(buf, "HugePages_Free:");
+        return line ? std::strtoull(line + std::strlen("HugePages_Free:"), nullptr, 10) * GRANULE : 0;
+    }
+
+    // Granules are numbered across the explicit huge pages, then the arena
+    size_t granuleOf(uintptr_t a) const {
+        if (a >= hugeBase_ && a < hugeBase_ + hugeBytes_) return (a - hugeBase_) / GRANULE;
+        return (hugeBytes_ + (a - base_)) / GRANULE;
+    }
+
+    // A fresh block of class c from the class's current slab, or a new slab
+    void* carve(int c) {
+        size_t bytes = classBytes(c);
+        std::lock_guard<std::mutex> lock(growMutex_);
+        Slab& slab = slabs_[c];
+        if (slab.next + bytes > slab.end) {
+            // A few blocks per slab, the slab a whole number of huge pages
+            size_t blocks = bytes >= 4 * GRANULE ? 1 : 4 * GRANULE / bytes;
+            size_t slabBytes = (blocks * bytes + GRANULE - 1) / GRANULE * GRANULE;
+            // A slab never straddles the explicit huge pages and the arena
+            if (top_ < hugeBytes_ && top_ + slabBytes > hugeBytes_) top_ = hugeBytes_;
+            if (top_ + slabBytes > hugeBytes_ + reserved_) return nullptr;
+            uintptr_t start;
+            if (top_ < hugeBytes_) {
+                start = hugeBase_ + top_;
+                hugeTlb_.fetch_add(slabBytes, std::memory_order_relaxed);
+            } else {
+                start = base_ + (top_ - hugeBytes_);
+                if (!commit(start, slabBytes)) return nullptr;
+            }
+            committed_.fetch_add(slabBytes, std::memory_order_relaxed);
+            for (size_t g = top_ / GRANULE; g < (top_ + slabBytes) / GRANULE; g++) granuleClass_[g] = static_cast<uint8_t>(c);
+            top_ += slabBytes;
+            slab.next = start;
+            slab.end = start + slabBytes;
+        }
+        void* block = reinterpret_cast<void*>(slab.next);
+        slab.next += bytes;
+        carved_.fetch_add(1, std::memory_order_relaxed);
+        return block;
+    }
+
+    static bool commit(uintptr_t start, size_t bytes) {
+        void* at = reinterpret_cast<void*>(start);
+        if (mprotect(at, bytes, PROT_READ | PROT_WRITE) != 0) return false;
+#ifdef MADV_HUGEPAGE
+        madvise(at, bytes, MADV_HUGEPAGE);
+#endif
+        return true;
+    }
+
+    struct Slab {
+        uintptr_t next = 0;
+        uintptr_t end = 0;
+    };
+
+    std::atomic<Mode> mode_{Mode::Off};
+    uintptr_t base_ = 0;
+    uint64_t reserved_ = 0;
+    uintptr_t hugeBase_ = 0;
+    uint64_t hugeBytes_ = 0;
+    uint64_t top_ = 0;  // bytes handed to slabs, explicit huge pages first
+    uint8_t* granuleClass_ = nullptr;
+    std::mutex growMutex_;
+    Slab slabs_[CLASSES];
+    FreeList lists_[CLASSES];
+    std::atomic<uint64_t> committed_{0};
+    std::atomic<uint64_t> hugeTlb_{0};
+    std::atomic<uint64_t> reused_{0};
+    std::atomic<uint64_t> carved_{0};
+};
+
+} // namespace mem
+
+#endif // FHE_BUFFER_POOL_H
@@ -14,6 +14,14 @@
 #include "cryptocontext-ser.h"
 #include "key/key-ser.h"
 #include "scheme/bgvrns/bgvrns-ser.h"
+#include "scheme/ckksrns/ckksrns-ser.h"
+
+#include "async-io.h"
+#include "artifact-store.h"
+#include "profiling.h"
+#include "memory-stats.h"
+#include "metrics.h"
+#include "scheme-config.h"
 
 using namespace lbcrypto;
 
@@ -21,72 +29,32 @@ const std::string DATAFOLDER = "tee_data";
 const std::string PRIVATEKEY = "private_data";
 const std::string RESULTSFOLDER = "data";
 const std::string CRYPTOCONTEXT = "cryptocontext";
+const std::string STOREFOLDER = "store";
+
 
+std::string configParametersText(int multDepth, int plainModulus, int securityLevel, const scheme::Config& schemeConfig) {
+    std::ostringstream out;
+    out << "depth=" << multDepth << std::endl;
+    out << "modulus=" << plainModulus << std::endl;
+    out << "security=" << securityLevel << std::endl;
+    out << schemeConfig.text();
+    return out.str();
+}
 
-void saveConfigParameters(int multDepth, int plainModulus, int securityLevel, const std::string& configFile = RESULTSFOLDER + "/config_params.txt") {
+void saveConfigParameters(int multDepth, int plainModulus, int securityLevel, const scheme::Config& schemeConfig,
+                          const std::string& configFile = RESULTSFOLDER + "/config_params.txt") {
     std::ofstream outFile(configFile);
     if (!outFile.is_open()) {
         std::cerr << "Error: Could not open configuration file for writing: " << configFile << std::endl;
         return;
     }
     
-    outFile << "depth=" << multDepth << std::endl;
-    outFile << "modulus=" << plainModulus << std::endl;
-    outFile << "security=" << securityLevel << std::endl;
+    outFile << configParametersText(multDepth, plainModulus, securityLevel, schemeConfig);
     
     outFile.close();
     std::cout << "Configuration parameters saved to " << configFile << std::endl;
 }
 
-
-void saveTimingToCSV(const std::string& phase, 
-                     uint32_t depth, uint32_t modulus, uint32_t security,
-                     double context_time, double keygen_time, 
-                     double encrypt_time, double serialize_time, 
-                     double total_time,
-                     const std::string& csvFile = "enc_timing_results.csv") {
-    
-    // Check if file exists to determine if we need to write headers
-    bool fileExists = false;
-    std::ifstream checkFile(csvFile);
-    if (checkFile.good()) {
-        fileExists = true;
-    }
-    checkFile.close();
-    
-    // Open file in append mode
-    std::ofstream outFile(csvFile, std::ios::app);
-    if (!outFile.is_open()) {
-        std::cerr << "Error: Could not open CSV file for writing: " << csvFile << std::endl;
-        return;
-    }
-    
-    // Write headers if file is new
-    if (!fileExists) {
-        outFile << "timestamp,phase,depth,modulus,security,context_time,keygen_time,"
-                << "encrypt_time,serialize_time,total_time" << std::endl;
-    }
-    
-    // Get current timestamp
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto tm = *std::localtime(&time_t);
-    
-    // Write data row
-    outFile << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << ","
-            << phase << ","
-            << depth << ","
-            << modulus << ","
-            << security << ","
-            << std::fixed << std::setprecision(10) << context_time << ","
-            << keygen_time << ","
-            << encrypt_time << ","
-            << serialize_time << ","
-            << total_time << std::endl;
-    
-    outFile.close();
-    std::cout << "Timing results saved to " << csvFile << std::endl;
-                     }
 /////////////////////////////////////////////
 //                                         //
 //               |MAIN|                    //
@@ -97,11 +65,19 @@ void saveTimingToCSV(const std::string& phase,
 int main(int argc, char* argv[])
 {
     auto start_total = std::chrono::high_resolution_clock::now();
+    prof::Session profile("encryption");
+    FHE_SPAN("encryption");
+    mem::Phase memory({"context", "keygen", "encrypt", "serialize"});
+    metrics::Exporter exporter("encryption");
 
     //cryptocontext setting
     uint32_t multDepth = 1;
     uint32_t plainModulus = 65537;
     uint32_t securityLevel = 128; // Default security level
+    bool useStore = false;
+    std::string jobName = "default";
+    std::string keysetName;
+    scheme::Config schemeConfig;
     
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
@@ -115,146 +91,386 @@ int main(int argc, char* argv[])
                 std::cout << "Warning: Security level must be 128, 192, or 256. Setting to default (128)." << std::endl;
                 securityLevel = 128;
             }
+        } else if (arg == "--store") {
+            useStore = true;
+        } else if (arg == "--job" && i + 1 < argc) {
+            jobName = argv[++i];
+        } else if (arg == "--keyset" && i + 1 < argc) {
+            keysetName = argv[++i];
+        } else if (arg == "--scheme" && i + 1 < argc) {
+            if (!scheme::parseKind(argv[++i], schemeConfig.kind)) {
+                std::cerr << "Error: --scheme must be bgv or ckks" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--scaling" && i + 1 < argc) {
+            if (!scheme::parseScaling(argv[++i], schemeConfig.scaling)) {
+                std::cerr << "Error: --scaling must be fixedmanual, fixedauto, flexibleauto or flexibleautoext" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--scale-bits" && i + 1 < argc) {
+            schemeConfig.scaleBits = std::stoi(argv[++i]);
+        } else if (arg == "--first-mod-bits" && i + 1 < argc) {
+            schemeConfig.firstModBits = std::stoi(argv[++i]);
+        } else if (arg == "--slots" && i + 1 < argc) {
+            schemeConfig.slots = std::stoi(argv[++i]);
+            if (schemeConfig.slots < 0 || (schemeConfig.slots & (schemeConfig.slots - 1)) != 0) {
+                std::cerr << "Error: --slots must be a power of two, or 0 for all of them" << std::endl;
+                return 1;
+            }
         } else if (arg == "--help") {
             std::cout << "Usage: " << argv[0] << " [OPTIONS]\n"
                       << "Options:\n"
                       << "  --depth N       Set multiplicative depth (default: 8)\n"
                       << "  --modulus N     Set plaintext modulus (default: 65537)\n"
                       << "  --security N    Set security level (128, 192, or 256) (default: 128)\n"
+                      << "  --store         Put artifacts in the content-addressed store\n"
+                      << "  --job NAME      Job the artifacts are recorded under (default: default)\n"
+                      << "  --keyset NAME   Reuse the stored keyset NAME, or record a new one under it\n"
+                      << "  --scheme S      bgv (exact integers) or ckks (approximate reals) (default: bgv)\n"
+                      << "  --scaling T     CKKS rescaling: fixedmanual, fixedauto, flexibleauto or\n"
+                      << "                  flexibleautoext (default: flexibleauto)\n"
+                      << "  --scale-bits N  CKKS scaling factor bits, in place of --modulus (default: 50)\n"
+                      << "  --first-mod-bits N  CKKS first modulus bits (default: 60)\n"
+                      << "  --slots N       CKKS slots, a power of two (default: ring dimension / 2)\n"
                       << "  --help          Display this help message\n";
             return 0;
         }
     }
+    // CKKS has no plaintext modulus: the modulus column records the scaling
+    // factor bits instead
+    if (schemeConfig.ckks()) plainModulus = schemeConfig.scaleBits;
+    profile.setParameters(multDepth, plainModulus, securityLevel);
     
+    // Artifacts are serialized into memory as soon as they exist and handed to
+    // the asynchronous writer, so disk writes overlap with the remaining work.
+    AsyncIO io;
+    metrics::RunMetrics<AsyncIO> live("encryption", io, mem::liveBytes);
+    std::chrono::nanoseconds serialize_duration(0);
+    std::chrono::nanoseconds keygen_duration(0);
+
+    // With --store, artifacts go to the content-addressed store and the job
+    // only records their hashes; a stored keyset skips key generation and
+    // writes no keys at all.
+    std::unique_ptr<ArtifactStore> store;
+    ArtifactRefs jobRefs, keysetRefs;
+    bool reuseKeyset = false;
+    const std::string config = configParametersText(multDepth, plainModulus, securityLevel, schemeConfig);
+    if (useStore) {
+        if (!ArtifactStore::validName(jobName) || (!keysetName.empty() && !ArtifactStore::validName(keysetName))) {
+            std::cerr << "Error: invalid job or keyset name" << std::endl;
+            return 1;
+        }
+        store = std::make_unique<ArtifactStore>(io, STOREFOLDER);
+        reuseKeyset = !keysetName.empty() && store->readRefs("keysets", keysetName, keysetRefs);
+        if (reuseKeyset && Sha256::of(config) != keysetRefs.hash("config_params")) {
+            std::cerr << "Error: keyset " << keysetName << " was generated with different parameters" << std::endl;
+            return 1;
+        }
+    }
+
+    // Hand serialized bytes to the store, or write them to their usual file
+    auto emit = [&](const std::string& name, const std::string& path, std::string bytes) {
+        if (bytes.empty()) return false;
+        metrics::add("fhe_serialized_bytes", "Bytes of serialized artifacts", {{"phase", "encryption"}, {"artifact", name}},
+                     static_cast<double>(bytes.size()));
+        if (!store) return io.write(path, std::move(bytes));
+        uint64_t size = bytes.size();
+        std::string hash = store->put(std::move(bytes));
+        if (hash.empty()) return false;
+        jobRefs.set(name, hash, size);
+        return true;
+    };
+
     // Time context creation
+    memory.begin("context");
     auto start_context = std::chrono::high_resolution_clock::now();
     
-    //cryptocontext setting
-    CCParams<CryptoContextBGVRNS> parameters;
-    parameters.SetMultiplicativeDepth(multDepth);
-    parameters.SetPlaintextModulus(plainModulus);
-    SecurityLevel secLevelEnum;
-    if (securityLevel == 128) {
-        secLevelEnum = HEStd_128_classic;
-    } else if (securityLevel == 192) {
-        secLevelEnum = HEStd_192_classic;
-    } else if (securityLevel == 256) {
-        secLevelEnum = HEStd_256_classic;
+    CryptoContext<DCRTPoly> cc;
+    PublicKey<DCRTPoly> pk;
+
+    if (reuseKeyset) {
+        auto ccBytes = store->get(keysetRefs.hash("cryptocontext"));
+        auto pkBytes = store->get(keysetRefs.hash("key-public"));
+        FHE_SPAN("deserialize:keyset");
+        if (!deserializeAsync(ccBytes, cc) || !deserializeAsync(pkBytes, pk)) {
+            std::cerr << "Error reading keyset " << keysetName << " from the store" << std::endl;
+            return 1;
+        }
+        for (const auto& [name, ref] : keysetRefs.refs) {
+            jobRefs.set(name, ref.hash, ref.size);
+        }
+        std::cout << "Reusing stored keyset " << keysetName << "." << std::endl;
+    } else if (schemeConfig.ckks()) {
+        FHE_SPAN("GenCryptoContext");
+        cc = scheme::generateCkksContext(multDepth, securityLevel, schemeConfig);
     } else {
-        std::cout << "Warning: Invalid security level. Defaulting to 128-bit." << std::endl;
-        secLevelEnum = HEStd_128_classic;
-    }
-    parameters.SetSecurityLevel(secLevelEnum);
+        //cryptocontext setting
+        CCParams<CryptoContextBGVRNS> parameters;
+        parameters.SetMultiplicativeDepth(multDepth);
+        parameters.SetPlaintextModulus(plainModulus);
+        SecurityLevel secLevelEnum;
+        if (securityLevel == 128) {
+            secLevelEnum = HEStd_128_classic;
+        } else if (securityLevel == 192) {
+            secLevelEnum = HEStd_192_classic;
+        } else if (securityLevel == 256) {
+            secLevelEnum = HEStd_256_classic;
+        } else {
+            std::cout << "Warning: Invalid security level. Defaulting to 128-bit." << std::endl;
+            secLevelEnum = HEStd_128_classic;
+        }
+        parameters.SetSecurityLevel(secLevelEnum);
 
-    CryptoContext<DCRTPoly> cc = GenCryptoContext(parameters);
+        FHE_SPAN("GenCryptoContext");
+        cc = GenCryptoContext(parameters);
 
-    cc->Enable(PKE);
-    cc->Enable(KEYSWITCH);
-    cc->Enable(LEVELEDSHE);
+        cc->Enable(PKE);
+        cc->Enable(KEYSWITCH);
+        cc->Enable(LEVELEDSHE);
+    }
     
     auto end_context = std::chrono::high_resolution_clock::now();
+    memory.end("context");
+
+    if (!reuseKeyset) {
+        memory.begin("serialize");
+        auto start_serialize = std::chrono::high_resolution_clock::now();
+
+        // Serialize cryptocontext
+        std::string ccBytes;
+        {
+            FHE_SPAN("serialize:cryptocontext");
+            ccBytes = serializeToBytes(cc);
+        }
+        if (!emit("cryptocontext", CRYPTOCONTEXT + "/cryptocontext.txt", std::move(ccBytes))) {
+            std::cerr << "Error writing serialization of the crypto context to "
+                         "cryptocontext.txt"
+                      << std::endl;
+            return 1;
+        }
+        std::cout << "The cryptocontext has been serialized." << std::endl;
+
+        serialize_duration += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now() - start_serialize);
+        memory.end("serialize");
     
-    // Time key generation
-    auto start_keygen = std::chrono::high_resolution_clock::now();
-    
-    //key generation
-    KeyPair<DCRTPoly> keyPair;
-    keyPair = cc->KeyGen();
-    const PublicKey<DCRTPoly> pk = keyPair.publicKey;
-    const PrivateKey<DCRTPoly> sk = keyPair.secretKey;
-    
-    cc->EvalMultKeyGen(sk);
+        // Time key generation
+        memory.begin("keygen");
+        auto start_keygen = std::chrono::high_resolution_clock::now();
     
-    auto end_keygen = std::chrono::high_resolution_clock::now();
+        //key generation
+        KeyPair<DCRTPoly> keyPair;
+        {
+            FHE_SPAN("KeyGen");
+            keyPair = cc->KeyGen();
+        }
+        pk = keyPair.publicKey;
+        const PrivateKey<DCRTPoly> sk = keyPair.secretKey;
     
-    // Time plaintext creation and encryption
-    auto start_encrypt = std::chrono::high_resolution_clock::now();
+        keygen_duration += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now() - start_keygen);
+        memory.end("keygen");
+
+        // The key pair is written while the eval mult key is being generated
+        memory.begin("serialize");
+        start_serialize = std::chrono::high_resolution_clock::now();
+
+        // Serialize the public key
+        std::string pkBytes;
+        {
+            FHE_SPAN("serialize:key-public");
+            pkBytes = serializeToBytes(keyPair.publicKey);
+        }
+        if (!emit("key-public", RESULTSFOLDER + "/key-public.txt", std::move(pkBytes))) {
+            std::cerr << "Error writing serialization of private key to key-public.txt" << std::endl;
+            return 1;
+        }
+        std::cout << "The public key has been serialized." << std::endl;
     
-    std::vector<int64_t> vectorOfInts1 = {1,1,1,1};
-    Plaintext plaintext1 = cc->MakePackedPlaintext(vectorOfInts1);
+        // Serialize the secret key; it stays on the private volume even with
+        // --store, named after its public key
+        std::string skPath = store ? privateKeyPath(PRIVATEKEY, jobRefs.hash("key-public"))
+                                   : PRIVATEKEY + "/key-private.txt";
+        {
+            FHE_SPAN("serialize:key-private");
+            if (!serializeAsync(io, skPath, keyPair.secretKey)) {
+                std::cerr << "Error writing serialization of private key to key-private.txt" << std::endl;
+                return 1;
+            }
+        }
+        std::cout << "The secret key has been serialized." << std::endl;
 
-    std::vector<int64_t> vectorOfInts2 = {1,1,1,1};
-    Plaintext plaintext2 = cc->MakePackedPlaintext(vectorOfInts2);
+        serialize_duration += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now() - start_serialize);
+        memory.end("serialize");
 
-    std::cout << "Decision tree succesfully built from the input file." << std::endl;
+        memory.begin("keygen");
+        start_keygen = std::chrono::high_resolution_clock::now();
 
-    auto ciphertext1 = cc->Encrypt(keyPair.publicKey, plaintext1);
-    auto ciphertext2 = cc->Encrypt(keyPair.publicKey, plaintext2);
-    
-    auto end_encrypt = std::chrono::high_resolution_clock::now();
-    
-    // Time serialization
-    auto start_serialize = std::chrono::high_resolution_clock::now();
+        {
+            FHE_SPAN("EvalMultKeyGen");
+            cc->EvalMultKeyGen(sk);
+        }
     
-    // Serialize cryptocontext
-    if (!Serial::SerializeToFile(CRYPTOCONTEXT + "/cryptocontext.txt", cc, SerType::BINARY)) {
-        std::cerr << "Error writing serialization of the crypto context to "
-                     "cryptocontext.txt"
-                  << std::endl;
-        return 1;
+        keygen_duration += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now() - start_keygen);
+        memory.end("keygen");
+
+        memory.begin("serialize");
+        start_serialize = std::chrono::high_resolution_clock::now();
+
+        // Serialize the relinearization (evaluation) key for homomorphic
+        // multiplication
+        BufferStream emkeyfile;
+        {
+            FHE_SPAN("serialize:key-eval-mult");
+            if (cc->SerializeEvalMultKey(emkeyfile, SerType::BINARY) == false) {
+                std::cerr << "Error writing serialization of the eval mult keys to "
+                             "key-eval-mult.txt"
+                          << std::endl;
+                return 1;
+            }
+        }
+        if (!emit("key-eval-mult", RESULTSFOLDER + "/" + "key-eval-mult.txt", emkeyfile.take())) {
+            std::cerr << "Error serializing eval mult keys" << std::endl;
+            return 1;
+        }
+        std::cout << "The eval mult keys have been serialized." << std::endl;
+
+        serialize_duration += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now() - start_serialize);
+        memory.end("serialize");
     }
-    std::cout << "The cryptocontext has been serialized." << std::endl;
     
-    // Serialize the public key
-    if (!Serial::SerializeToFile(RESULTSFOLDER + "/key-public.txt", keyPair.publicKey, SerType::BINARY)) {
-        std::cerr << "Error writing serialization of private key to key-public.txt" << std::endl;
-        return 1;
-    }
-    std::cout << "The public key has been serialized." << std::endl;
+    // Time plaintext creation and encryption
+    memory.begin("encrypt");
+    auto start_encrypt = std::chrono::high_resolution_clock::now();
     
-    // Serialize the secret key
-    if (!Serial::SerializeToFile(PRIVATEKEY + "/key-private.txt", keyPair.secretKey, SerType::BINARY)) {
-        std::cerr << "Error writing serialization of private key to key-private.txt" << std::endl;
-        return 1;
+    Plaintext plaintext1, plaintext2;
+    const size_t slotCount = schemeConfig.ckks() ? schemeConfig.slotCount(cc) : 0;
+    if (schemeConfig.ckks()) {
+        // Every slot holds a value, at the scaling factor of the context
+        FHE_SPAN("MakeCKKSPackedPlaintext");
+        plaintext1 = cc->MakeCKKSPackedPlaintext(scheme::input(1, slotCount));
+        plaintext2 = cc->MakeCKKSPackedPlaintext(scheme::input(2, slotCount));
+    } else {
+        std::vector<int64_t> vectorOfInts1 = {1,1,1,1};
+        std::vector<int64_t> vectorOfInts2 = {1,1,1,1};
+        FHE_SPAN("MakePackedPlaintext");
+        plaintext1 = cc->MakePackedPlaintext(vectorOfInts1);
+        plaintext2 = cc->MakePackedPlaintext(vectorOfInts2);
     }
-    std::cout << "The secret key has been serialized." << std::endl;
-    
-    // Serialize the relinearization (evaluation) key for homomorphic
-    // multiplication
-    std::ofstream emkeyfile(RESULTSFOLDER + "/" + "key-eval-mult.txt", std::ios::out | std::ios::binary);
-    if (emkeyfile.is_open()) {
-        if (cc->SerializeEvalMultKey(emkeyfile, SerType::BINARY) == false) {
-            std::cerr << "Error writing serialization of the eval mult keys to "
-                         "key-eval-mult.txt"
-                      << std::endl;
-            return 1;
-        }
-        std::cout << "The eval mult keys have been serialized." << std::endl;
 
-        emkeyfile.close();
+    std::cout << "Decision tree succesfully built from the input file." << std::endl;
+
+    Ciphertext<DCRTPoly> ciphertext1;
+    {
+        FHE_SPAN("Encrypt");
+        ciphertext1 = cc->Encrypt(pk, plaintext1);
     }
-    else {
-        std::cerr << "Error serializing eval mult keys" << std::endl;
-        return 1;
+
+    auto encrypt_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now() - start_encrypt);
+    memory.end("encrypt");
+
+    // The first ciphertext is on its way to disk while the second is encrypted
+    memory.begin("serialize");
+    auto start_serialize = std::chrono::high_resolution_clock::now();
+    std::string ct1Bytes;
+    {
+        FHE_SPAN("serialize:enc_file1");
+        ct1Bytes = serializeToBytes(ciphertext1);
     }
-    
-    if (!Serial::SerializeToFile(RESULTSFOLDER + "/enc_file1.txt", ciphertext1, SerType::BINARY)) {
+    if (!emit("enc_file1", RESULTSFOLDER + "/enc_file1.txt", std::move(ct1Bytes))) {
       std::cerr << "Error writing serialization of ciphertext1  to enc_file1.txt" << std::endl;
       return 1;
     }
-    if (!Serial::SerializeToFile(RESULTSFOLDER + "/enc_file2.txt", ciphertext2, SerType::BINARY)) {
+    serialize_duration += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now() - start_serialize);
+    memory.end("serialize");
+
+    memory.begin("encrypt");
+    start_encrypt = std::chrono::high_resolution_clock::now();
+
+    Ciphertext<DCRTPoly> ciphertext2;
+    {
+        FHE_SPAN("Encrypt");
+        ciphertext2 = cc->Encrypt(pk, plaintext2);
+    }
+    
+    encrypt_duration += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now() - start_encrypt);
+    memory.end("encrypt");
+    
+    memory.begin("serialize");
+    start_serialize = std::chrono::high_resolution_clock::now();
+    std::string ct2Bytes;
+    {
+        FHE_SPAN("serialize:enc_file2");
+        ct2Bytes = serializeToBytes(ciphertext2);
+    }
+    if (!emit("enc_file2", RESULTSFOLDER + "/enc_file2.txt", std::move(ct2Bytes))) {
       std::cerr << "Error writing serialization of ciphertext2  to enc_file2.txt" << std::endl;
       return 1;
     }
     
-    saveConfigParameters(multDepth, plainModulus, securityLevel);
+    if (store) {
+        emit("config_params", "", std::string(config));
+    } else {
+        saveConfigParameters(multDepth, plainModulus, securityLevel, schemeConfig);
+    }
     
-    auto end_serialize = std::chrono::high_resolution_clock::now();
+    serialize_duration += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now() - start_serialize);
+    memory.end("serialize");
+
+    // Wait for the outstanding writes and their fsyncs
+    bool drained;
+    {
+        FHE_SPAN("io:drain");
+        drained = io.drain();
+    }
+    if (!drained) {
+        std::cerr << "Error writing artifacts: " << io.lastError() << std::endl;
+        return 1;
+    }
+
+    // References are recorded only once every object they name is in place
+    if (store) {
+        if (!store->publish()) {
+            std::cerr << "Error publishing objects in " << STOREFOLDER << std::endl;
+            return 1;
+        }
+        if (!keysetName.empty() && !reuseKeyset) {
+            ArtifactRefs keyset;
+            for (const char* name : {"cryptocontext", "key-public", "key-eval-mult", "config_params"}) {
+                keyset.set(name, jobRefs.hash(name), jobRefs.refs.at(name).size);
+            }
+            if (!store->writeRefs("keysets", keysetName, keyset)) {
+                std::cerr << "Error recording keyset " << keysetName << std::endl;
+                return 1;
+            }
+        }
+        if (!store->writeRefs("jobs", jobName, jobRefs)) {
+            std::cerr << "Error recording job " << jobName << std::endl;
+            return 1;
+        }
+        std::cout << "Job " << jobName << " recorded in " << STOREFOLDER << "." << std::endl;
+    }
+
     auto end_total = std::chrono::high_resolution_clock::now();
 
-    // Calculate durations in microseconds
-    auto context_duration = std::chrono::duration_cast<std::chrono::microseconds>(end_context - start_context);
-    auto keygen_duration = std::chrono::duration_cast<std::chrono::microseconds>(end_keygen - start_keygen);
-    auto encrypt_duration = std::chrono::duration_cast<std::chrono::microseconds>(end_encrypt - start_encrypt);
-    auto serialize_duration = std::chrono::duration_cast<std::chrono::microseconds>(end_serialize - start_serialize);
-    auto total_duration = std::chrono::duration_cast<std::chrono::microseconds>(end_total - start_total);
+    // Calculate durations in nanoseconds
+    auto context_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_context - start_context);
+    auto total_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_total - start_total);
 
     // Convert to seconds
-    double context_time = context_duration.count() / 1000000.0;
-    double keygen_time = keygen_duration.count() / 1000000.0;
-    double encrypt_time = encrypt_duration.count() / 1000000.0;
-    double serialize_time = serialize_duration.count() / 1000000.0;
-    double total_time = total_duration.count() / 1000000.0;
+    double context_time = context_duration.count() / 1e9;
+    double keygen_time = keygen_duration.count() / 1e9;
+    double encrypt_time = encrypt_duration.count() / 1e9;
+    double serialize_time = serialize_duration.count() / 1e9;
+    double total_time = total_duration.count() / 1e9;
+    double io_wait_time = io.waitSeconds();
 
     // Output timing results in a parseable format
     std::cout << "=== TIMING_RESULTS ===" << std::endl;
@@ -263,9 +479,34 @@ int main(int argc, char* argv[])
     std::cout << "ENC_ENCRYPT_TIME: " << encrypt_time << std::endl;
     std::cout << "ENC_SERIALIZE_TIME: " << serialize_time << std::endl;
     std::cout << "ENC_TOTAL_TIME: " << total_time << std::endl;
+    std::cout << "ENC_IO_WAIT_TIME: " << io_wait_time << std::endl;
+    std::cout << "ENC_IO_BACKEND: " << io.backendName() << std::endl;
+    if (schemeConfig.ckks()) {
+        std::cout << "ENC_SCHEME: ckks " << scheme::scalingName(schemeConfig.scaling) << std::endl;
+        std::cout << "ENC_SLOTS: " << slotCount << std::endl;
+        std::cout << "ENC_RING_DIMENSION: " << cc->GetRingDimension() << std::endl;
+    }
+    memory.print(std::cout, "ENC");
+    if (store) {
+        std::cout << "ENC_STORE_OBJECTS_WRITTEN: " << store->objectsWritten() << std::endl;
+        std::cout << "ENC_STORE_DEDUP_BYTES: " << store->dedupBytes() << std::endl;
+    }
 
-    saveTimingToCSV("encryption", multDepth, plainModulus, securityLevel,
-                    context_time, keygen_time, encrypt_time, serialize_time, total_time);
+    std::vector<std::pair<std::string, double>> columns = {{"context_time", context_time},
+                                                           {"keygen_time", keygen_time},
+                                                           {"encrypt_time", encrypt_time},
+                                                           {"serialize_time", serialize_time},
+                                                           {"total_time", total_time},
+                                                           {"io_wait_time", io_wait_time}};
+    memory.appendColumns(columns);
+    schemeConfig.appendColumns(columns, slotCount);
+    prof::saveTimingToCSV(schemeConfig.csvFile("enc_timing_results.csv"), "encryption", multDepth, plainModulus,
+                          securityLevel, columns);
+    metrics::recordPhase("encryption", columns);
+    if (store) {
+        metrics::add("fhe_store_dedup_bytes", "Artifact bytes the store already held", {{"phase", "encryption"}},
+                     static_cast<double>(store->dedupBytes()));
+    }
 
     
     return 0;
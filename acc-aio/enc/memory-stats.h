@@ -0,0 +1,285 @@
+//MEMORY TELEMETRY : PEAK RSS, HEAP HIGH-WATER MARKS, ALLOCATIONS AND PAGE FAULTS
+//
+// Each binary records, for the whole phase and for each of its timed steps:
+//
+//   peak_rss_mb     resident set high-water mark (VmHWM); per step it is reset
+//                   through /proc/self/clear_refs where the kernel allows it
+//   peak_heap_mb    most bytes live through operator new at any one time
+//   alloc_count     operator new calls, and alloc_mb the bytes they handed out
+//   minor_faults    page faults (getrusage), major_faults those that hit disk
+//
+// The heap figures come from the replacement operator new/delete below, so
+// they also cover allocations made inside the OpenFHE libraries. They are the
+// relevant figure inside an SGX enclave, where the RSS of the host process
+// says little about enclave heap use and /proc may not be available.
+//
+// The replacement operators are defined in this header: include it from the
+// binary's one translation unit only. -DFHE_NO_MEMORY_HOOKS leaves the
+// allocator alone (heap and allocation columns are then 0). Buffers of 64 KB
+// and more, the polynomial towers, go through the BufferPool of
+// buffer-pool.h; FHE_POOL=off sends them to malloc like the rest.
+
+#ifndef FHE_MEMORY_STATS_H
+#define FHE_MEMORY_STATS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <malloc.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "buffer-pool.h"
+
+namespace mem {
+
+// Allocation counters, updated by the operator new/delete replacements
+inline std::atomic<uint64_t> allocations{0};
+inline std::atomic<uint64_t> allocatedBytes{0};
+inline std::atomic<uint64_t> liveBytes{0};
+inline std::atomic<uint64_t> peakLiveBytes{0};    // since the phase (re)started
+inline std::atomic<uint64_t> windowPeakBytes{0};  // since the current step began
+
+inline void raisePeak(std::atomic<uint64_t>& peak, uint64_t value) {
+    uint64_t seen = peak.load(std::memory_order_relaxed);
+    while (seen < value && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+inline void onAllocate(uint64_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    uint64_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    raisePeak(peakLiveBytes, live);
+    raisePeak(windowPeakBytes, live);
+}
+
+// A pooled block for a large request, or nullptr to fall back to malloc
+inline void* allocatePooled(std::size_t size) {
+    if (!BufferPool::pooled(size)) return nullptr;
+    std::size_t blockBytes = 0;
+    void* p = BufferPool::instance().allocate(size, blockBytes);
+    if (p != nullptr) onAllocate(blockBytes);
+    return p;
+}
+
+inline void* allocate(std::size_t size) {
+    if (void* p = allocatePooled(size)) return p;
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) throw std::bad_alloc();
+    onAllocate(::malloc_usable_size(p));
+    return p;
+}
+
+inline void* allocateAligned(std::size_t size, std::align_val_t align) {
+    std::size_t alignment = std::max(static_cast<std::size_t>(align), sizeof(void*));
+    if (alignment <= BufferPool::MAX_ALIGN) {
+        if (void* p = allocatePooled(size)) return p;
+    }
+    void* p = nullptr;
+    if (::posix_memalign(&p, alignment, size == 0 ? 1 : size) != 0) throw std::bad_alloc();
+    onAllocate(::malloc_usable_size(p));
+    return p;
+}
+
+inline void release(void* p) noexcept {
+    if (p == nullptr) return;
+    BufferPool& pool = BufferPool::instance();
+    if (pool.owns(p)) {
+        liveBytes.fetch_sub(pool.release(p), std::memory_order_relaxed);
+        return;
+    }
+    liveBytes.fetch_sub(::malloc_usable_size(p), std::memory_order_relaxed);
+    std::free(p);
+}
+
+// VmHWM and VmRSS from /proc/self/status, in bytes (0 if unavailable)
+inline std::pair<uint64_t, uint64_t> residentBytes() {
+    std::ifstream in("/proc/self/status");
+    std::string key;
+    uint64_t hwm = 0, rss = 0, kb;
+    while (in >> key) {
+        if (key == "VmHWM:" && in >> kb) hwm = kb * 1024;
+        else if (key == "VmRSS:" && in >> kb) rss = kb * 1024;
+        in.ignore(256, '\n');
+    }
+    return {hwm, rss};
+}
+
+// Reset VmHWM to the current RSS (Linux 4.0+); false where not permitted
+inline bool resetResidentPeak() {
+    int fd = ::open("/proc/self/clear_refs", O_WRONLY);
+    if (fd < 0) return false;
+    bool ok = ::write(fd, "5", 1) == 1;
+    ::close(fd);
+    return ok;
+}
+
+inline std::pair<uint64_t, uint64_t> pageFaults() {
+    struct rusage usage;
+    if (::getrusage(RUSAGE_SELF, &usage) != 0) return {0, 0};
+    return {static_cast<uint64_t>(usage.ru_minflt), static_cast<uint64_t>(usage.ru_majflt)};
+}
+
+inline double megabytes(uint64_t bytes) { return bytes / (1024.0 * 1024.0); }
+
+// Memory use of one phase, split into the same steps as its timing columns.
+// Steps are sequential; a step may be entered several times and keeps the
+// highest peaks and the sum of its allocations and faults.
+class Phase {
+public:
+    explicit Phase(std::vector<std::string> steps) : order_(std::move(steps)) {
+        for (const auto& s : order_) steps_[s];
+        restart();
+    }
+
+    // Start counting afresh, e.g. for the next job of a multi-job run
+    void restart() {
+        for (auto& [name, step] : steps_) step = Step();
+        peakRss_ = 0;
+        uint64_t live = liveBytes.load(std::memory_order_relaxed);
+        peakLiveBytes.store(live, std::memory_order_relaxed);
+        startAllocations_ = allocations.load(std::memory_order_relaxed);
+        startAllocatedBytes_ = allocatedBytes.load(std::memory_order_relaxed);
+        startFaults_ = pageFaults();
+        rssResettable_ = resetResidentPeak();
+    }
+
+    void begin(const std::string& step) {
+        // Keep the high-water mark reached since the last step before clearing it
+        foldResidentPeak();
+        rssResettable_ = resetResidentPeak();
+        windowPeakBytes.store(liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        current_ = step;
+        stepAllocations_ = allocations.load(std::memory_order_relaxed);
+        stepFaults_ = pageFaults();
+    }
+
+    void end(const std::string& step) {
+        if (step != current_) return;
+        Step& s = steps_[step];
+        uint64_t hwm = foldResidentPeak();
+        // Without a resettable VmHWM a step can only report the phase peak so far
+        s.peakRss = std::max(s.peakRss, rssResettable_ ? hwm : peakRss_);
+        s.peakHeap = std::max(s.peakHeap, windowPeakBytes.load(std::memory_order_relaxed));
+        s.allocations += allocations.load(std::memory_order_relaxed) - stepAllocations_;
+        auto faults = pageFaults();
+        s.faults += (faults.first - stepFaults_.first) + (faults.second - stepFaults_.second);
+        current_.clear();
+    }
+
+    uint64_t peakRss() { return std::max(peakRss_, foldResidentPeak()); }
+    uint64_t peakHeap() const { return peakLiveBytes.load(std::memory_order_relaxed); }
+
+    // Columns for prof::saveTimingToCSV: phase totals, then per step
+    void appendColumns(std::vector<std::pair<std::string, double>>& columns) {
+        auto faults = pageFaults();
+        columns.emplace_back("peak_rss_mb", megabytes(peakRss()));
+        columns.emplace_back("peak_heap_mb", megabytes(peakHeap()));
+        columns.emplace_back("alloc_count", static_cast<double>(allocations.load() - startAllocations_));
+        columns.emplace_back("alloc_mb", megabytes(allocatedBytes.load() - startAllocatedBytes_));
+        columns.emplace_back("minor_faults", static_cast<double>(faults.first - startFaults_.first));
+        columns.emplace_back("major_faults", static_cast<double>(faults.second - startFaults_.second));
+        for (const auto& name : order_) {
+            const Step& s = steps_.at(name);
+            columns.emplace_back(name + "_peak_rss_mb", megabytes(s.peakRss));
+            columns.emplace_back(name + "_peak_heap_mb", megabytes(s.peakHeap));
+            columns.emplace_back(name + "_alloc_count", static_cast<double>(s.allocations));
+            columns.emplace_back(name + "_page_faults", static_cast<double>(s.faults));
+        }
+    }
+
+    // Phase totals in the "PREFIX_KEY: value" format of the timing results
+    void print(std::ostream& out, const std::string& prefix) {
+        auto faults = pageFaults();
+        out << prefix << "_PEAK_RSS_MB: " << megabytes(peakRss()) << std::endl;
+        out << prefix << "_PEAK_HEAP_MB: " << megabytes(peakHeap()) << std::endl;
+        out << prefix << "_ALLOC_COUNT: " << allocations.load() - startAllocations_ << std::endl;
+        out << prefix << "_ALLOC_MB: " << megabytes(allocatedBytes.load() - startAllocatedBytes_) << std::endl;
+        out << prefix << "_PAGE_FAULTS: " << (faults.first - startFaults_.first) + (faults.second - startFaults_.second)
+            << std::endl;
+        const BufferPool& pool = BufferPool::instance();
+        if (pool.committedBytes() > 0) {
+            out << prefix << "_POOL_MODE: " << pool.modeName() << std::endl;
+            out << prefix << "_POOL_MB: " << megabytes(pool.committedBytes()) << std::endl;
+            out << prefix << "_POOL_HUGETLB_MB: " << megabytes(pool.hugeTlbBytes()) << std::endl;
+            out << prefix << "_POOL_REUSE_RATE: " << pool.reuseRate() << std::endl;
+        }
+    }
+
+private:
+    struct Step {
+        uint64_t peakRss = 0;
+        uint64_t peakHeap = 0;
+        uint64_t allocations = 0;
+        uint64_t faults = 0;
+    };
+
+    uint64_t foldResidentPeak() {
+        uint64_t hwm = residentBytes().first;
+        peakRss_ = std::max(peakRss_, hwm);
+        return hwm;
+    }
+
+    std::vector<std::string> order_;
+    std::map<std::string, Step> steps_;
+    std::string current_;
+    uint64_t peakRss_ = 0;
+    bool rssResettable_ = false;
+    uint64_t startAllocations_ = 0;
+    uint64_t startAllocatedBytes_ = 0;
+    uint64_t stepAllocations_ = 0;
+    std::pair<uint64_t, uint64_t> startFaults_;
+    std::pair<uint64_t, uint64_t> stepFaults_;
+};
+
+} // namespace mem
+
+#ifndef FHE_NO_MEMORY_HOOKS
+
+// Replacement allocation functions ([replacement.functions]); they take the
+// place of the library versions for the whole process.
+void* operator new(std::size_t size) { return mem::allocate(size); }
+void* operator new[](std::size_t size) { return mem::allocate(size); }
+void* operator new(std::size_t size, std::align_val_t align) { return mem::allocateAligned(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align) { return mem::allocateAligned(size, align); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try { return mem::allocate(size); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try { return mem::allocate(size); } catch (...) { return nullptr; }
+}
+void* operator new(std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    try { return mem::allocateAligned(size, align); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    try { return mem::allocateAligned(size, align); } catch (...) { return nullptr; }
+}
+
+void operator delete(void* p) noexcept { mem::release(p); }
+void operator delete[](void* p) noexcept { mem::release(p); }
+void operator delete(void* p, std::size_t) noexcept { mem::release(p); }
+void operator delete[](void* p, std::size_t) noexcept { mem::release(p); }
+void operator delete(void* p, std::align_val_t) noexcept { mem::release(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { mem::release(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { mem::release(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { mem::release(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { mem::release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { mem::release(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { mem::release(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { mem::release(p); }
+
+#endif // FHE_NO_MEMORY_HOOKS
+
+#endif // FHE_MEMORY_STATS_H
@@ -0,0 +1,173 @@
+//DECRYPTED RESULT OUTPUT : SLOT SELECTION AND COMPACT FORMATS
+//
+// fhe-dec reads the decoded packed slots as an int64 array (BGV) or a double
+// array (CKKS) and formats only the requested slots, instead of streaming the
+// whole Plaintext through operator<<.
+//
+// Formats:
+//   text    "( v0 v1 ... )", the layout Plaintext printing used before
+//   csv     "slot,value" per line, for columnar tools
+//   binary  32-byte little-endian header followed by the values:
+//             u32 magic 'FHER', u32 version (1: int64, 2: IEEE f64),
+//             u64 first slot, u64 step, u64 count
+
+#ifndef FHE_RESULT_OUTPUT_H
+#define FHE_RESULT_OUTPUT_H
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace result {
+
+enum class Format { Text, Csv, Binary };
+
+inline bool parseFormat(const std::string& s, Format& out) {
+    if (s == "text") out = Format::Text;
+    else if (s == "csv") out = Format::Csv;
+    else if (s == "binary") out = Format::Binary;
+    else return false;
+    return true;
+}
+
+inline const char* extension(Format f) {
+    switch (f) {
+        case Format::Csv: return ".csv";
+        case Format::Binary: return ".bin";
+        default: return ".txt";
+    }
+}
+
+// Half-open slot range [begin, end) taken every `step` slots; end == 0 means
+// "up to the last slot".
+struct SlotRange {
+    size_t begin = 0;
+    size_t end = 0;
+    size_t step = 1;
+
+    // "B:E" or "B:E:STEP", either bound may be empty ("":8, "16:")
+    static bool parse(const std::string& s, SlotRange& out) {
+        SlotRange r;
+        size_t c1 = s.find(':');
+        if (c1 == std::string::npos) return false;
+        size_t c2 = s.find(':', c1 + 1);
+        try {
+            std::string b = s.substr(0, c1);
+            std::string e = s.substr(c1 + 1, c2 == std::string::npos ? std::string::npos : c2 - c1 - 1);
+            if (!b.empty()) r.begin = std::stoul(b);
+            if (!e.empty()) r.end = std::stoul(e);
+            if (c2 != std::string::npos) r.step = std::stoul(s.substr(c2 + 1));
+        } catch (const std::exception&) {
+            return false;
+        }
+        if (r.step == 0 || (r.end != 0 && r.end <= r.begin)) return false;
+        out = r;
+        return true;
+    }
+
+    // Number of selected slots out of `available`
+    size_t count(size_t available) const {
+        size_t last = end == 0 ? available : std::min(end, available);
+        if (begin >= last) return 0;
+        return (last - begin + step - 1) / step;
+    }
+};
+
+namespace detail {
+
+inline void appendValue(std::string& out, int64_t v) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, res.ptr);
+}
+
+// 17 significant digits: reads back as the same double
+inline void appendValue(std::string& out, double v) {
+    char buf[32];
+    int n = std::snprintf(buf, sizeof(buf), "%.17g", v);
+    out.append(buf, static_cast<size_t>(n));
+}
+
+inline uint64_t bits(int64_t v) { return static_cast<uint64_t>(v); }
+
+inline uint64_t bits(double v) {
+    uint64_t b;
+    std::memcpy(&b, &v, sizeof(b));
+    return b;
+}
+
+template <typename T>
+inline void appendLE(std::string& out, T v) {
+    for (size_t i = 0; i < sizeof(T); i++) out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+}
+
+} // namespace detail
+
+// Format the selected slots of `values` into a single buffer ready to be written.
+template <typename T>
+inline std::string format(const std::vector<T>& values, const SlotRange& range, Format fmt) {
+    static_assert(std::is_same<T, int64_t>::value || std::is_same<T, double>::value, "int64 or double slots");
+    const size_t n = range.count(values.size());
+    std::string out;
+
+    switch (fmt) {
+    case Format::Binary: {
+        out.reserve(32 + n * sizeof(int64_t));
+        detail::appendLE<uint32_t>(out, 0x52454846u); // "FHER"
+        detail::appendLE<uint32_t>(out, std::is_same<T, double>::value ? 2 : 1);
+        detail::appendLE<uint64_t>(out, range.begin);
+        detail::appendLE<uint64_t>(out, range.step);
+        detail::appendLE<uint64_t>(out, n);
+        for (size_t i = 0; i < n; i++)
+            detail::appendLE<uint64_t>(out, detail::bits(values[range.begin + i * range.step]));
+        break;
+    }
+    case Format::Csv:
+        out.reserve(12 + n * 16);
+        out += "slot,value\n";
+        for (size_t i = 0; i < n; i++) {
+            size_t slot = range.begin + i * range.step;
+            detail::appendValue(out, static_cast<int64_t>(slot));
+            out.push_back(',');
+            detail::appendValue(out, values[slot]);
+            out.push_back('\n');
+        }
+        break;
+    case Format::Text:
+        out.reserve(8 + n * 8);
+        out += "( ";
+        for (size_t i = 0; i < n; i++) {
+            detail::appendValue(out, values[range.begin + i * range.step]);
+            out.push_back(' ');
+        }
+        out += "... )\n";
+        break;
+    }
+    return out;
+}
+
+// Console preview: at most `limit` selected slots, then how many were left out.
+template <typename T>
+inline void preview(std::ostream& os, const std::vector<T>& values, const SlotRange& range, size_t limit) {
+    const size_t n = range.count(values.size());
+    const size_t shown = std::min(n, limit);
+    std::string line = "( ";
+    for (size_t i = 0; i < shown; i++) {
+        detail::appendValue(line, values[range.begin + i * range.step]);
+        line.push_back(' ');
+    }
+    if (shown < n) line += "... " + std::to_string(n - shown) + " more ";
+    line += ")";
+    os << line;
+}
+
+} // namespace result
+
+#endif // FHE_RESULT_OUTPUT_H
@@ -0,0 +1,187 @@
+//SCHEME OF THE PIPELINE : EXACT BGV OR APPROXIMATE CKKS
+//
+// fhe-enc builds a BGV context unless told --scheme ckks. BGV computes exactly
+// on integers modulo the plaintext modulus, so real-valued features have to be
+// scaled to integers first, at the price of a large modulus and extra depth.
+// CKKS encodes real vectors directly, one value in each of ring dimension / 2
+// slots, and every product is rescaled by a scaling factor of scale_bits bits;
+// its results carry an error, which fhe-dec reports next to the timings.
+//
+// The scheme travels in config_params with the other parameters. A BGV config
+// is written exactly as before, so existing stored keysets keep their hashes;
+// a CKKS one adds:
+//
+//   scheme=ckks
+//   scaling=fixedmanual|fixedauto|flexibleauto|flexibleautoext
+//   scale_bits=N        bits of the scaling factor, also its modulus column
+//   first_mod_bits=N    bits of the first modulus, headroom of the result
+//   slots=N             packed slots, 0 for ring dimension / 2
+//
+// With fixedmanual fhe-main rescales every product itself; the other
+// techniques leave it to OpenFHE. Both inputs are fixed functions of the slot
+// index, so fhe-dec knows the exact result of the circuit and measures the
+// error of the decrypted one against it.
+
+#ifndef FHE_SCHEME_CONFIG_H
+#define FHE_SCHEME_CONFIG_H
+
+#include "openfhe.h"
+#include "param-grid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace scheme {
+
+enum class Kind { Bgv, Ckks };
+
+inline bool parseKind(const std::string& s, Kind& out) {
+    if (s == "bgv") out = Kind::Bgv;
+    else if (s == "ckks") out = Kind::Ckks;
+    else return false;
+    return true;
+}
+
+inline bool parseScaling(const std::string& s, lbcrypto::ScalingTechnique& out) {
+    if (s == "fixedmanual") out = lbcrypto::FIXEDMANUAL;
+    else if (s == "fixedauto") out = lbcrypto::FIXEDAUTO;
+    else if (s == "flexibleauto") out = lbcrypto::FLEXIBLEAUTO;
+    else if (s == "flexibleautoext") out = lbcrypto::FLEXIBLEAUTOEXT;
+    else return false;
+    return true;
+}
+
+inline const char* scalingName(lbcrypto::ScalingTechnique t) {
+    switch (t) {
+        case lbcrypto::FIXEDMANUAL: return "fixedmanual";
+        case lbcrypto::FIXEDAUTO: return "fixedauto";
+        case lbcrypto::FLEXIBLEAUTOEXT: return "flexibleautoext";
+        default: return "flexibleauto";
+    }
+}
+
+struct Config {
+    Kind kind = Kind::Bgv;
+    lbcrypto::ScalingTechnique scaling = lbcrypto::FLEXIBLEAUTO;
+    int scaleBits = 50;
+    int firstModBits = 60;
+    int slots = 0;
+
+    bool ckks() const { return kind == Kind::Ckks; }
+
+    // The products have to be rescaled by the circuit itself
+    bool manualRescale() const { return ckks() && scaling == lbcrypto::FIXEDMANUAL; }
+
+    // Lines added to config_params; none for BGV
+    std::string text() const {
+        if (!ckks()) return "";
+        std::ostringstream out;
+        out << "scheme=ckks" << std::endl;
+        out << "scaling=" << scalingName(scaling) << std::endl;
+        out << "scale_bits=" << scaleBits << std::endl;
+        out << "first_mod_bits=" << firstModBits << std::endl;
+        out << "slots=" << slots << std::endl;
+        return out.str();
+    }
+
+    // Take one key=value line of config_params; false if the key is not ours
+    bool set(const std::string& key, const std::string& value) {
+        try {
+            if (key == "scheme") parseKind(value, kind);
+            else if (key == "scaling") parseScaling(value, scaling);
+            else if (key == "scale_bits") scaleBits = std::stoi(value);
+            else if (key == "first_mod_bits") firstModBits = std::stoi(value);
+            else if (key == "slots") slots = std::stoi(value);
+            else return false;
+        } catch (const std::exception&) {
+        }
+        return true;
+    }
+
+    // Slots the values are packed in: all of them unless slots= says otherwise
+    size_t slotCount(const lbcrypto::CryptoContext<lbcrypto::DCRTPoly>& cc) const {
+        return slots > 0 ? static_cast<size_t>(slots) : cc->GetRingDimension() / 2;
+    }
+
+    // CSV files of CKKS runs are kept apart from the BGV ones, as their modulus
+    // column holds scale_bits and they have more columns
+    std::string csvFile(const std::string& name) const { return ckks() ? "ckks_" + name : name; }
+
+    void appendColumns(std::vector<std::pair<std::string, double>>& columns, size_t slotCount) const {
+        if (!ckks()) return;
+        columns.emplace_back("scaling", static_cast<double>(scaling));
+        columns.emplace_back("first_mod_bits", firstModBits);
+        columns.emplace_back("slots", static_cast<double>(slotCount));
+    }
+};
+
+// The CKKS cryptocontext fhe-enc generates for these parameters
+inline lbcrypto::CryptoContext<lbcrypto::DCRTPoly> generateCkksContext(int depth, int security, const Config& config) {
+    lbcrypto::CCParams<lbcrypto::CryptoContextCKKSRNS> parameters;
+    parameters.SetMultiplicativeDepth(depth);
+    parameters.SetScalingModSize(config.scaleBits);
+    parameters.SetFirstModSize(config.firstModBits);
+    parameters.SetScalingTechnique(config.scaling);
+    parameters.SetSecurityLevel(securityLevel(security));
+    if (config.slots > 0) parameters.SetBatchSize(config.slots);
+
+    lbcrypto::CryptoContext<lbcrypto::DCRTPoly> cc = lbcrypto::GenCryptoContext(parameters);
+    cc->Enable(lbcrypto::PKE);
+    cc->Enable(lbcrypto::KEYSWITCH);
+    cc->Enable(lbcrypto::LEVELEDSHE);
+    return cc;
+}
+
+// Input vectors of fhe-enc: a signal in [-1, 1] and a factor close to 1, so
+// that the product stays in range at any depth
+inline std::vector<double> input(int which, size_t slots) {
+    std::vector<double> values(slots);
+    for (size_t i = 0; i < slots; i++) {
+        values[i] = which == 1 ? std::sin(0.1 * i) : 1 + 0.01 * std::cos(0.1 * i);
+    }
+    return values;
+}
+
+// What fhe-main computes from them: the sum of `width` lanes, each
+// input1 * input2^depth
+inline std::vector<double> expected(int depth, int width, size_t slots) {
+    std::vector<double> x1 = input(1, slots), x2 = input(2, slots);
+    std::vector<double> values(slots);
+    for (size_t i = 0; i < slots; i++) values[i] = width * x1[i] * std::pow(x2[i], depth);
+    return values;
+}
+
+struct Accuracy {
+    double maxError = 0;
+    double meanError = 0;
+    size_t slots = 0;
+
+    // Bits of the result that are right: -log2 of the largest error, at most
+    // the 52 a double holds
+    double precisionBits() const { return bits(maxError); }
+    double meanPrecisionBits() const { return bits(meanError); }
+
+    static double bits(double error) { return error > 0 ? std::min(52.0, -std::log2(error)) : 52.0; }
+};
+
+inline Accuracy compare(const std::vector<double>& values, const std::vector<double>& exact) {
+    Accuracy a;
+    a.slots = std::min(values.size(), exact.size());
+    double sum = 0;
+    for (size_t i = 0; i < a.slots; i++) {
+        double e = std::fabs(values[i] - exact[i]);
+        a.maxError = std::max(a.maxError, e);
+        sum += e;
+    }
+    a.meanError = a.slots ? sum / a.slots : 0;
+    return a;
+}
+
+} // namespace scheme
+
+#endif // FHE_SCHEME_CONFIG_H
@@ -0,0 +1,146 @@
+//CONTENT-ADDRESSED ARTIFACT STORE : LISTING AND GARBAGE COLLECTION
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "artifact-store.h"
+
+namespace fs = std::filesystem;
+
+const std::string STOREFOLDER = "store";
+
+// Age of a file in seconds, by modification time
+double ageSeconds(const fs::path& path) {
+    std::error_code ec;
+    auto mtime = fs::last_write_time(path, ec);
+    if (ec) return 0;
+    return std::chrono::duration<double>(fs::file_time_type::clock::now() - mtime).count();
+}
+
+// Whether a refs file name is a writer's temporary file, not yet renamed
+bool inFlight(const std::string& name) {
+    return name.find(".tmp.") != std::string::npos;
+}
+
+// Hashes referenced by every job and keyset still present. A refs file that
+// is there but cannot be read or parsed fails the whole listing: its objects
+// may well be live, and gc must not remove what it cannot prove dead.
+// Temporary refs files still being written are passed over; the objects they
+// name were published just before and are kept by the grace period.
+bool liveObjects(const ArtifactStore& store, std::set<std::string>& live) {
+    for (const char* kind : {"jobs", "keysets"}) {
+        for (const auto& entry : fs::directory_iterator(store.root() + "/" + kind)) {
+            std::string name = entry.path().filename().string();
+            if (inFlight(name)) continue;
+            ArtifactRefs refs;
+            if (!store.readRefs(kind, name, refs)) {
+                std::error_code ec;
+                if (!fs::exists(entry.path(), ec) && !ec) continue;  // removed since listed
+                std::cerr << "Error: cannot read " << kind << "/" << name << ", not collecting" << std::endl;
+                return false;
+            }
+            for (const auto& [file, ref] : refs.refs) live.insert(ref.hash);
+        }
+    }
+    return true;
+}
+
+int list(const ArtifactStore& store) {
+    uint64_t objects = 0, bytes = 0;
+    for (const auto& entry : fs::recursive_directory_iterator(store.root() + "/objects")) {
+        if (!entry.is_regular_file()) continue;
+        objects++;
+        bytes += entry.file_size();
+    }
+    std::cout << "objects: " << objects << " (" << bytes << " bytes)" << std::endl;
+
+    for (const char* kind : {"keysets", "jobs"}) {
+        for (const auto& entry : fs::directory_iterator(store.root() + "/" + kind)) {
+            ArtifactRefs refs;
+            if (!store.readRefs(kind, entry.path().filename().string(), refs)) continue;
+            std::cout << kind << "/" << entry.path().filename().string() << std::endl;
+            for (const auto& [name, ref] : refs.refs) {
+                std::cout << "  " << name << " " << ref.hash.substr(0, 16) << " " << ref.size << std::endl;
+            }
+        }
+    }
+    return 0;
+}
+
+int collect(const ArtifactStore& store, double grace, double maxJobAge) {
+    uint64_t jobsRemoved = 0, objectsRemoved = 0, bytesFreed = 0;
+
+    // Jobs past their maximum age are dropped first, so their objects can go too
+    if (maxJobAge > 0) {
+        std::vector<fs::path> expired;
+        for (const auto& entry : fs::directory_iterator(store.root() + "/jobs")) {
+            if (ageSeconds(entry.path()) > maxJobAge) expired.push_back(entry.path());
+        }
+        for (const auto& path : expired) {
+            if (fs::remove(path)) jobsRemoved++;
+        }
+    }
+
+    // Objects younger than the grace period may belong to a job whose
+    // references are not written yet, as may leftover temporary files
+    std::set<std::string> live;
+    if (!liveObjects(store, live)) return 1;
+    std::vector<std::pair<fs::path, uint64_t>> dead;
+    for (const auto& entry : fs::recursive_directory_iterator(store.root() + "/objects")) {
+        if (!entry.is_regular_file()) continue;
+        std::string name = entry.path().filename().string();
+        if (live.count(name) || ageSeconds(entry.path()) < grace) continue;
+        dead.emplace_back(entry.path(), entry.file_size());
+    }
+    for (const auto& [path, size] : dead) {
+        if (fs::remove(path)) {
+            objectsRemoved++;
+            bytesFreed += size;
+        }
+    }
+
+    std::cout << "Removed " << jobsRemoved << " jobs and " << objectsRemoved << " objects, freed "
+              << bytesFreed << " bytes." << std::endl;
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string command = argc > 1 ? argv[1] : "";
+    double grace = 3600;
+    double maxJobAge = 0;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--grace" && i + 1 < argc) {
+            grace = std::stod(argv[++i]);
+        } else if (arg == "--max-job-age" && i + 1 < argc) {
+            maxJobAge = std::stod(argv[++i]);
+        }
+    }
+
+    if (command != "ls" && command != "gc") {
+        std::cout << "Usage: " << argv[0] << " ls|gc [OPTIONS]\n"
+                  << "  ls                  List stored objects, keysets and jobs\n"
+                  << "  gc                  Remove objects no job or keyset refers to\n"
+                  << "Options:\n"
+                  << "  --grace S           Keep unreferenced objects younger than S seconds (default: 3600)\n"
+                  << "  --max-job-age S     Also forget jobs older than S seconds (default: never)\n";
+        return command.empty() || command == "--help" ? 0 : 1;
+    }
+
+    AsyncIO io;
+    ArtifactStore store(io, STOREFOLDER);
+    try {
+        return command == "ls" ? list(store) : collect(store, grace, maxJobAge);
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -4,6 +4,7 @@
 import subprocess
 import time
 import csv
+import json
 import os
 import sys
 import pandas as pd
@@ -18,6 +19,31 @@ logger.configure(handlers=[
     {"sink": "test_results.txt", "format": "{time:YYYY-MM-DD HH:mm:ss.SSS} | {message}", "rotation": "10 MB", "mode": "a"}
 ])
 
+# Extra fhe-dec options, e.g. "--format binary --slots 0:1024 --print 8"
+DEC_ARGS = os.environ.get("FHE_DEC_ARGS", "")
+
+# Extra fhe-main options, e.g. "--split-relin --repeat 5" for per-level EvalMult
+# histograms with the key switch timed apart
+MAIN_ARGS = os.environ.get("FHE_MAIN_ARGS", "")
+
+# With FHE_STORE=1 artifacts go to the content-addressed store, one keyset per
+# parameter set is generated once and reused, and the store survives cleaning
+USE_STORE = os.environ.get("FHE_STORE", "0") == "1"
+STORE_JOB = "tests"
+
+# FHE_* settings of this shell (FHE_IO, FHE_PROFILE, ...) are passed on to the binaries
+DOCKER_ENV = "".join(f" -e {k}={v}" for k, v in os.environ.items()
+                     if k.startswith("FHE_") and k not in ("FHE_DEC_ARGS", "FHE_MAIN_ARGS", "FHE_STORE"))
+
+def store_args(keyset=None):
+    """Store options for fhe-enc (with a keyset), fhe-main and fhe-dec"""
+    if not USE_STORE:
+        return ""
+    args = f" --store --job {STORE_JOB}"
+    if keyset:
+        args += f" --keyset {keyset}"
+    return args
+
 
 def run_command(cmd, printer=True):
     commands = cmd.split(',')
@@ -50,9 +76,11 @@ def start_docker_services():
 def clean_test_environment():
     """Clean the test environment"""
     print("\nCleaning test environment...")
+    # Stored keysets keep their secret keys on the private volume
+    private = "" if USE_STORE else "/bdt/build/private_data/* "
     try:
-        run_command("""
-            sudo docker exec acc-aio sh -c "rm -rf /bdt/build/data/* /bdt/build/results/* /bdt/build/private_data/* /bdt/build/cryptocontext/* /bdt/build/dec_results/*" && \\
+        run_command(f"""
+            sudo docker exec acc-aio sh -c "rm -rf /bdt/build/data/* /bdt/build/results/* {private}/bdt/build/cryptocontext/* /bdt/build/dec_results/*" && \\
             echo "Cleaning volumes done!" && \\
             echo "============ Results ===============" && \\
             sudo docker exec acc-aio ls /bdt/build/results/ /bdt/build/private_data/ /bdt/build/cryptocontext/ || true && \\
@@ -111,32 +139,33 @@ def get_file_sizes():
 def run_encryption(security, depth, modulus):
     """Run encryption with specified parameters"""
     print("Running FHE encryption...")
-    run_command(f"sudo docker exec acc-aio ./fhe-enc --security {security} --depth {depth} --modulus {modulus}")
+    keyset = f"bgv-d{depth}-m{modulus}-s{security}"
+    run_command(f"sudo docker exec{DOCKER_ENV} acc-aio ./fhe-enc --security {security} --depth {depth} --modulus {modulus}{store_args(keyset)}")
     print("Encryption completed")
 
 def run_main_computation_old():
     """Run main computation"""
     print("Running FHE main...")
-    run_command("sudo docker exec acc-aio ./fhe-main")
+    run_command(f"sudo docker exec{DOCKER_ENV} acc-aio ./fhe-main")
     print("Main computation completed")
 
 def run_main_computation(gpu_params=None):
     """Run main computation with optional GPU parameters"""
     print("Running FHE main...")
     print("=============================")
-    cmd = "sudo docker exec acc-aio ./fhe-main"
-    # If GPU parameters are provided, add them as command-line arguments
+    cmd = f"sudo docker exec{DOCKER_ENV} acc-aio ./fhe-main"
+    # If GPU parameters are provided, pass them as --gpu B:T:S:R:P:Q:Y
     if gpu_params:
-        params_str = " ".join(str(param) for param in gpu_params)
-        cmd = f"sudo docker exec acc-aio ./fhe-main {params_str}"
-    run_command(cmd)
+        params_str = ":".join(str(param) for param in gpu_params)
+        cmd = f"sudo docker exec{DOCKER_ENV} acc-aio ./fhe-main --gpu {params_str}"
+    run_command(f"{cmd} {MAIN_ARGS}{store_args()}")
     print("Main computation completed")
 
 
 def run_decryption():
     """Run decryption"""
     print("Running FHE decryption...")
-    result = run_command("sudo docker exec acc-aio ./fhe-dec")
+    result = run_command(f"sudo docker exec{DOCKER_ENV} acc-aio ./fhe-dec {DEC_ARGS}{store_args()}")
     print("Decryption completed")
     return result
 
@@ -146,7 +175,14 @@ def copy_csv_files_from_container():
         # Copy CSV files from container to host
         run_command("sudo docker cp acc-aio:/bdt/build/enc_timing_results.csv ./enc_timing_results.csv")
         run_command("sudo docker cp acc-aio:/bdt/build/main_timing_results.csv ./main_timing_results.csv") 
+        run_command("sudo docker cp acc-aio:/bdt/build/main_op_levels.csv ./main_op_levels.csv")
         run_command("sudo docker cp acc-aio:/bdt/build/dec_timing_results.csv ./dec_timing_results.csv")
+        # Span profiles only exist when FHE_PROFILE was set
+        if os.environ.get("FHE_PROFILE", "0") not in ("", "0"):
+            run_command("sudo docker cp acc-aio:/bdt/build/profile_spans.csv ./profile_spans.csv")
+        # FHE_TRACE=1 makes every binary append to one Chrome trace timeline
+        if os.environ.get("FHE_TRACE", "0") == "1":
+            run_command("sudo docker cp acc-aio:/bdt/build/fhe_trace.json ./fhe_trace.json")
         print("CSV files copied from container successfully")
     except Exception as e:
         logger.error(f"Failed to copy CSV files: {str(e)}")
@@ -209,14 +245,23 @@ def consolidate_timing_data():
                 'enc_encrypt_time': row.get('encrypt_time', ''),
                 'enc_serialize_time': row.get('serialize_time', ''),
                 'enc_total_time': row.get('total_time', ''),
+                'enc_io_wait_time': row.get('io_wait_time', ''),
+                'enc_peak_rss_mb': row.get('peak_rss_mb', ''),
+                'enc_peak_heap_mb': row.get('peak_heap_mb', ''),
                 'main_deserialize_time': '',
                 'main_computation_time': '',
                 'main_serialize_time': '',
                 'main_total_time': '',
+                'main_io_wait_time': '',
+                'main_peak_rss_mb': '',
+                'main_peak_heap_mb': '',
                 'dec_deserialize_time': '',
                 'dec_decrypt_time': '',
                 'dec_save_time': '',
-                'dec_total_time': ''
+                'dec_total_time': '',
+                'dec_io_wait_time': '',
+                'dec_peak_rss_mb': '',
+                'dec_peak_heap_mb': ''
             }
             consolidated_data.append(consolidated_row)
         
@@ -233,14 +278,23 @@ def consolidate_timing_data():
                 'enc_encrypt_time': '',
                 'enc_serialize_time': '',
                 'enc_total_time': '',
+                'enc_io_wait_time': '',
+                'enc_peak_rss_mb': '',
+                'enc_peak_heap_mb': '',
                 'main_deserialize_time': row.get('deserialize_time', ''),
                 'main_computation_time': row.get('computation_time', ''),
                 'main_serialize_time': row.get('serialize_time', ''),
                 'main_total_time': row.get('total_time', ''),
+                'main_io_wait_time': row.get('io_wait_time', ''),
+                'main_peak_rss_mb': row.get('peak_rss_mb', ''),
+                'main_peak_heap_mb': row.get('peak_heap_mb', ''),
                 'dec_deserialize_time': '',
                 'dec_decrypt_time': '',
                 'dec_save_time': '',
-                'dec_total_time': ''
+                'dec_total_time': '',
+                'dec_io_wait_time': '',
+                'dec_peak_rss_mb': '',
+                'dec_peak_heap_mb': ''
             }
             consolidated_data.append(consolidated_row)
         
@@ -257,14 +311,23 @@ def consolidate_timing_data():
                 'enc_encrypt_time': '',
                 'enc_serialize_time': '',
                 'enc_total_time': '',
+                'enc_io_wait_time': '',
+                'enc_peak_rss_mb': '',
+                'enc_peak_heap_mb': '',
                 'main_deserialize_time': '',
                 'main_computation_time': '',
                 'main_serialize_time': '',
                 'main_total_time': '',
+                'main_io_wait_time': '',
+                'main_peak_rss_mb': '',
+                'main_peak_heap_mb': '',
                 'dec_deserialize_time': row.get('deserialize_time', ''),
                 'dec_decrypt_time': row.get('decrypt_time', ''),
                 'dec_save_time': row.get('save_time', ''),
-                'dec_total_time': row.get('total_time', '')
+                'dec_total_time': row.get('total_time', ''),
+                'dec_io_wait_time': row.get('io_wait_time', ''),
+                'dec_peak_rss_mb': row.get('peak_rss_mb', ''),
+                'dec_peak_heap_mb': row.get('peak_heap_mb', '')
             }
             consolidated_data.append(consolidated_row)
         
@@ -274,8 +337,11 @@ def consolidate_timing_data():
                 fieldnames = [
                     'timestamp', 'phase', 'depth', 'modulus', 'security',
                     'enc_context_time', 'enc_keygen_time', 'enc_encrypt_time', 'enc_serialize_time', 'enc_total_time',
+                    'enc_io_wait_time', 'enc_peak_rss_mb', 'enc_peak_heap_mb',
                     'main_deserialize_time', 'main_computation_time', 'main_serialize_time', 'main_total_time',
-                    'dec_deserialize_time', 'dec_decrypt_time', 'dec_save_time', 'dec_total_time'
+                    'main_io_wait_time', 'main_peak_rss_mb', 'main_peak_heap_mb',
+                    'dec_deserialize_time', 'dec_decrypt_time', 'dec_save_time', 'dec_total_time',
+                    'dec_io_wait_time', 'dec_peak_rss_mb', 'dec_peak_heap_mb'
                 ]
                 writer = csv.DictWriter(f, fieldnames=fieldnames)
                 writer.writeheader()
@@ -567,5 +633,263 @@ def run_tests():
     print("- main_timing_results.csv: Main computation timing data")
     print("- dec_timing_results.csv: Decryption timing data")
 
+def run_benchmarks():
+    """Run the fhe-bench micro-benchmarks over the tests.csv grid"""
+    start_docker_services()
+    print("\nRunning FHE micro-benchmarks...")
+    print("=============================")
+
+    # Extra arguments go to Google Benchmark, e.g. --benchmark_filter=EvalMult
+    bench_args = " ".join(sys.argv[2:])
+    run_command("sudo docker cp tests.csv acc-aio:/bdt/build/tests.csv")
+    run_command(f"sudo docker exec{DOCKER_ENV} acc-aio ./fhe-bench --grid tests.csv {bench_args}")
+    run_command("sudo docker cp acc-aio:/bdt/build/bench_results.json ./bench_results.json")
+    print("Benchmark results saved to bench_results.json")
+
+def run_sweep():
+    """Sweep the tests.csv grid in one process with fhe-sweep"""
+    start_docker_services()
+    print("\nRunning in-process parameter sweep...")
+    print("=============================")
+
+    # Extra arguments go to fhe-sweep, e.g. --ci 0.05 --max-runs 10
+    sweep_args = " ".join(sys.argv[2:])
+    run_command("sudo docker cp tests.csv acc-aio:/bdt/build/tests.csv")
+    run_command("sudo docker exec acc-aio rm -f /bdt/build/sweep_results.csv")
+    run_command(f"sudo docker exec{DOCKER_ENV} acc-aio ./fhe-sweep --grid tests.csv {sweep_args}")
+    run_command("sudo docker cp acc-aio:/bdt/build/sweep_results.csv ./sweep_results.csv")
+    print("Sweep results saved to sweep_results.csv")
+
+def run_scaling():
+    """Measure every phase of the tests.csv grid at 1, 2, 4 ... all cores"""
+    start_docker_services()
+    print("\nRunning core-count scaling sweep...")
+    print("=============================")
+
+    # Extra arguments go to fhe-sweep, e.g. --threads 1,2,4,8 --min-gain 0.1
+    scale_args = " ".join(sys.argv[2:])
+    run_command("sudo docker cp tests.csv acc-aio:/bdt/build/tests.csv")
+    run_command("sudo docker exec acc-aio rm -f /bdt/build/sweep_results.csv /bdt/build/scaling_results.csv")
+    run_command(f"sudo docker exec{DOCKER_ENV} acc-aio ./fhe-sweep --grid tests.csv --threads max {scale_args}")
+    run_command("sudo docker cp acc-aio:/bdt/build/sweep_results.csv ./sweep_results.csv")
+    run_command("sudo docker cp acc-aio:/bdt/build/scaling_results.csv ./scaling_results.csv")
+    print("Speedup, efficiency and knee per phase saved to scaling_results.csv")
+
+def run_sharding():
+    """Evaluate one job split into shards on 1, 2, 4 ... fhe-main workers"""
+    shards = 8
+    worker_counts = [1, 2, 4]
+    args = sys.argv[2:]
+    for i, arg in enumerate(args):
+        if arg == "--shards" and i + 1 < len(args):
+            shards = int(args[i + 1])
+        elif arg == "--workers" and i + 1 < len(args):
+            worker_counts = [int(n) for n in args[i + 1].split(",")]
+
+    # The first parameter set of tests.csv
+    with open('tests.csv', 'r') as f:
+        reader = csv.reader(f)
+        next(reader)
+        row = next(reader)
+    depth, security, modulus = int(row[1]), int(row[2]), int(row[3].split(',')[0])
+
+    start_docker_services()
+    print(f"\nEvaluating {shards} shards on {worker_counts} workers...")
+    print("=============================")
+
+    # Every shard is its own stored job, encrypted under one shared keyset
+    keyset = f"bgv-d{depth}-m{modulus}-s{security}"
+    for shard in range(shards):
+        run_command(f"sudo docker exec{DOCKER_ENV} acc-aio ./fhe-enc --security {security} --depth {depth} "
+                    f"--modulus {modulus} --store --job shard.{shard} --keyset {keyset}")
+    run_command("sudo docker exec acc-aio rm -f /bdt/build/shard_timing_results.csv")
+    for workers in worker_counts:
+        run_command(f"sudo docker exec{DOCKER_ENV} acc-aio ./fhe-shard --job shard --workers {workers}")
+    run_command(f"sudo docker exec{DOCKER_ENV} acc-aio ./fhe-dec --store --job shard")
+    run_command("sudo docker cp acc-aio:/bdt/build/shard_timing_results.csv ./shard_timing_results.csv")
+    print("Latency and worker memory per worker count saved to shard_timing_results.csv")
+
+def run_mixed_load():
+    """Serve a burst of short interactive jobs mixed with long batch jobs, in
+    arrival order and earliest deadline first, and compare short-job latency"""
+    jobs = 200
+    long_every = 10
+    args = sys.argv[2:]
+    for i, arg in enumerate(args):
+        if arg == "--jobs" and i + 1 < len(args):
+            jobs = int(args[i + 1])
+        elif arg == "--long-every" and i + 1 < len(args):
+            long_every = int(args[i + 1])
+
+    # Short jobs at depth 1, long ones at the deepest depth of tests.csv
+    with open('tests.csv', 'r') as f:
+        reader = csv.reader(f)
+        next(reader)
+        rows = list(reader)
+    security, modulus = int(rows[0][2]), int(rows[0][3].split(',')[0])
+    long_depth = max(int(row[1]) for row in rows)
+
+    start_docker_services()
+    print(f"\nServing {jobs} jobs, one in {long_every} at depth {long_depth}...")
+    print("=============================")
+    for job, depth in (("short", 1), ("long", long_depth)):
+        keyset = f"bgv-d{depth}-m{modulus}-s{security}"
+        run_command(f"sudo docker exec{DOCKER_ENV} acc-aio ./fhe-enc --security {security} --depth {depth} "
+                    f"--modulus {modulus} --store --job {job} --keyset {keyset}")
+    with open("mixed_jobs.txt", "w") as f:
+        for i in range(jobs):
+            f.write("long class=batch\n" if i % long_every == 0 else "short class=interactive\n")
+    run_command("sudo docker cp mixed_jobs.txt acc-aio:/bdt/build/mixed_jobs.txt")
+
+    results = {}
+    for order in ("fifo", "edf"):
+        output = run_command(f"sudo docker exec{DOCKER_ENV} acc-aio sh -c "
+                             f"'./fhe-main --serve --sched {order} --queue-cap {jobs} < mixed_jobs.txt'")
+        results[order] = {}
+        for line in output.splitlines():
+            if line.startswith("MAIN_SCHED_") and ": " in line:
+                key, value = line.split(": ", 1)
+                results[order][key[len("MAIN_SCHED_"):].lower()] = value
+
+    print(f"{'order':<6} {'short p50 ms':>13} {'short p99 ms':>13} {'long p99 ms':>13} {'rejected':>9}")
+    for order, r in results.items():
+        print(f"{order:<6} {r.get('interactive_p50_ms', '-'):>13} {r.get('interactive_p99_ms', '-'):>13} "
+              f"{r.get('batch_p99_ms', '-'):>13} {r.get('rejected', '-'):>9}")
+
+def run_allocators():
+    """Run the EvalMultChain benchmark under each FHE_POOL allocator setting and
+    compare EvalMult latency and the memory the allocator holds unused"""
+    start_docker_services()
+    print("\nComparing allocators on EvalMult chains...")
+    print("=============================")
+
+    bench_args = " ".join(sys.argv[2:])
+    run_command("sudo docker cp tests.csv acc-aio:/bdt/build/tests.csv")
+    results = {}
+    for pool in ("off", "thp", "hugetlb"):
+        out = f"bench_pool_{pool}.json"
+        run_command(f"sudo docker exec{DOCKER_ENV} -e FHE_POOL={pool} acc-aio ./fhe-bench --grid tests.csv "
+                    f"--benchmark_filter=EvalMultChain --benchmark_out={out} {bench_args}")
+        run_command(f"sudo docker cp acc-aio:/bdt/build/{out} ./{out}")
+        with open(out) as f:
+            for b in json.load(f)["benchmarks"]:
+                if b.get("aggregate_name") == "median":
+                    results[(b["run_name"], pool)] = b
+
+    print(f"{'benchmark':<32} {'pool':<8} {'ms':>10} {'rss MB':>9} {'frag MB':>9} {'reuse':>6}")
+    for (name, pool), b in sorted(results.items()):
+        print(f"{name:<32} {pool:<8} {b['real_time']:>10.2f} {b.get('rss_mb', 0):>9.1f} "
+              f"{b.get('frag_mb', 0):>9.1f} {b.get('pool_reuse', 0):>6.2f}")
+    print("Results saved to bench_pool_off.json, bench_pool_thp.json and bench_pool_hugetlb.json")
+
+def run_release_profile():
+    """Rebuild OpenFHE and the binaries as the Debug images had them, then with
+    the release profile trained by PGO on tests.csv, and compare every phase"""
+    start_docker_services()
+    print("\nComparing the Debug build with the PGO release build...")
+    print("=============================")
+
+    # Extra arguments go to fhe-sweep, e.g. --max-runs 10
+    sweep_args = " ".join(sys.argv[2:])
+    run_command("sudo docker cp tests.csv acc-aio:/bdt/build/tests.csv")
+    sweeps = {}
+    for profile in ("debug", "pgo"):
+        out = f"sweep_{profile}.csv"
+        run_command(f"sudo docker exec acc-aio sh -c 'cd /bdt/build && ../build-profile.sh {profile} tests.csv'")
+        run_command(f"sudo docker exec acc-aio rm -f /bdt/build/{out}")
+        run_command(f"sudo docker exec{DOCKER_ENV} acc-aio ./fhe-sweep --grid tests.csv --output {out} {sweep_args}")
+        run_command(f"sudo docker cp acc-aio:/bdt/build/{out} ./{out}")
+        sweeps[profile] = pd.read_csv(out)
+
+    keys = ["depth", "modulus", "security", "metric"]
+    merged = pd.merge(sweeps["debug"][keys + ["median"]], sweeps["pgo"][keys + ["median"]],
+                      on=keys, suffixes=("_debug", "_pgo"))
+    merged["speedup"] = merged["median_debug"] / merged["median_pgo"]
+    merged.to_csv("release_speedup.csv", index=False)
+
+    print(f"{'phase':<24} {'min':>7} {'median':>7} {'max':>7}")
+    for metric, group in merged.groupby("metric", sort=False):
+        print(f"{metric:<24} {group['speedup'].min():>6.2f}x {group['speedup'].median():>6.2f}x "
+              f"{group['speedup'].max():>6.2f}x")
+    print("Per-configuration speedup of the PGO release build saved to release_speedup.csv")
+
+def run_ckks():
+    """Run the pipeline under BGV and under CKKS for every depth and security
+    level of tests.csv, and put CKKS's precision next to the times of both"""
+    scalings = ["flexibleauto", "fixedmanual"]
+    scale_bits = 50
+    args = sys.argv[2:]
+    for i, arg in enumerate(args):
+        if arg == "--scaling" and i + 1 < len(args):
+            scalings = args[i + 1].split(":")
+        elif arg == "--scale-bits" and i + 1 < len(args):
+            scale_bits = int(args[i + 1])
+
+    # One BGV modulus per depth and security level, the first tests.csv lists
+    configs = {}
+    with open('tests.csv', 'r', encoding='utf-8-sig') as f:
+        for row in csv.DictReader(f):
+            configs.setdefault((int(row["depth"]), int(row["security"])), int(row["modulus"].split(',')[0]))
+
+    start_docker_services()
+    print(f"\nComparing BGV with CKKS ({' and '.join(scalings)}, {scale_bits}-bit scale)...")
+    print("=============================")
+
+    runs = [("bgv", None)] + [("ckks", scaling) for scaling in scalings]
+    results = []
+    for (depth, security), modulus in configs.items():
+        for scheme, scaling in runs:
+            if scheme == "bgv":
+                scheme_args = f"--modulus {modulus}"
+            else:
+                scheme_args = f"--scheme ckks --scaling {scaling} --scale-bits {scale_bits}"
+            run_command("sudo docker exec acc-aio sh -c 'rm -rf /bdt/build/data/* /bdt/build/cryptocontext/* "
+                        "/bdt/build/private_data/* /bdt/build/results/*'")
+            output = run_command(f"sudo docker exec{DOCKER_ENV} acc-aio ./fhe-enc --security {security} --depth {depth} {scheme_args}")
+            sizes = get_file_sizes()
+            output += run_command(f"sudo docker exec{DOCKER_ENV} acc-aio ./fhe-main {MAIN_ARGS}")
+            output += run_command(f"sudo docker exec{DOCKER_ENV} acc-aio ./fhe-dec --print 0")
+            values = dict(line.split(": ", 1) for line in output.splitlines()
+                          if line.startswith(("ENC_", "MAIN_", "DEC_")) and ": " in line)
+            results.append({
+                "depth": depth, "security": security, "scheme": scheme, "scaling": scaling or "",
+                "modulus": modulus if scheme == "bgv" else scale_bits,
+                "slots": values.get("ENC_SLOTS", ""),
+                "enc_time": values.get("ENC_TOTAL_TIME", ""),
+                "computation_time": values.get("MAIN_COMPUTATION_TIME", ""),
+                "decrypt_time": values.get("DEC_DECRYPT_TIME", ""),
+                "ciphertext_bytes": sizes["enc1_size"],
+                "eval_key_bytes": sizes["eval_size"],
+                "max_abs_error": values.get("DEC_MAX_ABS_ERROR", ""),
+                "precision_bits": values.get("DEC_PRECISION_BITS", ""),
+            })
+            logger.info(f"{scheme} {scaling or ''} d{depth} s{security}: "
+                        f"computation {results[-1]['computation_time']}s precision {results[-1]['precision_bits'] or '-'} bits")
+
+    pd.DataFrame(results).to_csv("ckks_comparison.csv", index=False)
+    print(f"{'depth':>5} {'sec':>4} {'scheme':<18} {'compute s':>10} {'ct bytes':>10} {'bits':>6}")
+    for r in results:
+        name = r["scheme"] + (f" {r['scaling']}" if r["scaling"] else "")
+        print(f"{r['depth']:>5} {r['security']:>4} {name:<18} {r['computation_time']:>10} "
+              f"{r['ciphertext_bytes']:>10} {r['precision_bits'] or 'exact':>6}")
+    print("Times, sizes and CKKS precision per configuration saved to ckks_comparison.csv")
+
 if __name__ == "__main__":
-    run_tests()
+    if len(sys.argv) > 1 and sys.argv[1] == "bench":
+        run_benchmarks()
+    elif len(sys.argv) > 1 and sys.argv[1] == "sweep":
+        run_sweep()
+    elif len(sys.argv) > 1 and sys.argv[1] == "scale":
+        run_scaling()
+    elif len(sys.argv) > 1 and sys.argv[1] == "shard":
+        run_sharding()
+    elif len(sys.argv) > 1 and sys.argv[1] == "mixed":
+        run_mixed_load()
+    elif len(sys.argv) > 1 and sys.argv[1] == "pool":
+        run_allocators()
+    elif len(sys.argv) > 1 and sys.argv[1] == "release":
+        run_release_profile()
+    elif len(sys.argv) > 1 and sys.argv[1] == "ckks":
+        run_ckks()
+    else:
+        run_tests()
@@ -0,0 +1,647 @@
+//ARTIFACT STREAMING BETWEEN THE ENC, MAIN AND DEC CONTAINERS
+//
+// Instead of writing every artifact to a shared volume and re-reading it on the
+// other side, fhe-enc streams them to fhe-main, and fhe-main streams the result
+// to fhe-dec, over a Unix-domain socket (on a shared volume) or TCP.
+//
+// Endpoints:  unix:/path/to/socket   or   tcp:host:port
+//
+// Framing: every frame starts with a 16-byte little-endian header
+//   magic(u32) type(u8) reserved(u8) name_len(u16) size(u64)
+// followed by the artifact name. DATA frames carry `size` payload bytes inline.
+// SHM frames carry no payload: the bytes live in a memfd passed alongside the
+// header with SCM_RIGHTS (Unix sockets only, i.e. containers on the same host).
+// END closes the stream and is answered with ACK once everything was received.
+//
+// Flow control: the receiver keeps at most `maxQueued` bytes of artifacts that
+// have not been consumed yet. When that budget is exhausted it stops reading the
+// socket, the kernel buffers fill up and the sender blocks. Consumers should
+// therefore take artifacts in the order they are sent. The sender likewise
+// holds at most `maxQueued` bytes that are not on the socket yet; send() blocks
+// until the background writer has made room.
+//
+// Frames announcing more than MAX_FRAME_SIZE bytes are rejected before anything
+// is allocated for them, as are shared-memory frames larger than their memfd.
+//
+// This header and memory-stream.h are shared by the enc, main and dec images of
+// the he and he-acc variants, which build from the repository root.
+
+#ifndef FHE_ARTIFACT_STREAM_H
+#define FHE_ARTIFACT_STREAM_H
+
+#include "openfhe.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "memory-stream.h"
+
+namespace stream {
+
+const uint32_t FRAME_MAGIC = 0x41454846;  // "FHEA"
+const size_t HEADER_SIZE = 16;
+// Well above the largest key or ciphertext of the supported depths
+const uint64_t MAX_FRAME_SIZE = uint64_t(16) << 30;
+
+enum FrameType : uint8_t { DATA = 1, SHM = 2, END = 3, ACK = 4 };
+
+struct FrameHeader {
+    uint8_t type = 0;
+    uint16_t nameLen = 0;
+    uint64_t size = 0;
+};
+
+inline void encodeHeader(const FrameHeader& h, unsigned char* out) {
+    std::memset(out, 0, HEADER_SIZE);
+    for (int i = 0; i < 4; i++) out[i] = static_cast<unsigned char>(FRAME_MAGIC >> (8 * i));
+    out[4] = h.type;
+    out[6] = static_cast<unsigned char>(h.nameLen);
+    out[7] = static_cast<unsigned char>(h.nameLen >> 8);
+    for (int i = 0; i < 8; i++) out[8 + i] = static_cast<unsigned char>(h.size >> (8 * i));
+}
+
+inline bool decodeHeader(const unsigned char* in, FrameHeader& h) {
+    uint32_t magic = 0;
+    for (int i = 0; i < 4; i++) magic |= static_cast<uint32_t>(in[i]) << (8 * i);
+    if (magic != FRAME_MAGIC) return false;
+    h.type = in[4];
+    h.nameLen = static_cast<uint16_t>(in[6] | (in[7] << 8));
+    h.size = 0;
+    for (int i = 0; i < 8; i++) h.size |= static_cast<uint64_t>(in[8 + i]) << (8 * i);
+    return true;
+}
+
+inline bool isUnix(const std::string& endpoint) {
+    return endpoint.compare(0, 5, "unix:") == 0;
+}
+
+// Split "tcp:host:port" into host and port.
+inline bool splitTcp(const std::string& endpoint, std::string& host, std::string& port) {
+    if (endpoint.compare(0, 4, "tcp:") != 0) return false;
+    size_t colon = endpoint.rfind(':');
+    if (colon <= 4) return false;
+    host = endpoint.substr(4, colon - 4);
+    port = endpoint.substr(colon + 1);
+    return !host.empty() && !port.empty();
+}
+
+inline int listenOn(const std::string& endpoint) {
+    if (isUnix(endpoint)) {
+        std::string path = endpoint.substr(5);
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) return -1;
+        std::strcpy(addr.sun_path, path.c_str());
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        unlink(path.c_str());
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+            close(fd);
+            return -1;
+        }
+        chmod(path.c_str(), 0666);
+        return fd;
+    }
+
+    std::string host, port;
+    if (!splitTcp(endpoint, host, port)) return -1;
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* res = nullptr;
+    if (getaddrinfo(host == "*" ? nullptr : host.c_str(), port.c_str(), &hints, &res) != 0) return -1;
+    int fd = -1;
+    for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 4) == 0) break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+// Connect, retrying until the peer is listening or `timeoutSec` expires.
+inline int connectTo(const std::string& endpoint, int timeoutSec) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeoutSec);
+    do {
+        int fd = -1;
+        if (isUnix(endpoint)) {
+            std::string path = endpoint.substr(5);
+            sockaddr_un addr;
+            std::memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            if (path.size() >= sizeof(addr.sun_path)) return -1;
+            std::strcpy(addr.sun_path, path.c_str());
+            fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) return fd;
+        } else {
+            std::string host, port;
+            if (!splitTcp(endpoint, host, port)) return -1;
+            addrinfo hints;
+            std::memset(&hints, 0, sizeof(hints));
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            addrinfo* res = nullptr;
+            if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) == 0) {
+                for (addrinfo* ai = res; ai && fd < 0; ai = ai->ai_next) {
+                    fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+                    if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+                        close(fd);
+                        fd = -1;
+                    }
+                }
+                freeaddrinfo(res);
+            }
+            if (fd >= 0) {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                return fd;
+            }
+        }
+        if (fd >= 0) close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    } while (std::chrono::steady_clock::now() < deadline);
+    return -1;
+}
+
+inline bool sendAll(int fd, const void* data, size_t len) {
+    const char* p = static_cast<const char*>(data);
+    while (len > 0) {
+        ssize_t n = ::send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Read exactly `len` bytes; a descriptor passed with SCM_RIGHTS is stored in *passedFd.
+inline bool recvAll(int fd, void* data, size_t len, int* passedFd = nullptr) {
+    char* p = static_cast<char*>(data);
+    while (len > 0) {
+        iovec iov{p, len};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+        msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        ssize_t n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+            if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS) {
+                int received;
+                std::memcpy(&received, CMSG_DATA(c), sizeof(int));
+                if (passedFd && *passedFd < 0) {
+                    *passedFd = received;
+                } else {
+                    close(received);
+                }
+            }
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+}  // namespace stream
+
+// A received artifact: either an owned buffer or a read-only shared-memory mapping.
+class Artifact {
+public:
+    Artifact() = default;
+    Artifact(const Artifact&) = delete;
+    Artifact& operator=(const Artifact&) = delete;
+    ~Artifact() {
+        if (map_) munmap(map_, size_);
+    }
+
+    const char* data() const { return map_ ? static_cast<const char*>(map_) : bytes_.data(); }
+    size_t size() const { return map_ ? size_ : bytes_.size(); }
+    bool shared() const { return map_ != nullptr; }
+
+private:
+    friend class ArtifactReceiver;
+    std::string bytes_;
+    void* map_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Listens on an endpoint, accepts one sender and collects its artifacts in the
+// background. Consumers pick artifacts by name as soon as they have arrived.
+class ArtifactReceiver {
+public:
+    explicit ArtifactReceiver(const std::string& endpoint, size_t maxQueued = size_t(1) << 30)
+        : maxQueued_(maxQueued) {
+        listenFd_ = stream::listenOn(endpoint);
+        if (listenFd_ < 0) {
+            error_ = "cannot listen on " + endpoint + ": " + std::strerror(errno);
+            finished_ = true;
+            return;
+        }
+        reader_ = std::thread([this] { run(); });
+    }
+
+    ~ArtifactReceiver() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closing_ = true;
+            // connFd_ is only set and cleared under the lock, so this cannot
+            // hit a descriptor the reader already closed and reused
+            if (connFd_ >= 0) shutdown(connFd_, SHUT_RDWR);
+        }
+        room_.notify_all();
+        if (listenFd_ >= 0) shutdown(listenFd_, SHUT_RDWR);
+        if (reader_.joinable()) reader_.join();
+        if (listenFd_ >= 0) close(listenFd_);
+    }
+
+    bool ok() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return error_.empty();
+    }
+    std::string error() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return error_;
+    }
+    size_t bytesReceived() const { return bytesReceived_; }
+
+    // Block until `name` has arrived. Returns nullptr if the stream ended or
+    // failed without it.
+    std::unique_ptr<Artifact> get(const std::string& name) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        arrived_.wait(lock, [&] { return ready_.count(name) > 0 || finished_; });
+        auto it = ready_.find(name);
+        if (it == ready_.end()) return nullptr;
+        std::unique_ptr<Artifact> artifact = std::move(it->second);
+        ready_.erase(it);
+        if (!artifact->shared()) queued_ -= artifact->size();
+        room_.notify_all();
+        return artifact;
+    }
+
+private:
+    void fail(const std::string& message) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error_.empty() && !closing_) error_ = message;
+    }
+
+    void run() {
+        int fd = accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            fail("accept failed");
+        } else {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                connFd_ = fd;
+                if (closing_) shutdown(fd, SHUT_RDWR);
+            }
+            receive(fd);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                connFd_ = -1;
+            }
+            close(fd);
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_ = true;
+        arrived_.notify_all();
+    }
+
+    void receive(int connFd) {
+        for (;;) {
+            unsigned char raw[stream::HEADER_SIZE];
+            int fd = -1;
+            stream::FrameHeader h;
+            if (!stream::recvAll(connFd, raw, sizeof(raw), &fd) || !stream::decodeHeader(raw, h)) {
+                if (fd >= 0) close(fd);
+                fail("stream closed before END");
+                return;
+            }
+            std::string name(h.nameLen, '\0');
+            if (h.nameLen > 0 && !stream::recvAll(connFd, &name[0], h.nameLen, &fd)) {
+                if (fd >= 0) close(fd);
+                fail("truncated frame");
+                return;
+            }
+
+            if (h.type != stream::END && h.size > stream::MAX_FRAME_SIZE) {
+                if (fd >= 0) close(fd);
+                fail("frame for " + name + " announces " + std::to_string(h.size) + " bytes, more than " +
+                     std::to_string(stream::MAX_FRAME_SIZE));
+                return;
+            }
+
+            if (h.type == stream::END) {
+                unsigned char ack[stream::HEADER_SIZE];
+                stream::FrameHeader a;
+                a.type = stream::ACK;
+                stream::encodeHeader(a, ack);
+                stream::sendAll(connFd, ack, sizeof(ack));
+                return;
+            }
+
+            std::unique_ptr<Artifact> artifact(new Artifact);
+            if (h.type == stream::SHM) {
+                if (fd < 0) {
+                    fail("shared-memory frame without descriptor");
+                    return;
+                }
+                struct stat st;
+                if (fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < h.size) {
+                    close(fd);
+                    fail("shared-memory artifact " + name + " is smaller than its frame");
+                    return;
+                }
+                void* map = h.size ? mmap(nullptr, h.size, PROT_READ, MAP_SHARED, fd, 0) : nullptr;
+                close(fd);
+                if (map == MAP_FAILED) {
+                    fail("cannot map shared-memory artifact " + name);
+                    return;
+                }
+                artifact->map_ = map;
+                artifact->size_ = h.size;
+            } else {
+                if (fd >= 0) close(fd);
+                // Flow control: wait for the consumer before buffering more.
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    room_.wait(lock, [&] { return closing_ || queued_ == 0 || queued_ + h.size <= maxQueued_; });
+                    if (closing_) return;
+                    queued_ += h.size;
+                }
+                artifact->bytes_.resize(h.size);
+                if (h.size > 0 && !stream::recvAll(connFd, &artifact->bytes_[0], h.size)) {
+                    fail("truncated payload for " + name);
+                    return;
+                }
+            }
+            bytesReceived_ += h.size;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (ready_.count(name) == 0) {
+                    ready_[name] = std::move(artifact);
+                    arrived_.notify_all();
+                    continue;
+                }
+                // A second copy of an artifact not yet consumed: either one may
+                // be the wrong one, so neither is handed out. Their buffered
+                // bytes are released, or the sender could stall on a full queue.
+                auto first = ready_.find(name);
+                for (const Artifact* a : {first->second.get(), artifact.get()}) {
+                    if (!a->shared()) queued_ -= a->size();
+                }
+                ready_.erase(first);
+                room_.notify_all();
+            }
+            fail("duplicate artifact " + name);
+            return;
+        }
+    }
+
+    size_t maxQueued_;
+    int listenFd_ = -1;
+    int connFd_ = -1;
+    std::thread reader_;
+    mutable std::mutex mutex_;
+    std::condition_variable arrived_;
+    std::condition_variable room_;
+    std::map<std::string, std::unique_ptr<Artifact>> ready_;
+    size_t queued_ = 0;
+    bool finished_ = false;
+    bool closing_ = false;
+    std::string error_;
+    std::atomic<size_t> bytesReceived_{0};
+};
+
+// Connects to a receiver and ships artifacts from a background thread, so the
+// caller only pays for serialization and goes straight back to computing.
+class ArtifactSender {
+public:
+    ArtifactSender(const std::string& endpoint, bool useShm, size_t maxQueued = size_t(1) << 30)
+        : maxQueued_(maxQueued) {
+        const char* timeout = std::getenv("FHE_STREAM_TIMEOUT");
+        fd_ = stream::connectTo(endpoint, timeout ? std::atoi(timeout) : 60);
+        if (fd_ < 0) {
+            error_ = "cannot connect to " + endpoint;
+            return;
+        }
+        useShm_ = useShm && stream::isUnix(endpoint);
+        if (useShm && !useShm_) {
+            std::cerr << "Shared-memory handoff needs a unix: endpoint, sending inline" << std::endl;
+        }
+        writer_ = std::thread([this] { run(); });
+    }
+
+    ~ArtifactSender() {
+        finish();
+    }
+
+    bool ok() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return error_.empty();
+    }
+    std::string error() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return error_;
+    }
+    size_t bytesSent() const { return bytesSent_; }
+
+    // Queue an artifact, waiting while more than `maxQueued` bytes are still
+    // unsent. False once sending has failed.
+    bool send(const std::string& name, std::string bytes) {
+        if (fd_ < 0) return false;
+        std::unique_lock<std::mutex> lock(mutex_);
+        room_.wait(lock, [&] {
+            return !error_.empty() || queued_ == 0 || queued_ + bytes.size() <= maxQueued_;
+        });
+        if (!error_.empty()) return false;
+        queued_ += bytes.size();
+        queue_.emplace_back(name, std::move(bytes));
+        pending_.notify_one();
+        return true;
+    }
+
+    // Flush the queue, send END and wait for the receiver's ACK.
+    bool finish() {
+        if (fd_ < 0) return false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_ = true;
+        }
+        pending_.notify_one();
+        if (writer_.joinable()) writer_.join();
+
+        bool acked = false;
+        if (ok()) {
+            unsigned char raw[stream::HEADER_SIZE];
+            stream::FrameHeader h;
+            h.type = stream::END;
+            stream::encodeHeader(h, raw);
+            acked = stream::sendAll(fd_, raw, sizeof(raw)) && stream::recvAll(fd_, raw, sizeof(raw)) &&
+                    stream::decodeHeader(raw, h) && h.type == stream::ACK;
+            if (!acked) fail("receiver did not acknowledge the stream");
+        }
+        close(fd_);
+        fd_ = -1;
+        return acked;
+    }
+
+private:
+    void fail(const std::string& message) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error_.empty()) error_ = message;
+        room_.notify_all();
+    }
+
+    void run() {
+        for (;;) {
+            std::pair<std::string, std::string> item;
+            bool failed;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                pending_.wait(lock, [this] { return done_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+                item = std::move(queue_.front());
+                queue_.pop_front();
+                failed = !error_.empty();
+            }
+            if (!failed && !(useShm_ ? sendShm(item.first, item.second) : sendInline(item.first, item.second))) {
+                fail("failed to send " + item.first + ": " + std::strerror(errno));
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            queued_ -= item.second.size();
+            room_.notify_all();
+        }
+    }
+
+    bool sendInline(const std::string& name, const std::string& bytes) {
+        unsigned char raw[stream::HEADER_SIZE];
+        stream::FrameHeader h;
+        h.type = stream::DATA;
+        h.nameLen = static_cast<uint16_t>(name.size());
+        h.size = bytes.size();
+        stream::encodeHeader(h, raw);
+        if (!stream::sendAll(fd_, raw, sizeof(raw)) || !stream::sendAll(fd_, name.data(), name.size()) ||
+            !stream::sendAll(fd_, bytes.data(), bytes.size())) {
+            return false;
+        }
+        bytesSent_ += bytes.size();
+        return true;
+    }
+
+    bool sendShm(const std::string& name, const std::string& bytes) {
+        int memfd = memfd_create(name.c_str(), MFD_CLOEXEC);
+        if (memfd < 0) return sendInline(name, bytes);
+        size_t off = 0;
+        bool written = ftruncate(memfd, static_cast<off_t>(bytes.size())) == 0;
+        while (written && off < bytes.size()) {
+            ssize_t n = pwrite(memfd, bytes.data() + off, bytes.size() - off, static_cast<off_t>(off));
+            if (n < 0 && errno == EINTR) continue;
+            written = n > 0;
+            if (written) off += static_cast<size_t>(n);
+        }
+        if (!written) {
+            close(memfd);
+            return sendInline(name, bytes);
+        }
+
+        unsigned char raw[stream::HEADER_SIZE];
+        stream::FrameHeader h;
+        h.type = stream::SHM;
+        h.nameLen = static_cast<uint16_t>(name.size());
+        h.size = bytes.size();
+        stream::encodeHeader(h, raw);
+
+        iovec iov{raw, sizeof(raw)};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+        msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        cmsghdr* c = CMSG_FIRSTHDR(&msg);
+        c->cmsg_level = SOL_SOCKET;
+        c->cmsg_type = SCM_RIGHTS;
+        c->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(c), &memfd, sizeof(int));
+
+        ssize_t n;
+        do {
+            n = sendmsg(fd_, &msg, MSG_NOSIGNAL);
+        } while (n < 0 && errno == EINTR);
+        close(memfd);
+        if (n <= 0) return false;
+        // Whatever part of the header did not go out with the descriptor
+        if (static_cast<size_t>(n) < sizeof(raw) && !stream::sendAll(fd_, raw + n, sizeof(raw) - n)) return false;
+        if (!stream::sendAll(fd_, name.data(), name.size())) return false;
+        bytesSent_ += bytes.size();
+        return true;
+    }
+
+    size_t maxQueued_;
+    int fd_ = -1;
+    bool useShm_ = false;
+    std::thread writer_;
+    mutable std::mutex mutex_;
+    std::condition_variable pending_;
+    std::condition_variable room_;
+    std::deque<std::pair<std::string, std::string>> queue_;
+    size_t queued_ = 0;
+    bool done_ = false;
+    std::string error_;
+    std::atomic<size_t> bytesSent_{0};
+};
+
+// Serialize an OpenFHE object into a buffer ready to be streamed.
+template <typename T>
+std::string serializeToBuffer(const T& obj) {
+    BufferStream out;
+    lbcrypto::Serial::Serialize(obj, out, lbcrypto::SerType::BINARY);
+    return out.take();
+}
+
+// Deserialize an OpenFHE object from a received artifact (nullptr means missing).
+template <typename T>
+bool deserializeArtifact(const std::unique_ptr<Artifact>& artifact, T& obj) {
+    if (!artifact) return false;
+    MemoryStream in(artifact->data(), artifact->size());
+    lbcrypto::Serial::Deserialize(obj, in, lbcrypto::SerType::BINARY);
+    return static_cast<bool>(in);
+}
+
+#endif
@@ -0,0 +1,66 @@
+//IN-MEMORY SERIALIZATION STREAMS
+//
+// OpenFHE serializes through std::ostream / std::istream. These adapters let
+// artifacts be serialized into an owned buffer and deserialized from a buffer
+// (file contents, socket payload, mapped shared memory) without extra copies.
+
+#ifndef FHE_MEMORY_STREAM_H
+#define FHE_MEMORY_STREAM_H
+
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+// Output stream that serializes straight into an owned std::string, so the
+// buffer can be handed to a writer or a socket without an extra copy.
+class BufferStream : public std::ostream {
+public:
+    BufferStream() : std::ostream(&buf_) {}
+    std::string take() { return std::move(buf_.data); }
+    size_t size() const { return buf_.data.size(); }
+
+private:
+    struct Buf : public std::streambuf {
+        std::string data;
+        int_type overflow(int_type ch) override {
+            if (ch != traits_type::eof()) data.push_back(static_cast<char>(ch));
+            return ch;
+        }
+        std::streamsize xsputn(const char* s, std::streamsize n) override {
+            data.append(s, static_cast<size_t>(n));
+            return n;
+        }
+    } buf_;
+};
+
+// Input stream over a buffer owned elsewhere (no copy, unlike std::istringstream).
+class MemoryStream : public std::istream {
+public:
+    MemoryStream(const char* data, size_t size) : std::istream(&buf_) {
+        char* p = const_cast<char*>(data);
+        buf_.pubsetbuf(p, size);
+    }
+    explicit MemoryStream(const std::string& s) : MemoryStream(s.data(), s.size()) {}
+
+private:
+    struct Buf : public std::streambuf {
+        std::streambuf* setbuf(char* s, std::streamsize n) override {
+            setg(s, s, s + n);
+            return this;
+        }
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) override {
+            char* target = (dir == std::ios_base::beg) ? eback() + off
+                         : (dir == std::ios_base::cur) ? gptr() + off
+                         : egptr() + off;
+            if (target < eback() || target > egptr()) return pos_type(off_type(-1));
+            setg(eback(), target, egptr());
+            return pos_type(target - eback());
+        }
+        pos_type seekpos(pos_type pos, std::ios_base::openmode mode) override {
+            return seekoff(off_type(pos), std::ios_base::beg, mode);
+        }
+    } buf_;
+};
+
+#endif
@@ -14,6 +14,8 @@
 #include "key/key-ser.h"
 #include "scheme/bgvrns/bgvrns-ser.h"
 
+#include "artifact-stream.h"
+
 using namespace lbcrypto;
 
 const std::string DATAFOLDER = "tee_data";
@@ -22,7 +24,18 @@ const std::string RESULTSFOLDER = "data";
 const std::string CRYPTOCONTEXT = "cryptocontext";
 
 
-void saveConfigParameters(int multDepth, int plainModulus, int securityLevel, const std::string& configFile = RESULTSFOLDER + "/config_params.txt") {
+void saveConfigParameters(int multDepth, int plainModulus, int securityLevel, ArtifactSender* sender = nullptr,
+                          const std::string& configFile = RESULTSFOLDER + "/config_params.txt") {
+    if (sender) {
+        std::ostringstream params;
+        params << "depth=" << multDepth << std::endl;
+        params << "modulus=" << plainModulus << std::endl;
+        params << "security=" << securityLevel << std::endl;
+        sender->send("config_params", params.str());
+        std::cout << "Configuration parameters streamed to fhe-main" << std::endl;
+        return;
+    }
+
     std::ofstream outFile(configFile);
     if (!outFile.is_open()) {
         std::cerr << "Error: Could not open configuration file for writing: " << configFile << std::endl;
@@ -37,6 +50,16 @@ void saveConfigParameters(int multDepth, int plainModulus, int securityLevel, co
     std::cout << "Configuration parameters saved to " << configFile << std::endl;
 }
 
+// Hands an artifact to fhe-main: streamed when --send is given, otherwise
+// written to the shared volume.
+template <typename T>
+bool publishArtifact(ArtifactSender* sender, const std::string& name, const std::string& path, const T& obj) {
+    if (sender) {
+        return sender->send(name, serializeToBuffer(obj));
+    }
+    return Serial::SerializeToFile(path, obj, SerType::BINARY);
+}
+
 /////////////////////////////////////////////
 //                                         //
 //               |MAIN|                    //
@@ -51,6 +74,8 @@ int main(int argc, char* argv[])
       uint32_t multDepth = 1;
       uint32_t plainModulus = 65537;
       uint32_t securityLevel = 128; // Default security level
+      std::string sendEndpoint;
+      bool useShm = false;
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
         if (arg == "--depth" && i + 1 < argc) {
@@ -63,12 +88,18 @@ int main(int argc, char* argv[])
                 std::cout << "Warning: Security level must be 128, 192, or 256. Setting to default (128)." << std::endl;
                 securityLevel = 128;
             }
+        } else if (arg == "--send" && i + 1 < argc) {
+            sendEndpoint = argv[++i];
+        } else if (arg == "--shm") {
+            useShm = true;
         } else if (arg == "--help") {
             std::cout << "Usage: " << argv[0] << " [OPTIONS]\n"
                       << "Options:\n"
                       << "  --depth N       Set multiplicative depth (default: 8)\n"
                       << "  --modulus N     Set plaintext modulus (default: 65537)\n"
                       << "  --security N    Set security level (128, 192, or 256) (default: 128)\n"
+                      << "  --send EP       Stream artifacts to fhe-main (unix:PATH or tcp:HOST:PORT)\n"
+                      << "  --shm           Hand artifacts over in shared memory (unix: endpoints)\n"
                       << "  --help          Display this help message\n";
             return 0;
         }
@@ -101,18 +132,22 @@ int main(int argc, char* argv[])
       cc->Enable(KEYSWITCH);
       cc->Enable(LEVELEDSHE);
       
-      //key generation
-      KeyPair<DCRTPoly> keyPair;
-      keyPair = cc->KeyGen();
-      const PublicKey<DCRTPoly> pk = keyPair.publicKey;
-      const PrivateKey<DCRTPoly> sk = keyPair.secretKey;
-      
-      cc->EvalMultKeyGen(sk);
-      
+      // Streaming mode: fhe-main is listening and starts deserializing each
+      // artifact while the next one is still being generated here.
+      std::unique_ptr<ArtifactSender> sender;
+      if (!sendEndpoint.empty()) {
+          sender.reset(new ArtifactSender(sendEndpoint, useShm));
+          if (!sender->ok()) {
+              std::cerr << "Error: " << sender->error() << std::endl;
+              return 1;
+          }
+      }
+
+      // The parameters go first: fhe-main needs the depth before anything else
+      saveConfigParameters(multDepth, plainModulus, securityLevel, sender.get());
 
-      
       // Serialize cryptocontext
-      if (!Serial::SerializeToFile(CRYPTOCONTEXT + "/cryptocontext.txt", cc, SerType::BINARY)) {
+      if (!publishArtifact(sender.get(), "cryptocontext", CRYPTOCONTEXT + "/cryptocontext.txt", cc)) {
           std::cerr << "Error writing serialization of the crypto context to "
                        "cryptocontext.txt"
                     << std::endl;
@@ -120,22 +155,40 @@ int main(int argc, char* argv[])
       }
       std::cout << "The cryptocontext has been serialized." << std::endl;
       
+      //key generation
+      KeyPair<DCRTPoly> keyPair;
+      keyPair = cc->KeyGen();
+      const PublicKey<DCRTPoly> pk = keyPair.publicKey;
+      const PrivateKey<DCRTPoly> sk = keyPair.secretKey;
+      
       // Serialize the public key
-      if (!Serial::SerializeToFile(RESULTSFOLDER + "/key-public.txt", keyPair.publicKey, SerType::BINARY)) {
+      if (!publishArtifact(sender.get(), "key-public", RESULTSFOLDER + "/key-public.txt", keyPair.publicKey)) {
           std::cerr << "Error writing serialization of private key to key-public.txt" << std::endl;
           return 1;
       }
       std::cout << "The public key has been serialized." << std::endl;
       
-      // Serialize the secret key
+      // Serialize the secret key (never streamed: it only goes to the private volume)
       if (!Serial::SerializeToFile(PRIVATEKEY + "/key-private.txt", keyPair.secretKey, SerType::BINARY)) {
           std::cerr << "Error writing serialization of private key to key-private.txt" << std::endl;
           return 1;
       }
       std::cout << "The secret key has been serialized." << std::endl;
       
+      cc->EvalMultKeyGen(sk);
+      
       // Serialize the relinearization (evaluation) key for homomorphic
       // multiplication
+      if (sender) {
+          BufferStream emkeybuffer;
+          if (cc->SerializeEvalMultKey(emkeybuffer, SerType::BINARY) == false) {
+              std::cerr << "Error writing serialization of the eval mult keys" << std::endl;
+              return 1;
+          }
+          sender->send("key-eval-mult", emkeybuffer.take());
+          std::cout << "The eval mult keys have been serialized." << std::endl;
+      }
+      else {
       std::ofstream emkeyfile(RESULTSFOLDER + "/" + "key-eval-mult.txt", std::ios::out | std::ios::binary);
       if (emkeyfile.is_open()) {
           if (cc->SerializeEvalMultKey(emkeyfile, SerType::BINARY) == false) {
@@ -152,6 +205,7 @@ int main(int argc, char* argv[])
           std::cerr << "Error serializing eval mult keys" << std::endl;
           return 1;
       }
+      }
       
 
 
@@ -167,16 +221,19 @@ int main(int argc, char* argv[])
         // Ajoutez une fonction `freeTree` si nécessaire pour libérer les enfants dynamiques
 
       auto ciphertext1 = cc->Encrypt(keyPair.publicKey, plaintext1);
-      auto ciphertext2 = cc->Encrypt(keyPair.publicKey, plaintext2);
-      
-      if (!Serial::SerializeToFile(RESULTSFOLDER + "/enc_file1.txt", ciphertext1, SerType::BINARY)) {
+      if (!publishArtifact(sender.get(), "enc_file1", RESULTSFOLDER + "/enc_file1.txt", ciphertext1)) {
         std::cerr << "Error writing serialization of ciphertext1  to enc_file1.txt" << std::endl;
         return 1;
     }
-    if (!Serial::SerializeToFile(RESULTSFOLDER + "/enc_file2.txt", ciphertext2, SerType::BINARY)) {
+      auto ciphertext2 = cc->Encrypt(keyPair.publicKey, plaintext2);
+    if (!publishArtifact(sender.get(), "enc_file2", RESULTSFOLDER + "/enc_file2.txt", ciphertext2)) {
       std::cerr << "Error writing serialization of ciphertext2  to enc_file2.txt" << std::endl;
       return 1;
   }
-    saveConfigParameters(multDepth, plainModulus, securityLevel);
+    // Wait until fhe-main has acknowledged every artifact
+    if (sender && !sender->finish()) {
+        std::cerr << "Error streaming artifacts: " << sender->error() << std::endl;
+        return 1;
+    }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,707 @@
+//ASYNCHRONOUS ARTIFACT I/O SHARED BY FHE-ENC, FHE-MAIN AND FHE-DEC
+//
+// Serialized artifacts (cryptocontext, keys, ciphertexts) are handed to an
+// AsyncIO engine as soon as they are produced. The engine writes them through
+// io_uring when the kernel allows it and falls back to a small thread pool
+// otherwise (old kernels, seccomp profiles, Gramine). Completed files are
+// fsync'd in batches so the disk flush overlaps with the remaining computation,
+// and only the final drain() blocks the caller.
+//
+// Environment:
+//   FHE_IO=uring|threads|sync    backend selection (default: uring)
+//   FHE_IO_FSYNC_BATCH=N         files per fsync batch, 0 disables fsync (default: 4)
+
+#ifndef FHE_ASYNC_IO_H
+#define FHE_ASYNC_IO_H
+
+#include "openfhe.h"
+
+#include "memory-stream.h"
+#include "profiling.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+
+class AsyncIO {
+public:
+    enum class Backend { Uring, Threads, Sync };
+
+    AsyncIO() {
+        const char* mode = std::getenv("FHE_IO");
+        std::string m = mode ? mode : "uring";
+        const char* batch = std::getenv("FHE_IO_FSYNC_BATCH");
+        fsyncBatch_ = batch ? static_cast<size_t>(std::atoi(batch)) : 4;
+
+        if (m == "sync") {
+            backend_ = Backend::Sync;
+        } else if (m == "uring" && ringSetup()) {
+            backend_ = Backend::Uring;
+            reaper_ = std::thread([this] { ringReap(); });
+        } else {
+            backend_ = Backend::Threads;
+            unsigned n = std::thread::hardware_concurrency();
+            n = n == 0 ? 2 : (n > 4 ? 4 : n);
+            for (unsigned i = 0; i < n; i++) {
+                workers_.emplace_back([this] { poolWork(); });
+            }
+        }
+    }
+
+    ~AsyncIO() {
+        drain();
+        if (backend_ == Backend::Uring) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                Op* op = new Op{nullptr, Op::Stop, 0, 0};
+                ringSubmit(op);
+            }
+            reaper_.join();
+            munmap(sqes_, sqesSize_);
+            if (cqRing_ != sqRing_) munmap(cqRing_, cqRingSize_);
+            munmap(sqRing_, sqRingSize_);
+            close(ringFd_);
+        } else if (backend_ == Backend::Threads) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            cv_.notify_all();
+            for (auto& t : workers_) t.join();
+        }
+    }
+
+    AsyncIO(const AsyncIO&) = delete;
+    AsyncIO& operator=(const AsyncIO&) = delete;
+
+    const char* backendName() const {
+        switch (backend_) {
+            case Backend::Uring: return "io_uring";
+            case Backend::Threads: return "threads";
+            default: return "sync";
+        }
+    }
+
+    // Queue a whole-file write. Returns false if the file cannot be created;
+    // write errors surface later through drain().
+    bool write(const std::string& path, std::string data) {
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            recordError("cannot open " + path + " for writing: " + std::strerror(errno));
+            return false;
+        }
+        bytesWritten_ += data.size();
+        filesWritten_++;
+
+        Job* job = new Job;
+        job->kind = Job::Write;
+        job->fd = fd;
+        job->path = path;
+        job->data = std::move(data);
+
+        if (backend_ == Backend::Sync) {
+            bool ok = writeAll(job);
+            close(fd);
+            delete job;
+            return ok;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        outstanding_++;
+        peakOutstanding_ = std::max(peakOutstanding_, outstanding_);
+        if (backend_ == Backend::Uring) {
+            ringQueueChunks(job);
+        } else {
+            tasks_.push_back(job);
+            cv_.notify_one();
+        }
+        return true;
+    }
+
+    // Start reading a whole file. The future throws std::runtime_error if the
+    // file cannot be read.
+    std::shared_future<std::string> read(const std::string& path) {
+        Job* job = new Job;
+        job->kind = Job::Read;
+        job->path = path;
+        std::shared_future<std::string> result = job->promise.get_future().share();
+
+        job->fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (job->fd < 0 || fstat(job->fd, &st) != 0) {
+            job->promise.set_exception(std::make_exception_ptr(
+                std::runtime_error("cannot read " + path + ": " + std::strerror(errno))));
+            if (job->fd >= 0) close(job->fd);
+            delete job;
+            return result;
+        }
+        job->data.resize(static_cast<size_t>(st.st_size));
+        bytesRead_ += job->data.size();
+
+        if (backend_ == Backend::Sync || job->data.empty()) {
+            finishRead(job, readAll(job));
+            return result;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        outstanding_++;
+        peakOutstanding_ = std::max(peakOutstanding_, outstanding_);
+        if (backend_ == Backend::Uring) {
+            ringQueueChunks(job);
+        } else {
+            tasks_.push_back(job);
+            cv_.notify_one();
+        }
+        return result;
+    }
+
+    // Block until every queued write has landed (and been fsync'd) and every
+    // read has completed. The blocked time is accumulated in waitSeconds().
+    bool drain() {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<Job*> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            draining_++;
+            batch.swap(syncBatch_);
+            if (backend_ == Backend::Uring) {
+                for (Job* job : batch) ringQueueFsync(job);
+                batch.clear();
+            }
+        }
+        for (Job* job : batch) finishWrite(job, true);
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.wait(lock, [this] { return outstanding_ == 0; });
+            draining_--;
+        }
+        waitNs_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        return !failed_.load();
+    }
+
+    double waitSeconds() const { return waitNs_ / 1e9; }
+    size_t bytesWritten() const { return bytesWritten_; }
+    size_t bytesRead() const { return bytesRead_; }
+    size_t filesWritten() const { return filesWritten_; }
+
+    // Reads and writes queued but not yet completed, now and at most
+    size_t queueDepth() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return outstanding_;
+    }
+    size_t peakQueueDepth() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return peakOutstanding_;
+    }
+
+    std::string lastError() {
+        std::lock_guard<std::mutex> lock(errorMutex_);
+        return error_;
+    }
+
+private:
+    struct Job {
+        enum Kind { Write, Read } kind;
+        int fd = -1;
+        std::string path;
+        std::string data;
+        size_t pending = 0;
+        bool ok = true;
+        std::promise<std::string> promise;
+    };
+
+    struct Op {
+        Job* job;
+        enum Kind { Write, Read, Fsync, Stop } kind;
+        size_t offset;
+        size_t length;
+    };
+
+    static constexpr size_t CHUNK = size_t(32) << 20;
+    static constexpr unsigned RING_ENTRIES = 64;
+
+    void recordError(const std::string& message) {
+        std::lock_guard<std::mutex> lock(errorMutex_);
+        failed_ = true;
+        if (error_.empty()) error_ = message;
+    }
+
+    bool writeAll(Job* job) {
+        size_t off = 0;
+        while (off < job->data.size()) {
+            ssize_t n = pwrite(job->fd, job->data.data() + off, job->data.size() - off, off);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                recordError("write to " + job->path + " failed: " + std::strerror(errno));
+                return false;
+            }
+            off += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool readAll(Job* job) {
+        size_t off = 0;
+        while (off < job->data.size()) {
+            ssize_t n = pread(job->fd, &job->data[off], job->data.size() - off, off);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            off += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    void finishRead(Job* job, bool ok) {
+        close(job->fd);
+        if (ok) {
+            job->promise.set_value(std::move(job->data));
+        } else {
+            job->promise.set_exception(std::make_exception_ptr(
+                std::runtime_error("short read from " + job->path)));
+        }
+        delete job;
+    }
+
+    // Write data is complete: fsync (unless disabled or failed), close, retire.
+    void finishWrite(Job* job, bool doSync) {
+        if (doSync && fsyncBatch_ > 0 && job->ok && fdatasync(job->fd) != 0) {
+            recordError("fsync of " + job->path + " failed: " + std::strerror(errno));
+        }
+        close(job->fd);
+        delete job;
+        std::lock_guard<std::mutex> lock(mutex_);
+        retire();
+    }
+
+    // Caller holds mutex_.
+    void retire() {
+        if (--outstanding_ == 0) done_.notify_all();
+    }
+
+    // ---------------------------------------------------------------- threads
+
+    void poolWork() {
+        for (;;) {
+            Job* job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty()) return;
+                job = tasks_.front();
+                tasks_.pop_front();
+            }
+            if (job->kind == Job::Read) {
+                FHE_SPAN("io:read");
+                bool ok = readAll(job);
+                finishRead(job, ok);
+                std::lock_guard<std::mutex> lock(mutex_);
+                retire();
+                continue;
+            }
+
+            FHE_SPAN("io:write");
+            job->ok = writeAll(job);
+            job->data.clear();
+            job->data.shrink_to_fit();
+            std::vector<Job*> batch;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                syncBatch_.push_back(job);
+                if (syncBatch_.size() >= fsyncBatch_ || draining_) batch.swap(syncBatch_);
+            }
+            for (Job* j : batch) finishWrite(j, true);
+        }
+    }
+
+    // ---------------------------------------------------------------- io_uring
+
+    static int sysSetup(unsigned entries, io_uring_params* p) {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+    }
+
+    static int sysEnter(int fd, unsigned submit, unsigned complete, unsigned flags) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, submit, complete, flags, nullptr, 0));
+    }
+
+    bool ringSetup() {
+        io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        ringFd_ = sysSetup(RING_ENTRIES, &p);
+        if (ringFd_ < 0) return false;
+        // IORING_OP_READ/WRITE arrived together with IORING_FEAT_RW_CUR_POS (5.6).
+        if (!(p.features & IORING_FEAT_RW_CUR_POS) || !(p.features & IORING_FEAT_NODROP)) {
+            close(ringFd_);
+            return false;
+        }
+
+        sqRingSize_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cqRingSize_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single && cqRingSize_ > sqRingSize_) sqRingSize_ = cqRingSize_;
+
+        sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ringFd_, IORING_OFF_SQ_RING);
+        if (sqRing_ == MAP_FAILED) {
+            close(ringFd_);
+            return false;
+        }
+        cqRing_ = single ? sqRing_
+                         : mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                ringFd_, IORING_OFF_CQ_RING);
+        sqesSize_ = p.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE,
+                                                MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES));
+        if (cqRing_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+            if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_) munmap(cqRing_, cqRingSize_);
+            munmap(sqRing_, sqRingSize_);
+            close(ringFd_);
+            return false;
+        }
+
+        char* sq = static_cast<char*>(sqRing_);
+        char* cq = static_cast<char*>(cqRing_);
+        sqHead_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+        sqTail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        sqMask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        cqHead_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        cqTail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        cqMask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        sqEntries_ = p.sq_entries;
+        // Keep in-flight ops below the CQ size so completions never overflow.
+        maxInflight_ = p.cq_entries;
+        return true;
+    }
+
+    // Caller holds mutex_. Submitters block while the ring is saturated; the
+    // reaper never blocks (it is the thread that frees room) and relies on
+    // IORING_FEAT_NODROP for the few fsyncs it may queue beyond the limit.
+    // When the SQ itself is full it defers the op instead, and queues it on
+    // a later round, once the kernel has taken some entries.
+    void ringSubmit(Op* op, bool wait = true) {
+        if (wait) {
+            std::unique_lock<std::mutex> lock(mutex_, std::adopt_lock);
+            room_.wait(lock, [this] { return inflight_ < maxInflight_; });
+            lock.release();
+            // SQEs left queued by a refused enter are handed over first
+            while (sqFull()) {
+                ringFlush(false);
+                std::this_thread::yield();
+            }
+        }
+        inflight_++;
+        work_.notify_all();
+        if (!wait && (sqFull() || !deferred_.empty())) {
+            deferred_.push_back(op);
+            return;
+        }
+        ringPush(op);
+        ringFlush(!wait);
+    }
+
+    // Caller holds mutex_.
+    bool sqFull() const { return *sqTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_; }
+
+    // Caller holds mutex_. Moves deferred ops into the SQ while it has room.
+    void ringQueueDeferred() {
+        while (!deferred_.empty() && !sqFull()) {
+            ringPush(deferred_.front());
+            deferred_.pop_front();
+        }
+    }
+
+    // Caller holds mutex_ and has checked the SQ has room. Fills in an SQE.
+    void ringPush(Op* op) {
+        unsigned tail = *sqTail_;
+        unsigned idx = tail & sqMask_;
+        io_uring_sqe* sqe = &sqes_[idx];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->user_data = reinterpret_cast<uint64_t>(op);
+        switch (op->kind) {
+            case Op::Write:
+                sqe->opcode = IORING_OP_WRITE;
+                sqe->fd = op->job->fd;
+                sqe->addr = reinterpret_cast<uint64_t>(op->job->data.data() + op->offset);
+                sqe->len = static_cast<unsigned>(op->length);
+                sqe->off = op->offset;
+                break;
+            case Op::Read:
+                sqe->opcode = IORING_OP_READ;
+                sqe->fd = op->job->fd;
+                sqe->addr = reinterpret_cast<uint64_t>(&op->job->data[op->offset]);
+                sqe->len = static_cast<unsigned>(op->length);
+                sqe->off = op->offset;
+                break;
+            case Op::Fsync:
+                sqe->opcode = IORING_OP_FSYNC;
+                sqe->fd = op->job->fd;
+                sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+                break;
+            case Op::Stop:
+                sqe->opcode = IORING_OP_NOP;
+                break;
+        }
+        sqArray_[idx] = idx;
+        __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+    }
+
+    // Caller holds mutex_. Hands the kernel every SQE it has not consumed.
+    // EAGAIN and EBUSY mean it is short of memory for requests or holding
+    // back completions until some are reaped: the reaper leaves them queued
+    // for its next round (it cannot wait on itself), other threads let it
+    // run and try again, for up to about five seconds. Any other error fails
+    // the queued ops, so that their reads and writes end with it rather than
+    // never.
+    void ringFlush(bool fromReaper) {
+        for (int attempt = 0;;) {
+            unsigned queued = *sqTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+            if (queued == 0) return;
+            if (sysEnter(ringFd_, queued, 0, 0) >= 0 || errno == EINTR) continue;
+            int err = errno;
+            if ((err == EAGAIN || err == EBUSY) && fromReaper) return;
+            if ((err == EAGAIN || err == EBUSY) && attempt++ < 5000) {
+                std::unique_lock<std::mutex> lock(mutex_, std::adopt_lock);
+                room_.wait_for(lock, std::chrono::milliseconds(1));
+                lock.release();
+                continue;
+            }
+            ringFailQueued(err);
+            return;
+        }
+    }
+
+    // Caller holds mutex_. Takes back the SQEs the kernel has not consumed
+    // and completes their ops with the error.
+    void ringFailQueued(int err) {
+        unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        std::vector<Op*> ops;
+        for (unsigned t = head; t != *sqTail_; t++) {
+            ops.push_back(reinterpret_cast<Op*>(sqes_[sqArray_[t & sqMask_]].user_data));
+        }
+        __atomic_store_n(sqTail_, head, __ATOMIC_RELEASE);
+        recordError(std::string("io_uring submission failed: ") + std::strerror(err));
+        std::unique_lock<std::mutex> lock(mutex_, std::adopt_lock);
+        for (Op* op : ops) ringComplete(op, -err, lock);
+        lock.release();
+    }
+
+    // Caller holds mutex_.
+    void ringQueueChunks(Job* job) {
+        size_t size = job->data.size();
+        job->pending = (size + CHUNK - 1) / CHUNK;
+        if (job->pending == 0) {
+            // Empty file: nothing to transfer, go straight to the sync batch.
+            syncBatch_.push_back(job);
+            return;
+        }
+        Op::Kind kind = job->kind == Job::Write ? Op::Write : Op::Read;
+        for (size_t off = 0; off < size; off += CHUNK) {
+            ringSubmit(new Op{job, kind, off, std::min(CHUNK, size - off)});
+        }
+    }
+
+    // Caller holds mutex_.
+    void ringQueueFsync(Job* job, bool wait = true) {
+        if (fsyncBatch_ == 0 || !job->ok) {
+            close(job->fd);
+            delete job;
+            retire();
+            return;
+        }
+        ringSubmit(new Op{job, Op::Fsync, 0, 0}, wait);
+    }
+
+    // Caller holds mutex_; called as the last chunk of a write completes.
+    void ringWriteDone(Job* job) {
+        job->data.clear();
+        job->data.shrink_to_fit();
+        syncBatch_.push_back(job);
+        if (syncBatch_.size() >= fsyncBatch_ || draining_) {
+            std::vector<Job*> batch;
+            batch.swap(syncBatch_);
+            for (Job* j : batch) ringQueueFsync(j, false);
+        }
+    }
+
+    // Waits for completions only while the kernel owes some: with nothing in
+    // flight it sleeps until a submission (or the destructor) wakes it, and
+    // with SQEs still queued after a refused enter, or ops deferred for a
+    // full SQ, it retries them first.
+    void ringReap() {
+        for (;;) {
+            unsigned head = *cqHead_;
+            if (head == __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE)) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ringFlush(true);
+                if (!deferred_.empty()) {
+                    ringQueueDeferred();
+                    ringFlush(true);
+                }
+                if (*sqTail_ != __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) || !deferred_.empty()) {
+                    work_.wait_for(lock, std::chrono::milliseconds(1));
+                    continue;
+                }
+                if (inflight_ == 0) {
+                    if (stopping_) return;
+                    work_.wait(lock, [this] { return inflight_ > 0 || stopping_; });
+                    continue;
+                }
+                lock.unlock();
+                sysEnter(ringFd_, 0, 1, IORING_ENTER_GETEVENTS);
+                continue;
+            }
+            io_uring_cqe cqe = cqes_[head & cqMask_];
+            __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!ringComplete(reinterpret_cast<Op*>(cqe.user_data), cqe.res, lock)) return;
+        }
+    }
+
+    // Caller holds mutex_ through lock. Retires one op with its result (a
+    // byte count or -errno); false once the reaper is to stop.
+    bool ringComplete(Op* op, int res, std::unique_lock<std::mutex>& lock) {
+        inflight_--;
+        room_.notify_all();
+        if (op->kind == Op::Stop) {
+            delete op;
+            stopping_ = true;
+            work_.notify_all();
+            return false;
+        }
+        Job* job = op->job;
+
+        if (op->kind == Op::Fsync) {
+            if (res < 0) {
+                lock.unlock();
+                recordError("fsync of " + job->path + " failed: " + std::strerror(-res));
+                lock.lock();
+            }
+            close(job->fd);
+            delete job;
+            delete op;
+            retire();
+            return true;
+        }
+
+        if (res > 0 && static_cast<size_t>(res) < op->length) {
+            // Short transfer: resubmit the remainder of this chunk.
+            op->offset += static_cast<size_t>(res);
+            op->length -= static_cast<size_t>(res);
+            ringSubmit(op, false);
+            return true;
+        }
+        if (res <= 0 && op->length > 0) {
+            job->ok = false;
+            lock.unlock();
+            recordError((op->kind == Op::Write ? "write to " : "read from ") + job->path +
+                        " failed: " + std::strerror(res < 0 ? -res : EIO));
+            lock.lock();
+        }
+        delete op;
+        if (--job->pending > 0) return true;
+
+        if (job->kind == Job::Write) {
+            ringWriteDone(job);
+        } else {
+            lock.unlock();
+            finishRead(job, job->ok);
+            lock.lock();
+            retire();
+        }
+        return true;
+    }
+
+    Backend backend_ = Backend::Sync;
+    size_t fsyncBatch_ = 4;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable done_;
+    std::condition_variable room_;
+    std::condition_variable work_;
+    size_t outstanding_ = 0;
+    size_t peakOutstanding_ = 0;
+    int draining_ = 0;
+    bool stopping_ = false;
+    std::deque<Job*> tasks_;
+    std::deque<Op*> deferred_;  // reaper's ops waiting for room in the SQ
+    std::vector<Job*> syncBatch_;
+    std::vector<std::thread> workers_;
+
+    std::mutex errorMutex_;
+    std::atomic<bool> failed_{false};
+    std::string error_;
+
+    std::atomic<size_t> bytesWritten_{0};
+    std::atomic<size_t> bytesRead_{0};
+    std::atomic<size_t> filesWritten_{0};
+    long long waitNs_ = 0;
+
+    int ringFd_ = -1;
+    std::thread reaper_;
+    void* sqRing_ = nullptr;
+    void* cqRing_ = nullptr;
+    size_t sqRingSize_ = 0;
+    size_t cqRingSize_ = 0;
+    size_t sqesSize_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned* sqHead_ = nullptr;
+    unsigned* sqTail_ = nullptr;
+    unsigned* sqArray_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned sqEntries_ = 0;
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    unsigned inflight_ = 0;
+    unsigned maxInflight_ = 0;
+};
+
+// Serialize an OpenFHE object into memory and hand it to the engine.
+template <typename T>
+bool serializeAsync(AsyncIO& io, const std::string& path, const T& obj) {
+    BufferStream out;
+    lbcrypto::Serial::Serialize(obj, out, lbcrypto::SerType::BINARY);
+    if (!out) return false;
+    return io.write(path, out.take());
+}
+
+// Deserialize an OpenFHE object from a pending read; false on I/O failure.
+template <typename T>
+bool deserializeAsync(const std::shared_future<std::string>& pending, T& obj) {
+    try {
+        const std::string& bytes = pending.get();
+        MemoryStream in(bytes);
+        lbcrypto::Serial::Deserialize(obj, in, lbcrypto::SerType::BINARY);
+        return static_cast<bool>(in);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+}
+
+#endif
@@ -10,12 +10,30 @@
 #include <fstream>
 #include <iomanip>
 #include <ctime>
+#include <future>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
 
 // header files needed for serialization
 #include "ciphertext-ser.h"
 #include "cryptocontext-ser.h"
 #include "key/key-ser.h"
 #include "scheme/bgvrns/bgvrns-ser.h"
+#include "scheme/ckksrns/ckksrns-ser.h"
+
+#include "async-io.h"
+#include "artifact-store.h"
+#include "profiling.h"
+#include "memory-stats.h"
+#include "op-profile.h"
+#include "metrics.h"
+#include "tenant-cache.h"
+#include "task-runtime.h"
+#include "job-scheduler.h"
+#include "scheme-config.h"
 
 using namespace lbcrypto;
 namespace fs = std::filesystem;
@@ -23,21 +41,16 @@ namespace fs = std::filesystem;
 const std::string DATAFOLDER = "data";
 const std::string RESULTSFOLDER = "results";
 const std::string CRYPTOCONTEXT = "cryptocontext";
+const std::string STOREFOLDER = "store";
 
 
-std::tuple<int, int, int> loadConfigParameters(const std::string& configFile = DATAFOLDER + "/config_params.txt") {
-    std::ifstream inFile(configFile);
-    if (!inFile.is_open()) {
-        std::cerr << "Error: Could not open configuration file for reading: " << configFile << std::endl;
-        return {8, 65537, 128}; // Return default values
-    }
-    
+std::tuple<int, int, int> parseConfigParameters(std::istream& in, scheme::Config* schemeConfig = nullptr) {
     int depth = 8;      // Default value
     int modulus = 65537; // Default value
     int security = 128;  // Default value
     
     std::string line;
-    while (std::getline(inFile, line)) {
+    while (std::getline(in, line)) {
         std::istringstream iss(line);
         std::string key;
         std::getline(iss, key, '=');
@@ -48,58 +61,58 @@ std::tuple<int, int, int> loadConfigParameters(const std::string& configFile = D
             iss >> modulus;
         } else if (key == "security") {
             iss >> security;
+        } else if (schemeConfig) {
+            std::string value;
+            std::getline(iss, value);
+            schemeConfig->set(key, value);
         }
     }
     
-    inFile.close();
     return {depth, modulus, security};
 }
 
-void saveTimingToCSV(const std::string& phase, 
-                     int depth, int modulus, int security,
-                     double deserialize_time, double computation_time, 
-                     double serialize_time, double total_time,
-                     const std::string& csvFile = "main_timing_results.csv") {
-    
-    // Check if file exists to determine if we need to write headers
-    bool fileExists = false;
-    std::ifstream checkFile(csvFile);
-    if (checkFile.good()) {
-        fileExists = true;
+std::tuple<int, int, int> loadConfigParameters(const std::string& configFile = DATAFOLDER + "/config_params.txt",
+                                               scheme::Config* schemeConfig = nullptr) {
+    std::ifstream inFile(configFile);
+    if (!inFile.is_open()) {
+        std::cerr << "Error: Could not open configuration file for reading: " << configFile << std::endl;
+        return {8, 65537, 128}; // Return default values
     }
-    checkFile.close();
     
-    // Open file in append mode
-    std::ofstream outFile(csvFile, std::ios::app);
-    if (!outFile.is_open()) {
-        std::cerr << "Error: Could not open CSV file for writing: " << csvFile << std::endl;
-        return;
+    auto config = parseConfigParameters(inFile, schemeConfig);
+    inFile.close();
+    return config;
+}
+
+// References and parameters of one stored job
+bool loadStoredJob(ArtifactStore& store, const std::string& name, ArtifactRefs& refs,
+                   std::tuple<int, int, int>& config, scheme::Config* schemeConfig = nullptr) {
+    if (!store.readRefs("jobs", name, refs)) {
+        std::cerr << "Error: job " << name << " is not in " << store.root() << std::endl;
+        return false;
     }
-    
-    // Write headers if file is new
-    if (!fileExists) {
-        outFile << "timestamp,phase,depth,modulus,security,deserialize_time,"
-                << "computation_time,serialize_time,total_time" << std::endl;
+    for (const char* required : {"config_params", "cryptocontext", "key-eval-mult", "enc_file1", "enc_file2"}) {
+        if (!refs.has(required)) {
+            std::cerr << "Error: job " << name << " has no " << required << std::endl;
+            return false;
+        }
     }
-    
-    // Get current timestamp
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto tm = *std::localtime(&time_t);
-    
-    // Write data row
-    outFile << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << ","
-            << phase << ","
-            << depth << ","
-            << modulus << ","
-            << security << ","
-            << std::fixed << std::setprecision(10) << deserialize_time << ","
-            << computation_time << ","
-            << serialize_time << ","
-            << total_time << std::endl;
-    
-    outFile.close();
-    std::cout << "Timing results saved to " << csvFile << std::endl;
+    std::string bytes;
+    try {
+        bytes = store.get(refs.hash("config_params")).get();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+    MemoryStream in(bytes);
+    config = parseConfigParameters(in, schemeConfig);
+    return true;
+}
+
+// Shape of the evaluated circuit, for fhe-dec to work out the exact result a
+// CKKS output approximates
+std::string circuitParametersText(int width) {
+    return "width=" + std::to_string(width) + "\n";
 }
 
 /////////////////////////////////////////////
@@ -108,109 +121,564 @@ void saveTimingToCSV(const std::string& phase,
 //                                         //
 /////////////////////////////////////////////
 
-int main()
+int main(int argc, char* argv[])
 {
     auto start_total = std::chrono::high_resolution_clock::now();
-    
-    auto [depth, modulus, security] = loadConfigParameters();
+
+    // --store evaluates jobs recorded in the content-addressed store; several
+    // jobs can be given (--job a,b,c) and share whatever they have in common.
+    // --serve also reads job names from stdin, one per line, until EOF: a
+    // long-lived process serving many tenants, whose contexts and eval keys
+    // stay deserialized in a cache of --cache-mb megabytes.
+    // Served jobs are queued and run earliest deadline first (--sched fifo:
+    // in arrival order); --queue-cap bounds the interactive queue (the batch
+    // queue gets a quarter of it) and --backpressure stops reading stdin at a
+    // full queue instead of rejecting.
+    bool useStore = false;
+    bool serve = false;
+    uint64_t cacheMb = 2048;
+    std::vector<std::string> jobNames;
+    sched::Scheduler::Options schedOptions;
+    // --split-relin times the tensor product and the key switch of every
+    // EvalMult apart; --repeat N evaluates each job N times, so the per-level
+    // histograms have N samples per cell (the result is the same every time).
+    bool splitRelin = false;
+    int repeat = 1;
+    // --width W evaluates W independent chains of multiplications and sums
+    // them (width 1 is the single chain); --workers N runs the operations of
+    // the circuit on N work-stealing workers, each with --inner-threads
+    // OpenMP threads (default: the cores split evenly between the workers).
+    int width = 1;
+    unsigned workers = 1;
+    int innerThreads = 0;
+    // --no-overlap deserializes the eval keys before computing, as fhe-main
+    // used to, instead of alongside the first multiplications
+    bool overlapKeys = true;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--store") {
+            useStore = true;
+        } else if (arg == "--serve") {
+            useStore = true;
+            serve = true;
+        } else if (arg == "--cache-mb" && i + 1 < argc) {
+            cacheMb = std::stoull(argv[++i]);
+        } else if (arg == "--sched" && i + 1 < argc) {
+            std::string order = argv[++i];
+            if (order != "edf" && order != "fifo") {
+                std::cerr << "Error: --sched must be edf or fifo" << std::endl;
+                return 1;
+            }
+            schedOptions.order = order == "fifo" ? sched::Scheduler::Order::Arrival : sched::Scheduler::Order::Deadline;
+        } else if (arg == "--queue-cap" && i + 1 < argc) {
+            schedOptions.interactiveCapacity = std::max(1, std::stoi(argv[++i]));
+            schedOptions.batchCapacity = std::max<size_t>(1, schedOptions.interactiveCapacity / 4);
+        } else if (arg == "--backpressure") {
+            schedOptions.block = true;
+        } else if (arg == "--split-relin") {
+            splitRelin = true;
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--no-overlap") {
+            overlapKeys = false;
+        } else if (arg == "--width" && i + 1 < argc) {
+            width = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--workers" && i + 1 < argc) {
+            workers = static_cast<unsigned>(std::max(1, std::stoi(argv[++i])));
+        } else if (arg == "--inner-threads" && i + 1 < argc) {
+            innerThreads = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--job" && i + 1 < argc) {
+            std::istringstream names(argv[++i]);
+            std::string name;
+            while (std::getline(names, name, ',')) {
+                if (!name.empty()) jobNames.push_back(name);
+            }
+        }
+    }
+    if (!useStore && !jobNames.empty()) {
+        // Without the store every job would evaluate the same shared volume
+        std::cerr << "Error: --job names stored jobs and needs --store or --serve" << std::endl;
+        return 1;
+    }
+    if (useStore && !serve && jobNames.empty()) {
+        jobNames.push_back("default");
+    }
+    // A server's working set changes with its tenants, while the pool keeps
+    // the high-water mark of every size class: off unless FHE_POOL asks for it
+    if (serve && !std::getenv("FHE_POOL")) {
+        setenv("FHE_POOL", "off", 0);
+        mem::BufferPool::instance().disable();
+    }
+
+    metrics::Exporter exporter("computation");
+    AsyncIO io;
+    metrics::RunMetrics<AsyncIO> live("computation", io, mem::liveBytes);
+    std::unique_ptr<ArtifactStore> store;
+    if (useStore) {
+        store = std::make_unique<ArtifactStore>(io, STOREFOLDER);
+    } else {
+        jobNames.push_back("");
+    }
+    prof::Session profile("computation");
+    FHE_SPAN("computation");
+    mem::Phase memory({"deserialize", "computation", "serialize"});
     
     //getting the depth
     //int depth = calculateDepth(DATAFOLDER);
     //int depth = atoi(argv[1]);
+
+    // Tenants whose context and eval keys are already deserialized, by the
+    // hashes of those objects. Jobs of a cached tenant neither read nor parse
+    // them again.
+    TenantCache tenants(cacheMb << 20);
+    metrics::Callback cachedTenantCount("fhe_tenant_cache_tenants", "Tenants with a deserialized context and eval keys",
+                                        metrics::Type::Gauge, {}, [&] { return double(tenants.size()); });
+    metrics::Callback cachedByteCount("fhe_tenant_cache_bytes", "Memory charged to cached tenants",
+                                      metrics::Type::Gauge, {}, [&] { return double(tenants.bytes()); });
+    metrics::Callback cacheHitCount("fhe_tenant_cache_hits", "Jobs whose tenant was cached",
+                                    metrics::Type::Counter, {}, [&] { return double(tenants.hits()); });
+    metrics::Callback cacheMissCount("fhe_tenant_cache_misses", "Jobs that deserialized their tenant",
+                                     metrics::Type::Counter, {}, [&] { return double(tenants.misses()); });
+    metrics::Callback cacheEvictionCount("fhe_tenant_cache_evictions", "Tenants evicted to stay within the budget",
+                                         metrics::Type::Counter, {}, [&] { return double(tenants.evictions()); });
+    OpProfile ops;
+    TaskRuntime runtime(workers, innerThreads);
+
+    // Evaluate one job; false if it failed (the error has been printed)
+    auto runJob = [&](size_t job, const std::string& jobName) -> bool {
+        FHE_SPAN("job");
+        ArtifactRefs refs;
+        std::tuple<int, int, int> config;
+        scheme::Config schemeConfig;
+        if (store) {
+            if (!loadStoredJob(*store, jobName, refs, config, &schemeConfig)) return false;
+        } else {
+            config = loadConfigParameters(DATAFOLDER + "/config_params.txt", &schemeConfig);
+        }
+        auto [depth, modulus, security] = config;
+        if (job == 0) profile.setParameters(depth, modulus, security);
+
+        auto fetch = [&](const std::string& name, const std::string& path) {
+            return store ? store->get(refs.hash(name)) : io.read(path);
+        };
+        if (job > 0) {
+            start_total = std::chrono::high_resolution_clock::now();
+            memory.restart();
+        }
     
-    // Time deserialization
-    auto start_deserialize = std::chrono::high_resolution_clock::now();
+        // Time deserialization
+        memory.begin("deserialize");
+        auto start_deserialize = std::chrono::high_resolution_clock::now();
     
-    //getting the crypto-context and the the public keys
-    CryptoContext<DCRTPoly> cc;
+        // All artifact reads are issued up front, the ciphertexts first as the
+        // computation needs them first, so the disk reads overlap with
+        // deserializing the cryptocontext.
+        std::string tenantId = store ? TenantCache::fingerprint(refs.hash("cryptocontext"), refs.hash("key-eval-mult"))
+                                     : std::string();
+        TenantCache::Tenant* tenant = store ? tenants.lookup(tenantId) : nullptr;
+        std::shared_future<std::string> ccBytes, pkBytes, emkeyBytes;
+        if (!tenant) ccBytes = fetch("cryptocontext", CRYPTOCONTEXT + "/cryptocontext.txt");
+        auto ct1Bytes = fetch("enc_file1", DATAFOLDER + "/" + "enc_file1.txt");
+        auto ct2Bytes = fetch("enc_file2", DATAFOLDER + "/" + "enc_file2.txt");
+        if (!tenant) emkeyBytes = fetch("key-eval-mult", DATAFOLDER + "/key-eval-mult.txt");
+        // The public key is not needed for evaluation; stored jobs skip it
+        if (!store) pkBytes = fetch("key-public", DATAFOLDER + "/key-public.txt");
 
-    if (!Serial::DeserializeFromFile(CRYPTOCONTEXT + "/cryptocontext.txt", cc, SerType::BINARY)) {
-        std::cerr << "I cannot read serialization from " << CRYPTOCONTEXT + "/cryptocontext.txt" << std::endl;
-        return 1;
-    }
-    std::cout << "The cryptocontext has been deserialized." << std::endl;
+        //getting the crypto-context and the the public keys
+        CryptoContext<DCRTPoly> cc;
+        uint64_t contextBytes = 0;
+        std::set<std::string> tagsBefore;
 
-    PublicKey<DCRTPoly> pk;
-    if (Serial::DeserializeFromFile(DATAFOLDER + "/key-public.txt", pk, SerType::BINARY) == false) {
-        std::cerr << "Could not read public key" << std::endl;
-        return 1;
-    }
-    std::cout << "The public key has been deserialized." << std::endl;
+        if (tenant) {
+            cc = tenant->cc;
+        } else {
+            // What the context holds on to is charged to the tenant: the heap it
+            // added, or its serialized size without allocation hooks
+            uint64_t liveBefore = mem::liveBytes.load();
+            tagsBefore = TenantCache::loadedKeyTags();
+            FHE_SPAN("deserialize:cryptocontext");
+            if (!deserializeAsync(ccBytes, cc)) {
+                std::cerr << "I cannot read serialization from " << CRYPTOCONTEXT + "/cryptocontext.txt" << std::endl;
+                return false;
+            }
+            std::cout << "The cryptocontext has been deserialized." << std::endl;
+            uint64_t liveAfter = mem::liveBytes.load();
+            contextBytes = liveAfter > liveBefore ? liveAfter - liveBefore
+                                                  : (store ? refs.refs.at("cryptocontext").size : 0);
+        }
     
-    std::ifstream emkeys(DATAFOLDER + "/key-eval-mult.txt", std::ios::in | std::ios::binary);
-    if (!emkeys.is_open()) {
-        std::cerr << "I cannot read serialization from " << DATAFOLDER + "/key-eval-mult.txt" << std::endl;
-        return 1;
-    }
-    if (cc->DeserializeEvalMultKey(emkeys, SerType::BINARY) == false) {
-        std::cerr << "Could not deserialize the eval mult key file" << std::endl;
-        return 1;
-    }
-    std::cout << "Deserialized the eval mult keys." << std::endl;
+		Ciphertext<DCRTPoly> ciphertext1;
+
+		{
+            FHE_SPAN("deserialize:enc_file1");
+            if (deserializeAsync(ct1Bytes, ciphertext1) == false) {
+                std::cerr << "Could not read the ciphertext" << std::endl;
+                return false;
+            }
+        }
+        std::cout << "a ciphertext has been deserialized." << std::endl;
+
+        Ciphertext<DCRTPoly> ciphertext2;
+        {
+            FHE_SPAN("deserialize:enc_file2");
+            if (deserializeAsync(ct2Bytes, ciphertext2) == false) {
+                std::cerr << "Could not read the ciphertext" << std::endl;
+                return false;
+            }
+        }
+
+        // The keys are only needed by the first relinearization: unless
+        // --no-overlap, they are deserialized on their own thread while the
+        // first multiplications run without relinearizing. Nothing else is
+        // deserialized meanwhile, as OpenFHE's context registry is not
+        // thread-safe, and the eval key map is written under
+        // TenantCache::keyMapMutex(); the circuit only reads it from the
+        // relinearizations, which wait for this thread. The loader runs its
+        // parallel regions on one thread, so it does not start a second full
+        // OpenMP team next to the circuit's.
+        auto loadKeys = [&]() -> bool {
+            if (overlapKeys) setInnerThreads(1);
+            if (!tenant) {
+                FHE_SPAN("deserialize:key-eval-mult");
+                std::string emkeyData;
+                try {
+                    emkeyData = emkeyBytes.get();
+                } catch (const std::exception&) {
+                    std::cerr << "I cannot read serialization from " << DATAFOLDER + "/key-eval-mult.txt" << std::endl;
+                    return false;
+                }
+                MemoryStream emkeys(emkeyData);
+                std::lock_guard<std::mutex> lock(TenantCache::keyMapMutex());
+                if (cc->DeserializeEvalMultKey(emkeys, SerType::BINARY) == false) {
+                    std::cerr << "Could not deserialize the eval mult key file" << std::endl;
+                    return false;
+                }
+                std::cout << "Deserialized the eval mult keys." << std::endl;
+            }
+            if (!store) {
+                FHE_SPAN("deserialize:key-public");
+                PublicKey<DCRTPoly> pk;
+                if (deserializeAsync(pkBytes, pk) == false) {
+                    std::cerr << "Could not read public key" << std::endl;
+                    return false;
+                }
+                std::cout << "The public key has been deserialized." << std::endl;
+            }
+            return true;
+        };
+        std::shared_future<bool> keysLoaded =
+            std::async(overlapKeys ? std::launch::async : std::launch::deferred, loadKeys).share();
+        if (!overlapKeys && !keysLoaded.get()) return false;
+    
+        auto end_deserialize = std::chrono::high_resolution_clock::now();
+        memory.end("deserialize");
+    
+        // Time homomorphic computation
+        memory.begin("computation");
+        auto start_computation = std::chrono::high_resolution_clock::now();
     
-	Ciphertext<DCRTPoly> ciphertext1;
+        // CKKS with fixedmanual leaves rescaling to the circuit: every product
+        // is rescaled, one level down, and the i-th multiplication of a lane
+        // takes ciphertext2 brought down i levels, as both operands must be at
+        // the same level. The other techniques rescale and match levels within
+        // EvalMult.
+        const bool rescale = schemeConfig.manualRescale();
+        std::vector<Ciphertext<DCRTPoly>> factors(rescale ? std::max(depth, 1) : 1, ciphertext2);
+        for (size_t i = 1; i < factors.size(); i++) {
+            FHE_SPAN("LevelReduce");
+            factors[i] = ops.time("LevelReduce", factors[i - 1], [&] { return cc->LevelReduce(factors[i - 1], nullptr, 1); });
+        }
+        auto factor = [&](int i) -> const Ciphertext<DCRTPoly>& { return factors[rescale ? i : 0]; };
+        auto rescaled = [&](const Ciphertext<DCRTPoly>& product) {
+            if (!rescale) return product;
+            FHE_SPAN("Rescale");
+            return ops.time("Rescale", product, [&] { return cc->Rescale(product); });
+        };
 
-	if (Serial::DeserializeFromFile(DATAFOLDER + "/" + "enc_file1.txt", ciphertext1, SerType::BINARY) == false) {
-        std::cerr << "Could not read the ciphertext" << std::endl;
-    }
-    std::cout << "a ciphertext has been deserialized." << std::endl;
+        // One task per operation: lane l computes ciphertext1 * ciphertext2^depth
+        // in lanes[l], then a pairwise tree of EvalAdds sums the lanes into
+        // lanes[0]. The runtime starts a task once its operands are ready.
+        // While the keys are loading, the first multiplication of every lane is
+        // split, and its relinearization also waits for the keys task.
+        std::vector<Ciphertext<DCRTPoly>> lanes(width);
+        std::vector<Ciphertext<DCRTPoly>> products(width);
+        TaskGraph circuit;
+        std::vector<std::vector<size_t>> laneDone(width);
+        bool keysPending = keysLoaded.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+        double keyWaitTime = 0;
+        std::vector<size_t> keysReady;
+        if (keysPending && depth > 0) {
+            keysReady = {circuit.add([&, keysLoaded] {
+                FHE_SPAN("wait:key-eval-mult");
+                auto start = std::chrono::high_resolution_clock::now();
+                bool loaded = keysLoaded.get();
+                keyWaitTime += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+                if (!loaded) throw std::runtime_error("the eval mult keys could not be loaded");
+            })};
+        }
+        for (int l = 0; l < width; l++) {
+            for (int i = 0; i < depth; i++) {
+                if (splitRelin || (i == 0 && !keysReady.empty())) {
+                    size_t mult = circuit.add([&, l, i] {
+                        FHE_SPAN("EvalMultNoRelin");
+                        Ciphertext<DCRTPoly> input = lanes[l];
+                        products[l] = ops.time("EvalMultNoRelin", input, [&] {
+                            return cc->EvalMultNoRelin(input, factor(i));
+                        });
+                    }, laneDone[l]);
+                    std::vector<size_t> operands = {mult};
+                    if (i == 0) operands.insert(operands.end(), keysReady.begin(), keysReady.end());
+                    laneDone[l] = {circuit.add([&, l] {
+                        FHE_SPAN("Relinearize");
+                        lanes[l] = rescaled(ops.time("Relinearize", products[l], [&] { return cc->Relinearize(products[l]); }));
+                    }, operands)};
+                } else {
+                    laneDone[l] = {circuit.add([&, l, i] {
+                        FHE_SPAN("EvalMult");
+                        Ciphertext<DCRTPoly> input = lanes[l];
+                        lanes[l] = rescaled(ops.time("EvalMult", input, [&] { return cc->EvalMult(input, factor(i)); }));
+                    }, laneDone[l])};
+                }
+            }
+        }
+        for (int step = 1; step < width; step *= 2) {
+            for (int l = 0; l + step < width; l += 2 * step) {
+                std::vector<size_t> operands = laneDone[l];
+                operands.insert(operands.end(), laneDone[l + step].begin(), laneDone[l + step].end());
+                laneDone[l] = {circuit.add([&, l, step] {
+                    FHE_SPAN("EvalAdd");
+                    Ciphertext<DCRTPoly> input = lanes[l];
+                    lanes[l] = ops.time("EvalAdd", input, [&] { return cc->EvalAdd(input, lanes[l + step]); });
+                }, operands)};
+            }
+        }
 
-    Ciphertext<DCRTPoly> ciphertext2;
-    if (Serial::DeserializeFromFile(DATAFOLDER + "/" + "enc_file2.txt", ciphertext2, SerType::BINARY) == false) {
-        std::cerr << "Could not read the ciphertext" << std::endl;
-    }
+        Ciphertext<DCRTPoly> ciphertextMultResult;
+        try {
+            for (int pass = 0; pass < repeat; pass++) {
+                std::fill(lanes.begin(), lanes.end(), ciphertext1);
+                runtime.run(circuit);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error: Homomorphic evaluation failed: " << e.what() << std::endl;
+            return false;
+        }
+        ciphertextMultResult = lanes[0];
     
-    auto end_deserialize = std::chrono::high_resolution_clock::now();
+        auto end_computation = std::chrono::high_resolution_clock::now();
+        memory.end("computation");
+        if (!keysLoaded.get()) return false;
+
+        // The keys deserialized alongside the computation are charged their
+        // serialized size, as the heap grew for the ciphertexts meanwhile too
+        if (store && !tenant) {
+            TenantCache::Tenant loaded;
+            loaded.cc = cc;
+            for (const std::string& tag : TenantCache::loadedKeyTags()) {
+                if (tagsBefore.count(tag) == 0) loaded.keyTags.push_back(tag);
+            }
+            loaded.bytes = contextBytes + refs.refs.at("key-eval-mult").size;
+            uint64_t evictions = tenants.evictions();
+            cc = tenants.insert(tenantId, std::move(loaded)).cc;
+            // Evicted tenants' buffers went back to the pool: return their
+            // memory, or evicting would never lower the RSS
+            if (tenants.evictions() > evictions) {
+                metrics::add("fhe_pool_trimmed_bytes", "Memory of freed pool blocks returned to the kernel", {},
+                             double(mem::BufferPool::instance().trim()));
+            }
+        }
     
-    // Time homomorphic computation
-    auto start_computation = std::chrono::high_resolution_clock::now();
+        // Time serialization
+        memory.begin("serialize");
+        auto start_serialize = std::chrono::high_resolution_clock::now();
     
-    auto ciphertextMultResult = ciphertext1;
-    for (int i = 0; i < depth; i++) {
-        ciphertextMultResult = cc->EvalMult(ciphertextMultResult, ciphertext2);
-    }
+        //serializing the final result
+        {
+            FHE_SPAN("serialize:output_ciphertext");
+            if (store) {
+                std::string bytes = serializeToBytes(ciphertextMultResult);
+                uint64_t size = bytes.size();
+                std::string hash = bytes.empty() ? std::string() : store->put(std::move(bytes));
+                ArtifactRefs done = refs;
+                done.set("output_ciphertext", hash, size);
+                bool circuitStored = true;
+                if (schemeConfig.ckks()) {
+                    std::string circuit = circuitParametersText(width);
+                    uint64_t circuitSize = circuit.size();
+                    std::string circuitHash = store->put(std::move(circuit));
+                    circuitStored = !circuitHash.empty();
+                    done.set("circuit_params", circuitHash, circuitSize);
+                }
+                if (hash.empty() || !circuitStored || !io.drain() || !store->publish() || !store->writeRefs("jobs", jobName, done)) {
+                    std::cerr << "Error storing the output ciphertext of job " << jobName << std::endl;
+                    return false;
+                }
+            } else if (!serializeAsync(io, RESULTSFOLDER + "/" + "output_ciphertext.txt", ciphertextMultResult) ||
+                       (schemeConfig.ckks() && !io.write(RESULTSFOLDER + "/circuit_params.txt", circuitParametersText(width))) ||
+                       !io.drain()) {
+                std::cerr << "Error writing serialization of output ciphertext to output_ciphertext.txt" << std::endl;
+                return false;
+            }
+        }
+        std::cout << "The output ciphertext has been serialized." << std::endl;
     
-    auto end_computation = std::chrono::high_resolution_clock::now();
+        auto end_serialize = std::chrono::high_resolution_clock::now();
+        memory.end("serialize");
+        auto end_total = std::chrono::high_resolution_clock::now();
     
-    // Time serialization
-    auto start_serialize = std::chrono::high_resolution_clock::now();
+        // Calculate durations in nanoseconds
+        auto deserialize_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_deserialize - start_deserialize);
+        auto computation_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_computation - start_computation);
+        auto serialize_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_serialize - start_serialize);
+        auto total_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_total - start_total);
+
+        // Convert to seconds
+        double deserialize_time = deserialize_duration.count() / 1e9;
+        double computation_time = computation_duration.count() / 1e9 / repeat;
+        double serialize_time = serialize_duration.count() / 1e9;
+        double total_time = total_duration.count() / 1e9;
+        double io_wait_time = io.waitSeconds();
+
+        // Output timing results in a parseable format
+        std::cout << "=== TIMING_RESULTS ===" << std::endl;
+        if (store) {
+            std::cout << "MAIN_JOB: " << jobName << std::endl;
+        }
+        std::cout << "MAIN_DESERIALIZE_TIME: " << deserialize_time << std::endl;
+        std::cout << "MAIN_COMPUTATION_TIME: " << computation_time << std::endl;
+        std::cout << "MAIN_SERIALIZE_TIME: " << serialize_time << std::endl;
+        std::cout << "MAIN_TOTAL_TIME: " << total_time << std::endl;
+        std::cout << "MAIN_IO_WAIT_TIME: " << io_wait_time << std::endl;
+        std::cout << "MAIN_IO_BACKEND: " << io.backendName() << std::endl;
+        std::cout << "MAIN_EVAL_KEY_WAIT_TIME: " << keyWaitTime << std::endl;
+        if (schemeConfig.ckks()) {
+            std::cout << "MAIN_SCHEME: ckks " << scheme::scalingName(schemeConfig.scaling) << std::endl;
+            std::cout << "MAIN_OUTPUT_LEVEL: " << ciphertextMultResult->GetLevel() << std::endl;
+        }
+        if (width > 1 || runtime.workers() > 1) {
+            std::cout << "MAIN_WIDTH: " << width << std::endl;
+            std::cout << "MAIN_WORKERS: " << runtime.workers() << std::endl;
+            std::cout << "MAIN_INNER_THREADS: " << runtime.innerThreads() << std::endl;
+            std::cout << "MAIN_STEALS: " << runtime.steals() << std::endl;
+        }
+        memory.print(std::cout, "MAIN");
+        ops.print(std::cout, "MAIN");
+        if (store) {
+            std::cout << "MAIN_CACHE_HITS: " << tenants.hits() << std::endl;
+            std::cout << "MAIN_CACHE_MISSES: " << tenants.misses() << std::endl;
+            std::cout << "MAIN_CACHE_HIT_RATE: " << tenants.hitRate() << std::endl;
+            std::cout << "MAIN_CACHE_EVICTIONS: " << tenants.evictions() << std::endl;
+            std::cout << "MAIN_CACHE_TENANTS: " << tenants.size() << std::endl;
+            std::cout << "MAIN_CACHE_MB: " << tenants.bytes() / 1048576.0 << std::endl;
+        }
     
-    //serializing the final result
-    if (!Serial::SerializeToFile(RESULTSFOLDER + "/" + "output_ciphertext.txt", ciphertextMultResult, SerType::BINARY)) {
-        std::cerr << "Error writing serialization of output ciphertext to output_ciphertext.txt" << std::endl;
-        return 1;
+        // Save to CSV
+        std::vector<std::pair<std::string, double>> columns = {{"deserialize_time", deserialize_time},
+                                                               {"computation_time", computation_time},
+                                                               {"serialize_time", serialize_time},
+                                                               {"total_time", total_time},
+                                                               {"io_wait_time", io_wait_time}};
+        memory.appendColumns(columns);
+        schemeConfig.appendColumns(columns, schemeConfig.ckks() ? schemeConfig.slotCount(cc) : 0);
+        prof::saveTimingToCSV(schemeConfig.csvFile("main_timing_results.csv"), "computation", depth, modulus, security, columns);
+        metrics::recordPhase("computation", columns);
+        exporter.flush();
+        ops.saveCSV(schemeConfig.csvFile("main_op_levels.csv"), jobName, depth, modulus, security);
+        ops.clear();
+        return true;
+    };
+
+    size_t job = 0;
+    for (; job < jobNames.size(); job++) {
+        if (!runJob(job, jobNames[job])) return 1;
+    }
+    // Serving: stdin lines "NAME [class=interactive|batch] [deadline_ms=N]"
+    // are costed and admitted by a reader thread, and evaluated here in the
+    // scheduler's order. Every job ends with a MAIN_JOB_DONE line (ok, failed
+    // or rejected), which tells a coordinator driving this process
+    // (fhe-shard) that it is over; each is written in one piece, as the
+    // reader reports rejections while a job runs.
+    int failures = 0;
+    if (serve) {
+        sched::Scheduler scheduler(schedOptions);
+        metrics::Callback queueDepth("fhe_job_queue_depth", "Served jobs waiting to run", metrics::Type::Gauge, {},
+                                     [&] { return double(scheduler.depth()); });
+        auto done = [](const std::string& name, const std::string& status) {
+            std::cout << ("MAIN_JOB_DONE: " + name + " " + status + "\n") << std::flush;
+        };
+
+        std::thread reader([&] {
+            std::string line;
+            while (std::getline(std::cin, line)) {
+                std::istringstream fields(line);
+                sched::Job request;
+                if (!(fields >> request.name)) continue;
+                request.cls = sched::Class::Interactive;
+                std::string field;
+                bool valid = true;
+                while (fields >> field) {
+                    size_t eq = field.find('=');
+                    std::string key = field.substr(0, eq), value = eq == std::string::npos ? "" : field.substr(eq + 1);
+                    if (key == "class" && sched::parseClass(value, request.cls)) continue;
+                    if (key == "deadline_ms" && !value.empty() && value.find_first_not_of("0123456789") == std::string::npos) {
+                        request.hardDeadline = true;
+                        request.deadline = sched::Clock::now() + std::chrono::milliseconds(std::stoll(value));
+                        continue;
+                    }
+                    std::cerr << "Error: job " << request.name << ": unknown field " << field << std::endl;
+                    valid = false;
+                }
+                ArtifactRefs refs;
+                std::tuple<int, int, int> config;
+                if (!valid || !loadStoredJob(*store, request.name, refs, config)) {
+                    done(request.name, "failed");
+                    continue;
+                }
+                request.units = sched::CostModel::units(std::get<0>(config), width, refs.refs.at("enc_file1").size);
+                std::string reason = scheduler.submit(request);
+                if (!reason.empty()) {
+                    metrics::add("fhe_jobs_rejected", "Served jobs turned away by admission control", {{"reason", reason}});
+                    done(request.name, "rejected " + reason);
+                }
+            }
+            scheduler.close();
+        });
+
+        std::map<sched::Class, LatencyHistogram> latency;
+        uint64_t missed = 0;
+        sched::Job next;
+        while (scheduler.next(next)) {
+            auto start = sched::Clock::now();
+            bool ok = runJob(job++, next.name);
+            auto end = sched::Clock::now();
+            scheduler.finished(next, ok ? std::chrono::duration<double>(end - start).count() : 0);
+            if (ok) {
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - next.arrival).count();
+                latency[next.cls].record(static_cast<uint64_t>(ns));
+                metrics::observe("fhe_job_latency_seconds", "Arrival to completion of served jobs",
+                                 {{"class", sched::className(next.cls)}}, ns / 1e9);
+                if (next.hardDeadline && end > next.deadline) missed++;
+            } else {
+                std::cerr << "Error: job " << next.name << " failed" << std::endl;
+                failures++;
+            }
+            done(next.name, ok ? "ok" : "failed");
+        }
+        reader.join();
+
+        for (const auto& [cls, h] : latency) {
+            std::string prefix = cls == sched::Class::Interactive ? "MAIN_SCHED_INTERACTIVE" : "MAIN_SCHED_BATCH";
+            std::cout << prefix << "_JOBS: " << h.count() << std::endl;
+            std::cout << prefix << "_P50_MS: " << h.percentile(0.50) / 1e6 << std::endl;
+            std::cout << prefix << "_P99_MS: " << h.percentile(0.99) / 1e6 << std::endl;
+        }
+        std::cout << "MAIN_SCHED_REJECTED: " << scheduler.rejected() << std::endl;
+        std::cout << "MAIN_SCHED_DEADLINE_MISSES: " << missed << std::endl;
     }
-    std::cout << "The output ciphertext has been serialized." << std::endl;
-    
-    auto end_serialize = std::chrono::high_resolution_clock::now();
-    auto end_total = std::chrono::high_resolution_clock::now();
-    
-    // Calculate durations in microseconds
-    auto deserialize_duration = std::chrono::duration_cast<std::chrono::microseconds>(end_deserialize - start_deserialize);
-    auto computation_duration = std::chrono::duration_cast<std::chrono::microseconds>(end_computation - start_computation);
-    auto serialize_duration = std::chrono::duration_cast<std::chrono::microseconds>(end_serialize - start_serialize);
-    auto total_duration = std::chrono::duration_cast<std::chrono::microseconds>(end_total - start_total);
-
-    // Convert to seconds
-    double deserialize_time = deserialize_duration.count() / 1000000.0;
-    double computation_time = computation_duration.count() / 1000000.0;
-    double serialize_time = serialize_duration.count() / 1000000.0;
-    double total_time = total_duration.count() / 1000000.0;
-
-    // Output timing results in a parseable format
-    std::cout << "=== TIMING_RESULTS ===" << std::endl;
-    std::cout << "MAIN_DESERIALIZE_TIME: " << deserialize_time << std::endl;
-    std::cout << "MAIN_COMPUTATION_TIME: " << computation_time << std::endl;
-    std::cout << "MAIN_SERIALIZE_TIME: " << serialize_time << std::endl;
-    std::cout << "MAIN_TOTAL_TIME: " << total_time << std::endl;
-    
-    // Save to CSV
-    saveTimingToCSV("computation", depth, modulus, security,
-                    deserialize_time, computation_time, serialize_time, total_time);
     
     //////////////////////////////
     //////////////////////////////
       
     //main return value
-    return 0;
+    return failures == 0 ? 0 : 1;
 }
@@ -0,0 +1,159 @@
+//PER-OPERATION LATENCY HISTOGRAMS BY CIPHERTEXT LEVEL
+//
+// Every homomorphic operation fhe-main performs is timed and filed under its
+// name, the level of its input ciphertext and that ciphertext's tower count.
+// Each (operation, level, towers) cell keeps a log-linear histogram in the
+// style of HdrHistogram: values are exact below 128 ns and within 1/128
+// (under 1%) above, up to 2^40 ns (about 18 minutes, longer than any one
+// operation runs), in a fixed 34 KB. Longer latencies fall in the top bucket;
+// the maximum is still kept exactly.
+//
+// Read together, the cells form a per-level cost curve: the latency of one
+// EvalMult (or, split, of its tensor product and its key switch) at each
+// level, from which the runtime of any circuit of known shape follows.
+
+#ifndef FHE_OP_PROFILE_H
+#define FHE_OP_PROFILE_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+#include "profiling.h"
+#include "metrics.h"
+
+class LatencyHistogram {
+public:
+    void record(uint64_t ns) {
+        counts_[index(ns)]++;
+        count_++;
+        sum_ += ns;
+        min_ = std::min(min_, ns);
+        max_ = std::max(max_, ns);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < counts_.size(); i++) counts_[i] += other.counts_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t min() const { return count_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0; }
+
+    // Highest value equivalent to the q-th quantile (0 < q <= 1), as HdrHistogram reports it
+    uint64_t percentile(double q) const {
+        if (count_ == 0) return 0;
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * count_)));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); i++) {
+            seen += counts_[i];
+            if (seen >= rank) return i + 1 < counts_.size() ? std::min(highestEquivalent(i), max_) : max_;
+        }
+        return max_;
+    }
+
+private:
+    static constexpr int SubBits = 7;
+    static constexpr uint64_t SubBuckets = uint64_t(1) << SubBits;
+    static constexpr int TopBits = 40;  // values from 2^40 ns are counted as 2^40 - 1
+
+    static size_t index(uint64_t v) {
+        if (v < SubBuckets) return static_cast<size_t>(v);
+        v = std::min(v, (uint64_t(1) << TopBits) - 1);
+        int shift = (63 - __builtin_clzll(v)) - SubBits;
+        return static_cast<size_t>((shift + 1) * SubBuckets + ((v >> shift) - SubBuckets));
+    }
+
+    static uint64_t highestEquivalent(size_t i) {
+        if (i < SubBuckets) return i;
+        int shift = static_cast<int>(i / SubBuckets) - 1;
+        uint64_t lowest = (SubBuckets + i % SubBuckets) << shift;
+        return lowest + ((uint64_t(1) << shift) - 1);
+    }
+
+    std::array<uint64_t, (TopBits - SubBits + 1) * SubBuckets> counts_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = UINT64_MAX;
+    uint64_t max_ = 0;
+};
+
+class OpProfile {
+public:
+    // Run `f`, filing its latency under `op` and the level and tower count of `input`
+    template <typename Ct, typename F>
+    auto time(const char* op, const Ct& input, F&& f) -> decltype(f()) {
+        uint32_t level = static_cast<uint32_t>(input->GetLevel());
+        uint32_t towers = static_cast<uint32_t>(input->GetElements()[0].GetNumOfElements());
+        auto start = std::chrono::steady_clock::now();
+        auto result = f();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        {
+            // Operations may be timed from several workers of a TaskRuntime
+            std::lock_guard<std::mutex> lock(mutex_);
+            cells_[{op, level, towers}].record(static_cast<uint64_t>(ns));
+        }
+        metrics::observe("fhe_operation_duration_seconds", "Latency of each homomorphic operation by input level",
+                         {{"op", op}, {"level", std::to_string(level)}}, ns / 1e9);
+        return result;
+    }
+
+    bool empty() const { return cells_.empty(); }
+    void clear() { cells_.clear(); }
+
+    // One "PREFIX_OP: ..." line per cell, latencies in milliseconds
+    void print(std::ostream& out, const std::string& prefix) const {
+        out << std::fixed << std::setprecision(3);
+        for (const auto& [key, h] : cells_) {
+            const auto& [op, level, towers] = key;
+            out << prefix << "_OP: " << op << " level=" << level << " towers=" << towers
+                << " count=" << h.count() << " p50_ms=" << h.percentile(0.50) / 1e6
+                << " p99_ms=" << h.percentile(0.99) / 1e6 << " max_ms=" << h.max() / 1e6 << std::endl;
+        }
+        out.unsetf(std::ios::floatfield);
+        out << std::setprecision(6);
+    }
+
+    // Append the cost curve to csvFile, one row per (operation, level, towers)
+    void saveCSV(const std::string& csvFile, const std::string& job, int depth, int modulus, int security) const {
+        bool fileExists = std::ifstream(csvFile).good();
+        std::ofstream out(csvFile, std::ios::app);
+        if (!out.is_open()) {
+            std::cerr << "Error: Could not open CSV file for writing: " << csvFile << std::endl;
+            return;
+        }
+        if (!fileExists) {
+            out << "timestamp,job,depth,modulus,security,op,level,towers,count,"
+                << "mean_ns,min_ns,p50_ns,p90_ns,p99_ns,p999_ns,max_ns" << std::endl;
+        }
+        const std::string ts = prof::timestamp();
+        for (const auto& [key, h] : cells_) {
+            const auto& [op, level, towers] = key;
+            out << ts << "," << job << "," << depth << "," << modulus << "," << security << "," << op << ","
+                << level << "," << towers << "," << h.count() << "," << static_cast<uint64_t>(h.mean()) << ","
+                << h.min() << "," << h.percentile(0.50) << "," << h.percentile(0.90) << ","
+                << h.percentile(0.99) << "," << h.percentile(0.999) << "," << h.max() << "\n";
+        }
+        std::cout << "Per-level operation costs saved to " << csvFile << std::endl;
+    }
+
+private:
+    std::map<std::tuple<std::string, uint32_t, uint32_t>, LatencyHistogram> cells_;
+    std::mutex mutex_;
+};
+
+#endif // FHE_OP_PROFILE_H
@@ -0,0 +1,631 @@
+//IN-BINARY PROFILING : NESTED SPANS, HARDWARE COUNTERS AND THE SHARED TIMING CSV
+//
+// FHE_SPAN("name") times the enclosing scope with steady_clock (nanoseconds)
+// and records its nesting. Spans are kept in per-thread buffers and written
+// once, at the end of the run, to profile_spans.csv; the schema is the same
+// for the encryption, computation and decryption phases. A buffer keeps the
+// last FHE_PROFILE_MAX_SPANS spans of its thread (default 100000, about 8 MB)
+// and overwrites the oldest beyond that, so fhe-main --serve does not grow
+// without bound; the spans dropped are counted.
+//
+//   FHE_PROFILE=1            record spans (default off: one predictable
+//                            branch per span; fhe-bench's ProfiledChain and
+//                            UnprofiledChain measure what recording costs)
+//   FHE_PROFILE_COUNTERS=1   also read cycles, instructions, cache misses and
+//                            page faults per span through perf_event_open
+//   FHE_TRACE=1|FILE         append the spans as Chrome trace events to
+//                            fhe_trace.json (or FILE), for chrome://tracing
+//                            and ui.perfetto.dev
+//   -DFHE_NO_PROFILING       compile the spans out entirely
+//
+// Counters are optional: if perf_event_open is not permitted (containers
+// without CAP_PERFMON, SGX enclaves) spans are recorded without them.
+//
+// A trace has one track per thread, named after its OS thread id. Threads that
+// never open a span (OpenMP workers inside OpenFHE, the io_uring reaper) are
+// sampled instead: every FHE_TRACE_SAMPLE_US (default 1000) the CPU time of
+// each thread of the process is read from /proc, and its busy fraction becomes
+// a counter track, next to a "busy cores" total. Timestamps are CLOCK_MONOTONIC,
+// so fhe-enc, fhe-main and fhe-dec appending to the same file line up on one
+// timeline.
+
+#ifndef FHE_PROFILING_H
+#define FHE_PROFILING_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <initializer_list>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace prof {
+
+inline uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline bool envFlag(const char* name) {
+    const char* v = std::getenv(name);
+    return v != nullptr && v[0] != '\0' && std::strcmp(v, "0") != 0;
+}
+
+// Chrome trace file named by FHE_TRACE, empty when tracing is off
+inline const std::string& traceFile() {
+    static const std::string file = [] {
+        const char* v = std::getenv("FHE_TRACE");
+        if (v == nullptr || v[0] == '\0' || std::strcmp(v, "0") == 0) return std::string();
+        return std::strcmp(v, "1") == 0 ? std::string("fhe_trace.json") : std::string(v);
+    }();
+    return file;
+}
+
+inline std::atomic<bool>& enabledFlag() {
+    static std::atomic<bool> on{envFlag("FHE_PROFILE") || !traceFile().empty()};
+    return on;
+}
+
+inline bool enabled() {
+    return enabledFlag().load(std::memory_order_relaxed);
+}
+
+// Record spans from now on, or stop; for benchmarks timing both
+inline void setEnabled(bool on) {
+    enabledFlag().store(on, std::memory_order_relaxed);
+}
+
+inline size_t maxSpans() {
+    static const size_t max = [] {
+        const char* v = std::getenv("FHE_PROFILE_MAX_SPANS");
+        unsigned long long n = v ? std::strtoull(v, nullptr, 10) : 0;
+        return n > 0 ? static_cast<size_t>(n) : size_t(100000);
+    }();
+    return max;
+}
+
+inline uint32_t osThreadId() {
+    return static_cast<uint32_t>(::syscall(SYS_gettid));
+}
+
+enum Counter { Cycles, Instructions, CacheMisses, PageFaults, NumCounters };
+
+// One perf event group per thread, read with a single read() per sample.
+class Counters {
+public:
+    static Counters& forThread() {
+        thread_local Counters counters;
+        return counters;
+    }
+
+    bool ok() const { return leader_ >= 0; }
+
+    bool read(uint64_t out[NumCounters]) const {
+        if (leader_ < 0) return false;
+        // PERF_FORMAT_GROUP layout: nr, then one value per event
+        uint64_t buf[1 + NumCounters];
+        if (::read(leader_, buf, sizeof(buf)) != static_cast<ssize_t>(sizeof(buf))) return false;
+        for (int i = 0; i < NumCounters; i++) out[i] = buf[1 + i];
+        return true;
+    }
+
+    ~Counters() {
+        for (int fd : fds_) ::close(fd);
+    }
+
+private:
+    Counters() {
+        static const bool wanted = enabled() && envFlag("FHE_PROFILE_COUNTERS");
+        if (!wanted) return;
+        const std::pair<uint32_t, uint64_t> events[NumCounters] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+        };
+        for (const auto& [type, config] : events) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = config;
+            attr.read_format = PERF_FORMAT_GROUP;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.disabled = fds_.empty() ? 1 : 0;
+            int fd = static_cast<int>(::syscall(__NR_perf_event_open, &attr, 0, -1,
+                                                fds_.empty() ? -1 : fds_[0], 0));
+            if (fd < 0) {
+                for (int open : fds_) ::close(open);
+                fds_.clear();
+                return;
+            }
+            fds_.push_back(fd);
+        }
+        leader_ = fds_[0];
+        ::ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ::ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    std::vector<int> fds_;
+    int leader_ = -1;
+};
+
+struct SpanRecord {
+    const char* name;
+    uint32_t id;
+    uint32_t parent;
+    uint32_t depth;
+    uint32_t thread;
+    uint64_t startNs;
+    uint64_t durationNs;
+    bool hasCounters;
+    uint64_t counters[NumCounters];
+};
+
+// Spans finished on one thread; registered with the session on first use.
+// A ring of at most maxSpans() records: past that, each span overwrites the
+// oldest one.
+struct ThreadBuffer {
+    std::vector<SpanRecord> spans;
+    size_t oldest = 0;
+    uint64_t dropped = 0;
+    uint32_t thread = 0;
+    uint32_t osThread = 0;
+    uint32_t nextId = 1;
+    uint32_t current = 0;
+    uint32_t depth = 0;
+
+    void record(const SpanRecord& rec) {
+        if (spans.size() < maxSpans()) {
+            spans.push_back(rec);
+            return;
+        }
+        spans[oldest] = rec;
+        oldest = (oldest + 1) % spans.size();
+        dropped++;
+    }
+
+    // The spans kept, oldest first
+    template <typename F>
+    void forEachSpan(F&& f) const {
+        for (size_t i = 0; i < spans.size(); i++) f(spans[(oldest + i) % spans.size()]);
+    }
+};
+
+class Registry {
+public:
+    static Registry& get() {
+        static Registry registry;
+        return registry;
+    }
+
+    ThreadBuffer& local() {
+        thread_local ThreadBuffer* buffer = nullptr;
+        if (buffer == nullptr) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            buffers_.push_back(std::make_unique<ThreadBuffer>());
+            buffer = buffers_.back().get();
+            buffer->thread = static_cast<uint32_t>(buffers_.size() - 1);
+            buffer->osThread = osThreadId();
+            buffer->spans.reserve(std::min<size_t>(1024, maxSpans()));
+        }
+        return *buffer;
+    }
+
+    template <typename F>
+    void forEach(F&& f) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& b : buffers_) f(*b);
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+};
+
+class Span {
+public:
+    explicit Span(const char* name) {
+        if (!enabled()) return;
+        ThreadBuffer& tb = Registry::get().local();
+        buffer_ = &tb;
+        rec_.name = name;
+        rec_.id = tb.nextId++;
+        rec_.parent = tb.current;
+        rec_.depth = tb.depth++;
+        rec_.thread = tb.thread;
+        tb.current = rec_.id;
+        rec_.hasCounters = Counters::forThread().read(rec_.counters);
+        rec_.startNs = nowNs();
+    }
+
+    ~Span() {
+        if (buffer_ == nullptr) return;
+        rec_.durationNs = nowNs() - rec_.startNs;
+        if (rec_.hasCounters) {
+            uint64_t end[NumCounters];
+            rec_.hasCounters = Counters::forThread().read(end);
+            for (int i = 0; i < NumCounters; i++) rec_.counters[i] = end[i] - rec_.counters[i];
+        }
+        buffer_->current = rec_.parent;
+        buffer_->depth--;
+        buffer_->record(rec_);
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    ThreadBuffer* buffer_ = nullptr;
+    SpanRecord rec_;
+};
+
+// Busy fraction of every thread of the process over time, read from
+// /proc/self/task/<tid>/schedstat (nanoseconds on CPU) or, where that is
+// missing, from the utime and stime ticks of /proc/self/task/<tid>/stat.
+class CpuSampler {
+public:
+    struct Level {
+        uint64_t ns;
+        uint32_t tid;   // 0 for the busy-cores total
+        float busy;
+    };
+
+    ~CpuSampler() { stop(); }
+
+    void start(uint64_t periodNs) {
+        if (thread_.joinable()) return;
+        running_ = true;
+        thread_ = std::thread([this, periodNs] { run(periodNs); });
+    }
+
+    void stop() {
+        if (!thread_.joinable()) return;
+        running_ = false;
+        thread_.join();
+    }
+
+    // Valid once stopped
+    const std::vector<Level>& levels() const { return levels_; }
+    const std::map<uint32_t, std::string>& names() const { return names_; }
+
+private:
+    static bool readCpuNs(uint32_t tid, uint64_t& ns) {
+        const std::string dir = "/proc/self/task/" + std::to_string(tid);
+        if (std::ifstream sched{dir + "/schedstat"}; sched >> ns) return true;
+        std::ifstream stat(dir + "/stat");
+        std::string line;
+        if (!std::getline(stat, line)) return false;
+        size_t close = line.rfind(')');
+        if (close == std::string::npos) return false;
+        std::istringstream fields(line.substr(close + 2));
+        std::string field;
+        uint64_t utime = 0, stime = 0;
+        // state is field 3 of stat, utime and stime are fields 14 and 15
+        for (int i = 3; i <= 15 && fields >> field; i++) {
+            if (i == 14) utime = std::stoull(field);
+            if (i == 15) stime = std::stoull(field);
+        }
+        static const long ticks = ::sysconf(_SC_CLK_TCK);
+        ns = (utime + stime) * (1000000000ull / static_cast<uint64_t>(ticks > 0 ? ticks : 100));
+        return true;
+    }
+
+    std::map<uint32_t, uint64_t> sample() {
+        std::map<uint32_t, uint64_t> cpu;
+        DIR* dir = ::opendir("/proc/self/task");
+        if (dir == nullptr) return cpu;
+        while (dirent* entry = ::readdir(dir)) {
+            if (entry->d_name[0] < '0' || entry->d_name[0] > '9') continue;
+            uint32_t tid = static_cast<uint32_t>(std::strtoul(entry->d_name, nullptr, 10));
+            uint64_t ns;
+            if (tid == self_ || !readCpuNs(tid, ns)) continue;
+            cpu[tid] = ns;
+            if (names_.count(tid) == 0) {
+                std::ifstream comm("/proc/self/task/" + std::to_string(tid) + "/comm");
+                std::string name;
+                std::getline(comm, name);
+                names_[tid] = name;
+            }
+        }
+        ::closedir(dir);
+        return cpu;
+    }
+
+    void run(uint64_t periodNs) {
+        self_ = osThreadId();
+        std::map<uint32_t, uint64_t> last = sample();
+        std::map<uint32_t, float> shown;
+        float shownTotal = -1;
+        uint64_t prev = nowNs();
+        while (running_) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(periodNs));
+            uint64_t now = nowNs();
+            std::map<uint32_t, uint64_t> cpu = sample();
+            double elapsed = static_cast<double>(now - prev);
+            double total = 0;
+            for (const auto& [tid, ns] : cpu) {
+                auto it = last.find(tid);
+                uint64_t before = it == last.end() ? ns : it->second;
+                double busy = std::min(1.0, static_cast<double>(ns - before) / elapsed);
+                total += busy;
+                // 5% steps, and only changes: an idle or saturated thread costs one event
+                float level = static_cast<float>(std::round(busy * 20) / 20);
+                auto seen = shown.find(tid);
+                if (seen == shown.end() || seen->second != level) {
+                    levels_.push_back({prev, tid, level});
+                    shown[tid] = level;
+                }
+            }
+            for (auto it = shown.begin(); it != shown.end();) {
+                if (cpu.count(it->first) == 0) {
+                    if (it->second != 0) levels_.push_back({prev, it->first, 0});
+                    it = shown.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            float totalLevel = static_cast<float>(std::round(total * 20) / 20);
+            if (totalLevel != shownTotal) {
+                levels_.push_back({prev, 0, totalLevel});
+                shownTotal = totalLevel;
+            }
+            last.swap(cpu);
+            prev = now;
+        }
+    }
+
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+    uint32_t self_ = 0;
+    std::vector<Level> levels_;
+    std::map<uint32_t, std::string> names_;
+};
+
+inline std::string jsonEscape(const std::string& in) {
+    std::string out;
+    for (char c : in) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+// Append this process's spans and CPU samples to a Chrome trace file. The file
+// stays one valid JSON object: the closing tail is overwritten by each writer,
+// under an exclusive flock so concurrent binaries cannot interleave.
+inline bool appendChromeTrace(const std::string& file, const std::string& process, const CpuSampler& cpu) {
+    static const std::string head = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    static const std::string tail = "\n]}\n";
+    const long pid = static_cast<long>(::getpid());
+    std::ostringstream ev;
+    ev << std::fixed << std::setprecision(3);
+    auto us = [](uint64_t ns) { return ns / 1000.0; };
+
+    ev << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" << pid
+       << ",\"args\":{\"name\":\"" << jsonEscape(process) << "\"}}";
+    std::map<uint32_t, std::string> threads = cpu.names();
+    Registry::get().forEach([&](const ThreadBuffer& tb) {
+        std::string& name = threads[tb.osThread];
+        name = (tb.thread == 0 ? "main" : "thread " + std::to_string(tb.thread)) +
+               (name.empty() ? "" : " (" + name + ")");
+    });
+    for (const auto& [tid, name] : threads) {
+        ev << ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid << ",\"tid\":" << tid
+           << ",\"args\":{\"name\":\"" << jsonEscape(name) << "\"}}";
+    }
+
+    Registry::get().forEach([&](const ThreadBuffer& tb) {
+        tb.forEachSpan([&](const SpanRecord& s) {
+            ev << ",\n{\"ph\":\"X\",\"cat\":\"fhe\",\"name\":\"" << jsonEscape(s.name) << "\",\"pid\":" << pid
+               << ",\"tid\":" << tb.osThread << ",\"ts\":" << us(s.startNs) << ",\"dur\":" << us(s.durationNs);
+            if (s.hasCounters) {
+                ev << ",\"args\":{\"cycles\":" << s.counters[Cycles] << ",\"instructions\":" << s.counters[Instructions]
+                   << ",\"cache_misses\":" << s.counters[CacheMisses] << ",\"page_faults\":" << s.counters[PageFaults] << "}";
+            }
+            ev << "}";
+        });
+    });
+
+    for (const CpuSampler::Level& l : cpu.levels()) {
+        std::string track = "busy cores";
+        if (l.tid != 0) {
+            auto it = threads.find(l.tid);
+            track = "cpu " + std::to_string(l.tid) + (it == threads.end() ? "" : " " + it->second);
+        }
+        ev << ",\n{\"ph\":\"C\",\"cat\":\"cpu\",\"name\":\"" << jsonEscape(track) << "\",\"pid\":" << pid
+           << ",\"ts\":" << us(l.ns) << ",\"args\":{\"busy\":" << std::setprecision(2) << l.busy
+           << std::setprecision(3) << "}}";
+    }
+
+    int fd = ::open(file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: Could not open trace file for writing: " << file << std::endl;
+        return false;
+    }
+    ::flock(fd, LOCK_EX);
+    struct stat st;
+    off_t size = ::fstat(fd, &st) == 0 ? st.st_size : 0;
+    std::string out;
+    off_t at = 0;
+    if (size == 0) {
+        out = head + ev.str() + tail;
+    } else {
+        std::string end(tail.size(), '\0');
+        at = size - static_cast<off_t>(tail.size());
+        bool ours = at >= static_cast<off_t>(head.size()) &&
+                    ::pread(fd, &end[0], end.size(), at) == static_cast<ssize_t>(end.size()) && end == tail;
+        if (!ours) {
+            std::cerr << "Error: " << file << " is not a trace written by these binaries, not appending" << std::endl;
+            ::close(fd);
+            return false;
+        }
+        out = ",\n" + ev.str() + tail;
+    }
+    bool ok = ::pwrite(fd, out.data(), out.size(), at) == static_cast<ssize_t>(out.size());
+    ::close(fd);
+    if (!ok) std::cerr << "Error: Could not write trace file: " << file << std::endl;
+    return ok;
+}
+
+inline std::string timestamp() {
+    auto now = std::chrono::system_clock::now();
+    auto time_t = std::chrono::system_clock::to_time_t(now);
+    auto tm = *std::localtime(&time_t);
+    std::ostringstream out;
+    out << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
+    return out.str();
+}
+
+// Append one row to a phase timing CSV, writing the header if the file is new.
+// Times are in seconds; the column names are the ones tests.py consolidates.
+inline void saveTimingToCSV(const std::string& csvFile, const std::string& phase,
+                            int depth, int modulus, int security,
+                            const std::vector<std::pair<std::string, double>>& times) {
+    bool fileExists = std::ifstream(csvFile).good();
+
+    std::ofstream outFile(csvFile, std::ios::app);
+    if (!outFile.is_open()) {
+        std::cerr << "Error: Could not open CSV file for writing: " << csvFile << std::endl;
+        return;
+    }
+
+    if (!fileExists) {
+        outFile << "timestamp,phase,depth,modulus,security";
+        for (const auto& t : times) outFile << "," << t.first;
+        outFile << std::endl;
+    }
+
+    outFile << timestamp() << "," << phase << "," << depth << "," << modulus << "," << security;
+    outFile << std::fixed << std::setprecision(10);
+    for (const auto& t : times) outFile << "," << t.second;
+    outFile << std::endl;
+
+    outFile.close();
+    std::cout << "Timing results saved to " << csvFile << std::endl;
+}
+
+// Seconds between two steady/high_resolution clock points, at full resolution
+template <typename T>
+double seconds(const T& start, const T& end) {
+    return std::chrono::duration<double>(end - start).count();
+}
+
+// Writes every recorded span of the run to profile_spans.csv when it goes out
+// of scope, tagged with the phase and parameters of the binary.
+class Session {
+public:
+    Session(std::string phase, const std::string& csvFile = "profile_spans.csv")
+        : phase_(std::move(phase)), csvFile_(csvFile) {
+        if (traceFile().empty()) return;
+        const char* period = std::getenv("FHE_TRACE_SAMPLE_US");
+        long us = period ? std::atol(period) : 1000;
+        if (us > 0) cpu_.start(static_cast<uint64_t>(us) * 1000);
+    }
+
+    void setParameters(int depth, int modulus, int security) {
+        depth_ = depth;
+        modulus_ = modulus;
+        security_ = security;
+    }
+
+    ~Session() {
+        if (!traceFile().empty()) {
+            cpu_.stop();
+            std::string process = std::string(program_invocation_short_name) + " " + phase_ + " d=" +
+                                  std::to_string(depth_) + " m=" + std::to_string(modulus_) +
+                                  " s=" + std::to_string(security_);
+            if (appendChromeTrace(traceFile(), process, cpu_)) {
+                std::cout << "Trace events saved to " << traceFile() << std::endl;
+            }
+        }
+        if (!envFlag("FHE_PROFILE")) return;
+        bool fileExists = std::ifstream(csvFile_).good();
+        std::ofstream out(csvFile_, std::ios::app);
+        if (!out.is_open()) {
+            std::cerr << "Error: Could not open CSV file for writing: " << csvFile_ << std::endl;
+            return;
+        }
+        if (!fileExists) {
+            out << "timestamp,pid,phase,depth,modulus,security,thread,span_id,parent_id,level,name,"
+                << "start_ns,duration_ns,cycles,instructions,cache_misses,page_faults" << std::endl;
+        }
+        const std::string ts = timestamp();
+        const long pid = static_cast<long>(::getpid());
+        size_t written = 0;
+        uint64_t dropped = 0;
+        Registry::get().forEach([&](const ThreadBuffer& tb) {
+            dropped += tb.dropped;
+            tb.forEachSpan([&](const SpanRecord& s) {
+                out << ts << "," << pid << "," << phase_ << "," << depth_ << "," << modulus_ << ","
+                    << security_ << "," << s.thread << "," << s.id << "," << s.parent << ","
+                    << s.depth << "," << s.name << "," << s.startNs << "," << s.durationNs;
+                for (int i = 0; i < NumCounters; i++) {
+                    out << ",";
+                    if (s.hasCounters) out << s.counters[i];
+                }
+                out << "\n";
+                written++;
+            });
+        });
+        std::cout << "Profile spans (" << written << ") saved to " << csvFile_ << std::endl;
+        if (dropped > 0) {
+            std::cout << "Profile spans dropped: " << dropped << " (the oldest; raise FHE_PROFILE_MAX_SPANS to keep them)"
+                      << std::endl;
+        }
+    }
+
+private:
+    std::string phase_;
+    std::string csvFile_;
+    int depth_ = 0;
+    int modulus_ = 0;
+    int security_ = 0;
+    CpuSampler cpu_;
+};
+
+} // namespace prof
+
+#define FHE_PROF_CAT2(a, b) a##b
+#define FHE_PROF_CAT(a, b) FHE_PROF_CAT2(a, b)
+#ifdef FHE_NO_PROFILING
+#define FHE_SPAN(name) ((void)0)
+#else
+#define FHE_SPAN(name) ::prof::Span FHE_PROF_CAT(fheSpan_, __LINE__)(name)
+#endif
+
+#endif // FHE_PROFILING_H
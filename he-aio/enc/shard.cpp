@@ -0,0 +1,500 @@
+//SHARDED EVALUATION OF ONE JOB ACROSS SEVERAL FHE-MAIN WORKERS
+//
+// A job too large for one process is stored as shards: jobs NAME.0, NAME.1,
+// ... encrypted under one keyset (fhe-enc --store --keyset K --job NAME.i).
+// fhe-shard starts N workers, each a `fhe-main --serve` process or any command
+// speaking its protocol (job names on stdin, a MAIN_JOB_DONE line per job on
+// stdout), e.g. `docker exec -i <container> ./fhe-main --serve` for a worker
+// per container. Every worker is handed its next shard as soon as it reports
+// the previous one done, loads the shared context and eval keys once (they
+// stay in its tenant cache) and holds one shard at a time, so its memory does
+// not grow with the job.
+//
+// Once every shard is evaluated, the coordinator merges their output
+// ciphertexts homomorphically with a pairwise EvalAdd (or EvalMult) tree and
+// records the result as job NAME, for `fhe-dec --store --job NAME`:
+//
+//   ./fhe-shard --job NAME [--workers N] [--worker-cmd CMD] [--merge add|mult]
+//
+// An EvalMult tree takes log2(shards) more levels than the circuit did; it is
+// refused unless the shards' outputs have that many left. The default workers
+// share the cores: each gets --inner-threads cores/N.
+
+#include "openfhe.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// header files needed for serialization
+#include "ciphertext-ser.h"
+#include "cryptocontext-ser.h"
+#include "key/key-ser.h"
+#include "scheme/bgvrns/bgvrns-ser.h"
+
+#include "async-io.h"
+#include "artifact-store.h"
+#include "profiling.h"
+#include "task-runtime.h"
+
+using namespace lbcrypto;
+using Clock = std::chrono::steady_clock;
+
+const std::string STOREFOLDER = "store";
+const std::string WORKERCOMMAND = "./fhe-main --serve";
+const std::string RESULTSFILE = "shard_timing_results.csv";
+
+std::tuple<int, int, int> parseConfigParameters(std::istream& in) {
+    int depth = 8;      // Default value
+    int modulus = 65537; // Default value
+    int security = 128;  // Default value
+
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream iss(line);
+        std::string key;
+        std::getline(iss, key, '=');
+
+        if (key == "depth") {
+            iss >> depth;
+        } else if (key == "modulus") {
+            iss >> modulus;
+        } else if (key == "security") {
+            iss >> security;
+        }
+    }
+
+    return {depth, modulus, security};
+}
+
+/////////////////////////////////////////////
+//                WORKERS                  //
+/////////////////////////////////////////////
+
+struct Worker {
+    pid_t pid = -1;
+    FILE* jobs = nullptr;  // the worker's stdin
+    int output = -1;       // the worker's stdout
+    std::string pending;   // output not yet split into lines
+    std::string shard;     // shard being evaluated, empty when idle
+    Clock::time_point started;
+    size_t evaluated = 0;
+    double busySeconds = 0;
+    double peakRssMb = 0;
+};
+
+// Run `command` through the shell with its stdin and stdout piped to us
+bool startWorker(Worker& w, const std::string& command) {
+    int toWorker[2], fromWorker[2];
+    if (pipe2(toWorker, O_CLOEXEC) != 0) {
+        std::cerr << "Error: Could not create a pipe: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (pipe2(fromWorker, O_CLOEXEC) != 0) {
+        std::cerr << "Error: Could not create a pipe: " << std::strerror(errno) << std::endl;
+        close(toWorker[0]);
+        close(toWorker[1]);
+        return false;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "Error: Could not start a worker: " << std::strerror(errno) << std::endl;
+        for (int fd : {toWorker[0], toWorker[1], fromWorker[0], fromWorker[1]}) close(fd);
+        return false;
+    }
+    if (pid == 0) {
+        dup2(toWorker[0], STDIN_FILENO);
+        dup2(fromWorker[1], STDOUT_FILENO);
+        execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    close(toWorker[0]);
+    close(fromWorker[1]);
+    w.pid = pid;
+    w.jobs = fdopen(toWorker[1], "w");
+    w.output = fromWorker[0];
+    return true;
+}
+
+bool dispatch(Worker& w, const std::string& shard) {
+    if (std::fprintf(w.jobs, "%s\n", shard.c_str()) < 0 || std::fflush(w.jobs) != 0) return false;
+    w.shard = shard;
+    w.started = Clock::now();
+    return true;
+}
+
+// Close the worker's stdin, which ends its serve loop, and reap it
+void stopWorker(Worker& w) {
+    if (w.jobs) std::fclose(w.jobs);
+    if (w.output >= 0) close(w.output);
+    w.jobs = nullptr;
+    w.output = -1;
+    if (w.pid > 0) waitpid(w.pid, nullptr, 0);
+    w.pid = -1;
+}
+
+// Evaluate every shard on the workers; returns the shards that failed
+std::vector<std::string> evaluateShards(std::vector<Worker>& workers, const std::vector<std::string>& shards) {
+    std::deque<std::string> queue(shards.begin(), shards.end());
+    std::vector<std::string> failed;
+    size_t done = 0;
+    size_t alive = 0;
+    for (Worker& w : workers) {
+        if (w.pid < 0) continue;
+        alive++;
+        if (!queue.empty() && dispatch(w, queue.front())) queue.pop_front();
+    }
+
+    while (done < shards.size() && alive > 0) {
+        std::vector<pollfd> fds;
+        std::vector<Worker*> polled;
+        for (Worker& w : workers) {
+            if (w.output < 0) continue;
+            fds.push_back({w.output, POLLIN, 0});
+            polled.push_back(&w);
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Error: poll failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        for (size_t i = 0; i < fds.size(); i++) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            Worker& w = *polled[i];
+            char buffer[4096];
+            ssize_t n = read(w.output, buffer, sizeof(buffer));
+            if (n <= 0) {
+                // The worker exited; whatever it held is lost
+                if (!w.shard.empty()) {
+                    std::cerr << "Error: worker " << w.pid << " exited while evaluating " << w.shard << std::endl;
+                    failed.push_back(w.shard);
+                    done++;
+                }
+                stopWorker(w);
+                alive--;
+                continue;
+            }
+            w.pending.append(buffer, static_cast<size_t>(n));
+            size_t end;
+            while ((end = w.pending.find('\n')) != std::string::npos) {
+                std::string line = w.pending.substr(0, end);
+                w.pending.erase(0, end + 1);
+                if (line.rfind("MAIN_PEAK_RSS_MB: ", 0) == 0) {
+                    const char* value = line.c_str() + 18;
+                    char* end = nullptr;
+                    double mb = std::strtod(value, &end);
+                    if (end != value) w.peakRssMb = std::max(w.peakRssMb, mb);
+                } else if (line.rfind("MAIN_JOB_DONE: ", 0) == 0) {
+                    double seconds = std::chrono::duration<double>(Clock::now() - w.started).count();
+                    w.busySeconds += seconds;
+                    w.evaluated++;
+                    done++;
+                    bool ok = line.size() >= 3 && line.compare(line.size() - 3, 3, " ok") == 0;
+                    std::cout << "SHARD_DONE: " << w.shard << " worker=" << w.pid << " seconds=" << seconds
+                              << (ok ? "" : " FAILED") << std::endl;
+                    if (!ok) failed.push_back(w.shard);
+                    w.shard.clear();
+                    if (!queue.empty() && dispatch(w, queue.front())) queue.pop_front();
+                }
+            }
+        }
+    }
+    // Shards never handed out because every worker died
+    for (const std::string& shard : queue) failed.push_back(shard);
+    return failed;
+}
+
+/////////////////////////////////////////////
+//                 MERGE                   //
+/////////////////////////////////////////////
+
+// Combine the shards' output ciphertexts into one and record it as job
+// `name`, with the context and keys of the first shard
+bool mergeShards(AsyncIO& io, ArtifactStore& store, const std::vector<std::string>& shards, const std::string& name,
+                 bool multiply, unsigned threads) {
+    std::vector<ArtifactRefs> refs(shards.size());
+    for (size_t i = 0; i < shards.size(); i++) {
+        if (!store.readRefs("jobs", shards[i], refs[i]) || !refs[i].has("output_ciphertext")) {
+            std::cerr << "Error: shard " << shards[i] << " has no output ciphertext" << std::endl;
+            return false;
+        }
+        if (refs[i].hash("cryptocontext") != refs[0].hash("cryptocontext")) {
+            std::cerr << "Error: shard " << shards[i] << " was encrypted under another cryptocontext than "
+                      << shards[0] << std::endl;
+            return false;
+        }
+    }
+
+    // Issue every read first; deserialize one object at a time, as OpenFHE's
+    // context registry is not thread-safe
+    auto ccBytes = store.get(refs[0].hash("cryptocontext"));
+    std::shared_future<std::string> emkeyBytes;
+    if (multiply) emkeyBytes = store.get(refs[0].hash("key-eval-mult"));
+    std::vector<std::shared_future<std::string>> partBytes;
+    for (const ArtifactRefs& r : refs) partBytes.push_back(store.get(r.hash("output_ciphertext")));
+
+    CryptoContext<DCRTPoly> cc;
+    {
+        FHE_SPAN("deserialize:cryptocontext");
+        if (!deserializeAsync(ccBytes, cc)) {
+            std::cerr << "Error: Could not deserialize the cryptocontext of " << shards[0] << std::endl;
+            return false;
+        }
+    }
+    if (multiply) {
+        FHE_SPAN("deserialize:key-eval-mult");
+        try {
+            MemoryStream emkeys(emkeyBytes.get());
+            if (!cc->DeserializeEvalMultKey(emkeys, SerType::BINARY)) throw std::runtime_error("bad key file");
+        } catch (const std::exception& e) {
+            std::cerr << "Error: Could not deserialize the eval mult keys: " << e.what() << std::endl;
+            return false;
+        }
+    }
+    std::vector<Ciphertext<DCRTPoly>> parts(shards.size());
+    for (size_t i = 0; i < shards.size(); i++) {
+        FHE_SPAN("deserialize:output_ciphertext");
+        if (!deserializeAsync(partBytes[i], parts[i])) {
+            std::cerr << "Error: Could not deserialize the output of " << shards[i] << std::endl;
+            return false;
+        }
+    }
+
+    // Every level of the tree drops a tower, and the last one cannot go
+    if (multiply) {
+        size_t needed = 0;
+        while ((size_t(1) << needed) < parts.size()) needed++;
+        for (size_t i = 0; i < parts.size(); i++) {
+            size_t towers = parts[i]->GetElements().empty() ? 0 : parts[i]->GetElements()[0].GetNumOfElements();
+            size_t left = towers > 0 ? towers - 1 : 0;
+            if (left < needed) {
+                std::cerr << "Error: --merge mult needs " << needed << " levels for " << parts.size()
+                          << " shards, but the output of " << shards[i] << " has " << left
+                          << " left; encrypt the shards with that much more depth, or merge with add" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    // Pairwise tree, as fhe-main sums its lanes: log2(shards) levels deep
+    TaskGraph tree;
+    std::vector<std::vector<size_t>> partDone(parts.size());
+    for (size_t step = 1; step < parts.size(); step *= 2) {
+        for (size_t i = 0; i + step < parts.size(); i += 2 * step) {
+            std::vector<size_t> operands = partDone[i];
+            operands.insert(operands.end(), partDone[i + step].begin(), partDone[i + step].end());
+            partDone[i] = {tree.add([&, i, step] {
+                FHE_SPAN(multiply ? "EvalMult" : "EvalAdd");
+                parts[i] = multiply ? cc->EvalMult(parts[i], parts[i + step]) : cc->EvalAdd(parts[i], parts[i + step]);
+                parts[i + step] = nullptr;
+            }, operands)};
+        }
+    }
+    try {
+        TaskRuntime runtime(threads);
+        runtime.run(tree);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Merging the shards failed: " << e.what() << std::endl;
+        return false;
+    }
+
+    std::string bytes = serializeToBytes(parts[0]);
+    uint64_t size = bytes.size();
+    std::string hash = bytes.empty() ? std::string() : store.put(std::move(bytes));
+    ArtifactRefs merged = refs[0];
+    merged.refs.erase("enc_file1");
+    merged.refs.erase("enc_file2");
+    merged.set("output_ciphertext", hash, size);
+    if (hash.empty() || !io.drain() || !store.publish() || !store.writeRefs("jobs", name, merged)) {
+        std::cerr << "Error: Could not store the merged result as job " << name << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/////////////////////////////////////////////
+//                                         //
+//               |MAIN|                    //
+//                                         //
+/////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+    auto start_total = Clock::now();
+
+    std::string jobName;
+    std::vector<std::string> shards;
+    unsigned workerCount = 2;
+    std::string workerCommand = WORKERCOMMAND;
+    bool multiply = false;
+    unsigned mergeThreads = 0;
+    int workerThreads = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--job" && i + 1 < argc) {
+            jobName = argv[++i];
+        } else if (arg == "--shards" && i + 1 < argc) {
+            std::istringstream names(argv[++i]);
+            std::string name;
+            while (std::getline(names, name, ',')) {
+                if (!name.empty()) shards.push_back(name);
+            }
+        } else if (arg == "--workers" && i + 1 < argc) {
+            workerCount = static_cast<unsigned>(std::max(1, std::stoi(argv[++i])));
+        } else if (arg == "--worker-cmd" && i + 1 < argc) {
+            workerCommand = argv[++i];
+        } else if (arg == "--merge" && i + 1 < argc) {
+            std::string merge = argv[++i];
+            if (merge != "add" && merge != "mult") {
+                std::cerr << "Error: --merge must be add or mult" << std::endl;
+                return 1;
+            }
+            multiply = merge == "mult";
+        } else if (arg == "--merge-threads" && i + 1 < argc) {
+            mergeThreads = static_cast<unsigned>(std::max(1, std::stoi(argv[++i])));
+        } else if (arg == "--worker-threads" && i + 1 < argc) {
+            workerThreads = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--help") {
+            std::cout << "Usage: " << argv[0] << " --job NAME [OPTIONS]\n"
+                      << "Options:\n"
+                      << "  --job NAME          Job to evaluate; its shards are the stored jobs NAME.0, NAME.1, ...\n"
+                      << "                      and the merged result is recorded as job NAME\n"
+                      << "  --shards A,B,...    Evaluate these stored jobs as the shards instead\n"
+                      << "  --workers N         fhe-main workers to run (default: 2)\n"
+                      << "  --worker-cmd CMD    Command starting one worker (default: " << WORKERCOMMAND << ")\n"
+                      << "  --merge add|mult    Combine the shard results with EvalAdd or EvalMult (default: add)\n"
+                      << "  --merge-threads N   Workers of the merge tree (default: all cores)\n"
+                      << "  --worker-threads N  OpenMP threads of each worker, passed as --inner-threads\n"
+                      << "                      (default: the cores split between the workers of the\n"
+                      << "                      default command; a --worker-cmd keeps its own)\n"
+                      << "  --help              Display this help message\n";
+            return 0;
+        }
+    }
+    if (jobName.empty() || !ArtifactStore::validName(jobName)) {
+        std::cerr << "Error: --job NAME is required" << std::endl;
+        return 1;
+    }
+
+    prof::Session profile("sharding");
+    FHE_SPAN("sharding");
+    AsyncIO io;
+    ArtifactStore store(io, STOREFOLDER);
+    if (shards.empty()) {
+        ArtifactRefs refs;
+        while (store.readRefs("jobs", jobName + "." + std::to_string(shards.size()), refs)) {
+            shards.push_back(jobName + "." + std::to_string(shards.size()));
+        }
+    }
+    if (shards.empty()) {
+        std::cerr << "Error: no shards of job " << jobName << " in " << STOREFOLDER << std::endl;
+        return 1;
+    }
+
+    std::tuple<int, int, int> config{8, 65537, 128};
+    {
+        ArtifactRefs refs;
+        if (store.readRefs("jobs", shards[0], refs) && refs.has("config_params")) {
+            try {
+                MemoryStream in(store.get(refs.hash("config_params")).get());
+                config = parseConfigParameters(in);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+            }
+        }
+    }
+    auto [depth, modulus, security] = config;
+    profile.setParameters(depth, modulus, security);
+
+    // A worker that dies must not take the coordinator with it
+    signal(SIGPIPE, SIG_IGN);
+    workerCount = static_cast<unsigned>(std::min<size_t>(workerCount, shards.size()));
+    std::cout << "Evaluating " << shards.size() << " shards of job " << jobName << " on " << workerCount
+              << " workers" << std::endl;
+
+    // Workers on this host split its cores rather than each starting an
+    // OpenMP team of all of them
+    if (workerThreads == 0 && workerCommand == WORKERCOMMAND) {
+        workerThreads = std::max(1, availableCores() / static_cast<int>(workerCount));
+    }
+    if (workerThreads > 0) workerCommand += " --inner-threads " + std::to_string(workerThreads);
+
+    auto start_evaluate = Clock::now();
+    std::vector<Worker> workers(workerCount);
+    for (Worker& w : workers) startWorker(w, workerCommand);
+    std::vector<std::string> failed;
+    {
+        FHE_SPAN("evaluate");
+        failed = evaluateShards(workers, shards);
+    }
+    for (Worker& w : workers) stopWorker(w);
+    auto end_evaluate = Clock::now();
+
+    if (!failed.empty()) {
+        std::cerr << "Error: " << failed.size() << " of " << shards.size() << " shards failed:";
+        for (const std::string& shard : failed) std::cerr << " " << shard;
+        std::cerr << std::endl;
+        return 1;
+    }
+
+    bool merged;
+    {
+        FHE_SPAN("merge");
+        merged = mergeShards(io, store, shards, jobName, multiply,
+                             mergeThreads ? mergeThreads : static_cast<unsigned>(availableCores()));
+    }
+    if (!merged) return 1;
+    auto end_total = Clock::now();
+    std::cout << "Merged result recorded as job " << jobName << "." << std::endl;
+
+    double evaluate_time = std::chrono::duration<double>(end_evaluate - start_evaluate).count();
+    double merge_time = std::chrono::duration<double>(end_total - end_evaluate).count();
+    double total_time = std::chrono::duration<double>(end_total - start_total).count();
+    double peakRssMb = 0;
+    double busySeconds = 0;
+    for (const Worker& w : workers) {
+        peakRssMb = std::max(peakRssMb, w.peakRssMb);
+        busySeconds += w.busySeconds;
+    }
+    // Share of the evaluation the workers spent evaluating, not idle
+    double utilization = evaluate_time > 0 ? busySeconds / (evaluate_time * workers.size()) : 0;
+
+    std::cout << "=== TIMING_RESULTS ===" << std::endl;
+    std::cout << "SHARD_COUNT: " << shards.size() << std::endl;
+    std::cout << "SHARD_WORKERS: " << workers.size() << std::endl;
+    for (const Worker& w : workers) {
+        std::cout << "SHARD_WORKER: shards=" << w.evaluated << " busy_s=" << w.busySeconds
+                  << " peak_rss_mb=" << w.peakRssMb << std::endl;
+    }
+    std::cout << "SHARD_EVALUATE_TIME: " << evaluate_time << std::endl;
+    std::cout << "SHARD_MERGE_TIME: " << merge_time << std::endl;
+    std::cout << "SHARD_TOTAL_TIME: " << total_time << std::endl;
+    std::cout << "SHARD_UTILIZATION: " << utilization << std::endl;
+    std::cout << "SHARD_WORKER_PEAK_RSS_MB: " << peakRssMb << std::endl;
+
+    std::vector<std::pair<std::string, double>> columns = {{"shards", static_cast<double>(shards.size())},
+                                                           {"workers", static_cast<double>(workers.size())},
+                                                           {"evaluate_time", evaluate_time},
+                                                           {"merge_time", merge_time},
+                                                           {"total_time", total_time},
+                                                           {"utilization", utilization},
+                                                           {"worker_peak_rss_mb", peakRssMb}};
+    prof::saveTimingToCSV(RESULTSFILE, "sharding", depth, modulus, security, columns);
+
+    //main return value
+    return 0;
+}
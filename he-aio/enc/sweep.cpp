@@ -0,0 +1,543 @@
+//IN-PROCESS SWEEP OF THE ENCRYPTION, COMPUTATION AND DECRYPTION PHASES
+//
+// Runs the fhe-enc -> fhe-main -> fhe-dec pipeline for every parameter triple
+// of tests.csv inside one process, with the same OpenFHE calls and the same
+// step timings as the three binaries:
+//
+//   ./fhe-sweep [--grid tests.csv] [--warmup 1] [--min-runs 5] [--max-runs 30]
+//               [--ci 0.02] [--max-seconds 600] [--output sweep_results.csv]
+//               [--width 1] [--workers 1] [--inner-threads N]
+//
+// The computation is fhe-main's circuit, built as the same TaskGraph and run
+// on a TaskRuntime with the same --width, --workers and --inner-threads: width
+// lanes of depth EvalMults summed by a tree of EvalAdds. The eval keys are
+// deserialized before it starts, so it compares with fhe-main --no-overlap.
+//
+// After the warm-up runs, each configuration is repeated until the 95%
+// confidence interval of every phase total is within --ci of its mean (or a
+// run or time limit is hit). Median, p95, standard deviation and the
+// confidence interval of every step go to the output CSV.
+//
+// With --threads 1,2,4 (or max: powers of two up to every core) each
+// configuration is measured at each OpenMP thread count in turn, and
+// scaling_results.csv gets the speedup and parallel efficiency of every step
+// against the smallest count, plus the knee: the count after which more
+// threads improve the median by less than --min-gain. OpenFHE has to be built
+// with OpenMP (WITH_OPENMP=ON) for the thread count to matter.
+//
+// Artifacts travel between the phases as serialized bytes in memory, so disk
+// I/O is not part of the figures; OpenFHE's cached contexts and keys are
+// released between phases so each one deserializes what it needs, as the
+// separate binaries do.
+
+#include "openfhe.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// header files needed for serialization
+#include "ciphertext-ser.h"
+#include "cryptocontext-ser.h"
+#include "key/key-ser.h"
+#include "scheme/bgvrns/bgvrns-ser.h"
+
+#include "memory-stream.h"
+#include "param-grid.h"
+#include "profiling.h"
+#include "task-runtime.h"
+
+using namespace lbcrypto;
+
+const std::string GRIDFILE = "tests.csv";
+const std::string RESULTSFILE = "sweep_results.csv";
+const std::string SCALINGFILE = "scaling_results.csv";
+
+// Step timings of one pipeline run, named as in the phase timing CSVs
+enum Step {
+    EncContext, EncKeygen, EncEncrypt, EncSerialize, EncTotal,
+    MainDeserialize, MainComputation, MainSerialize, MainTotal,
+    DecDeserialize, DecDecrypt, DecTotal,
+    NumSteps
+};
+
+const char* const STEPNAMES[NumSteps] = {
+    "enc_context_time", "enc_keygen_time", "enc_encrypt_time", "enc_serialize_time", "enc_total_time",
+    "main_deserialize_time", "main_computation_time", "main_serialize_time", "main_total_time",
+    "dec_deserialize_time", "dec_decrypt_time", "dec_total_time",
+};
+
+const Step PHASETOTALS[] = {EncTotal, MainTotal, DecTotal};
+
+using Sample = std::array<double, NumSteps>;
+using Clock = std::chrono::steady_clock;
+
+double since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <typename T>
+std::string serialize(const T& obj) {
+    BufferStream out;
+    Serial::Serialize(obj, out, SerType::BINARY);
+    return out.take();
+}
+
+template <typename T>
+bool deserialize(const std::string& bytes, T& obj) {
+    MemoryStream in(bytes);
+    Serial::Deserialize(obj, in, SerType::BINARY);
+    return static_cast<bool>(in);
+}
+
+// What a fresh process starts with: no cached contexts, no eval keys
+void releaseOpenFHEState() {
+    CryptoContextImpl<DCRTPoly>::ClearEvalMultKeys();
+    CryptoContextFactory<DCRTPoly>::ReleaseAllContexts();
+}
+
+// fhe-main's circuit: lane l computes ct1 * ct2^depth in lanes[l], then a
+// pairwise tree of EvalAdds sums the lanes into lanes[0]
+void buildCircuit(TaskGraph& circuit, const CryptoContext<DCRTPoly>& cc, std::vector<Ciphertext<DCRTPoly>>& lanes,
+                  const Ciphertext<DCRTPoly>& ct2, int depth) {
+    const int width = static_cast<int>(lanes.size());
+    std::vector<std::vector<size_t>> laneDone(width);
+    for (int l = 0; l < width; l++) {
+        for (int i = 0; i < depth; i++) {
+            laneDone[l] = {circuit.add([&, l] { lanes[l] = cc->EvalMult(lanes[l], ct2); }, laneDone[l])};
+        }
+    }
+    for (int step = 1; step < width; step *= 2) {
+        for (int l = 0; l + step < width; l += 2 * step) {
+            std::vector<size_t> operands = laneDone[l];
+            operands.insert(operands.end(), laneDone[l + step].begin(), laneDone[l + step].end());
+            laneDone[l] = {circuit.add([&, l, step] { lanes[l] = cc->EvalAdd(lanes[l], lanes[l + step]); }, operands)};
+        }
+    }
+}
+
+// One enc -> main -> dec run. False if any artifact fails to round-trip or
+// the decrypted result is wrong.
+bool runPipeline(const GridParams& p, int width, TaskRuntime& runtime, Sample& s) {
+    std::string ccBytes, pkBytes, skBytes, emkBytes, ct1Bytes, ct2Bytes, outBytes;
+
+    // Encryption
+    releaseOpenFHEState();
+    {
+        auto total = Clock::now();
+        auto start = Clock::now();
+        CryptoContext<DCRTPoly> cc = generateContext(p);
+        s[EncContext] = since(start);
+
+        start = Clock::now();
+        KeyPair<DCRTPoly> keys = cc->KeyGen();
+        cc->EvalMultKeyGen(keys.secretKey);
+        s[EncKeygen] = since(start);
+
+        start = Clock::now();
+        Plaintext pt1 = cc->MakePackedPlaintext({1, 1, 1, 1});
+        Plaintext pt2 = cc->MakePackedPlaintext({1, 1, 1, 1});
+        Ciphertext<DCRTPoly> ct1 = cc->Encrypt(keys.publicKey, pt1);
+        Ciphertext<DCRTPoly> ct2 = cc->Encrypt(keys.publicKey, pt2);
+        s[EncEncrypt] = since(start);
+
+        start = Clock::now();
+        ccBytes = serialize(cc);
+        pkBytes = serialize(keys.publicKey);
+        skBytes = serialize(keys.secretKey);
+        BufferStream emk;
+        if (!cc->SerializeEvalMultKey(emk, SerType::BINARY)) return false;
+        emkBytes = emk.take();
+        ct1Bytes = serialize(ct1);
+        ct2Bytes = serialize(ct2);
+        s[EncSerialize] = since(start);
+        s[EncTotal] = since(total);
+    }
+
+    // Computation
+    releaseOpenFHEState();
+    {
+        auto total = Clock::now();
+        auto start = Clock::now();
+        CryptoContext<DCRTPoly> cc;
+        PublicKey<DCRTPoly> pk;
+        Ciphertext<DCRTPoly> ct1, ct2;
+        MemoryStream emk(emkBytes);
+        if (!deserialize(ccBytes, cc) || !deserialize(pkBytes, pk) ||
+            !cc->DeserializeEvalMultKey(emk, SerType::BINARY) ||
+            !deserialize(ct1Bytes, ct1) || !deserialize(ct2Bytes, ct2)) {
+            return false;
+        }
+        s[MainDeserialize] = since(start);
+
+        start = Clock::now();
+        std::vector<Ciphertext<DCRTPoly>> lanes(width, ct1);
+        TaskGraph circuit;
+        buildCircuit(circuit, cc, lanes, ct2, p.depth);
+        try {
+            runtime.run(circuit);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: Homomorphic evaluation failed: " << e.what() << std::endl;
+            return false;
+        }
+        s[MainComputation] = since(start);
+
+        start = Clock::now();
+        outBytes = serialize(lanes[0]);
+        s[MainSerialize] = since(start);
+        s[MainTotal] = since(total);
+    }
+
+    // Decryption
+    releaseOpenFHEState();
+    {
+        auto total = Clock::now();
+        auto start = Clock::now();
+        CryptoContext<DCRTPoly> cc;
+        PrivateKey<DCRTPoly> sk;
+        Ciphertext<DCRTPoly> ct;
+        if (!deserialize(ccBytes, cc) || !deserialize(skBytes, sk) || !deserialize(outBytes, ct)) {
+            return false;
+        }
+        s[DecDeserialize] = since(start);
+
+        start = Clock::now();
+        Plaintext result;
+        cc->Decrypt(sk, ct, &result);
+        s[DecDecrypt] = since(start);
+        s[DecTotal] = since(total);
+
+        // width lanes of 1 * 1^depth in every input slot
+        const std::vector<int64_t>& values = result->GetPackedValue();
+        if (values.empty() || values[0] != width) return false;
+    }
+    return true;
+}
+
+// Two-sided 95% Student t quantile, Cornish-Fisher expansion around the normal
+double t95(size_t df) {
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228};
+    if (df == 0) return INFINITY;
+    if (df <= 10) return table[df - 1];
+    const double z = 1.959964;
+    double n = static_cast<double>(df);
+    return z + (z * z * z + z) / (4 * n) + (5 * std::pow(z, 5) + 16 * z * z * z + 3 * z) / (96 * n * n);
+}
+
+struct Summary {
+    size_t runs = 0;
+    double mean = 0, median = 0, p95 = 0, stddev = 0, ciLow = 0, ciHigh = 0;
+
+    double relativeCI() const { return mean > 0 ? (ciHigh - mean) / mean : INFINITY; }
+};
+
+Summary summarize(std::vector<double> v) {
+    Summary s;
+    s.runs = v.size();
+    if (v.empty()) return s;
+    std::sort(v.begin(), v.end());
+    for (double x : v) s.mean += x;
+    s.mean /= v.size();
+    s.median = v.size() % 2 ? v[v.size() / 2] : (v[v.size() / 2 - 1] + v[v.size() / 2]) / 2;
+    s.p95 = v[static_cast<size_t>(std::ceil(0.95 * v.size())) - 1];
+    double ss = 0;
+    for (double x : v) ss += (x - s.mean) * (x - s.mean);
+    s.stddev = v.size() > 1 ? std::sqrt(ss / (v.size() - 1)) : 0;
+    double half = v.size() > 1 ? t95(v.size() - 1) * s.stddev / std::sqrt(static_cast<double>(v.size())) : INFINITY;
+    s.ciLow = s.mean - half;
+    s.ciHigh = s.mean + half;
+    return s;
+}
+
+std::vector<double> column(const std::vector<Sample>& samples, int step) {
+    std::vector<double> v;
+    for (const Sample& s : samples) v.push_back(s[step]);
+    return v;
+}
+
+// OpenMP threads OpenFHE uses from now on; 1 when it was built without OpenMP
+int setThreads(int n) {
+#ifdef _OPENMP
+    if (n > 0) omp_set_num_threads(n);
+    return omp_get_max_threads();
+#else
+    (void)n;
+    return 1;
+#endif
+}
+
+// "1,2,8" as given, or "max" for 1, 2, 4, ... up to every available core
+std::vector<int> parseThreadCounts(const std::string& spec) {
+    std::vector<int> counts;
+    if (spec == "max") {
+        int cores = availableCores();
+        for (int n = 1; n < cores; n *= 2) counts.push_back(n);
+        counts.push_back(cores);
+        return counts;
+    }
+    std::stringstream in(spec);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        int n = std::stoi(item);
+        if (n > 0) counts.push_back(n);
+    }
+    std::sort(counts.begin(), counts.end());
+    counts.erase(std::unique(counts.begin(), counts.end()), counts.end());
+    return counts;
+}
+
+struct StopRule {
+    int warmup = 1;
+    int minRuns = 5;
+    int maxRuns = 30;
+    double ciTarget = 0.02;
+    double maxSeconds = 600;
+};
+
+// Warm up, then run the pipeline until the phase totals converge or a limit
+// is hit. False if a run failed.
+bool measure(const GridParams& p, int width, TaskRuntime& runtime, const StopRule& rule, std::vector<Sample>& samples,
+             bool& converged) {
+    Sample s;
+    for (int i = 0; i < rule.warmup; i++) {
+        if (!runPipeline(p, width, runtime, s)) return false;
+    }
+    auto start = Clock::now();
+    converged = false;
+    while (static_cast<int>(samples.size()) < rule.maxRuns) {
+        if (!runPipeline(p, width, runtime, s)) return false;
+        samples.push_back(s);
+        if (static_cast<int>(samples.size()) < rule.minRuns) continue;
+
+        converged = true;
+        for (Step total : PHASETOTALS) {
+            if (summarize(column(samples, total)).relativeCI() > rule.ciTarget) converged = false;
+        }
+        if (converged || since(start) > rule.maxSeconds) break;
+    }
+    return true;
+}
+
+void saveSummary(const std::string& csvFile, const GridParams& p, int threads, const std::vector<Sample>& samples) {
+    bool fileExists = std::ifstream(csvFile).good();
+    std::ofstream out(csvFile, std::ios::app);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open CSV file for writing: " << csvFile << std::endl;
+        return;
+    }
+    if (!fileExists) {
+        out << "timestamp,depth,modulus,security,threads,metric,runs,mean,median,p95,stddev,ci95_low,ci95_high" << std::endl;
+    }
+    const std::string ts = prof::timestamp();
+    out << std::fixed << std::setprecision(10);
+    for (int step = 0; step < NumSteps; step++) {
+        Summary sum = summarize(column(samples, step));
+        out << ts << "," << p.depth << "," << p.modulus << "," << p.security << "," << threads << ","
+            << STEPNAMES[step] << "," << sum.runs << "," << sum.mean << "," << sum.median << "," << sum.p95 << ","
+            << sum.stddev << "," << sum.ciLow << "," << sum.ciHigh << "\n";
+    }
+}
+
+// Speedup and parallel efficiency of every step against the smallest thread
+// count, and the knee: the thread count after which doubling up (going to the
+// next count) improves the median by less than minGain.
+void saveScaling(const std::string& csvFile, const GridParams& p, const std::vector<int>& threads,
+                 const std::vector<std::vector<Sample>>& samples, double minGain) {
+    bool fileExists = std::ifstream(csvFile).good();
+    std::ofstream out(csvFile, std::ios::app);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open CSV file for writing: " << csvFile << std::endl;
+        return;
+    }
+    if (!fileExists) {
+        out << "timestamp,depth,modulus,security,metric,threads,runs,median,ci95_low,ci95_high,"
+            << "speedup,efficiency,knee_threads" << std::endl;
+    }
+    const std::string ts = prof::timestamp();
+    for (int step = 0; step < NumSteps; step++) {
+        std::vector<Summary> sums;
+        for (const auto& runs : samples) sums.push_back(summarize(column(runs, step)));
+        size_t knee = sums.size() - 1;
+        for (size_t i = 0; i + 1 < sums.size(); i++) {
+            if (sums[i + 1].median > sums[i].median * (1 - minGain)) {
+                knee = i;
+                break;
+            }
+        }
+        bool reported = std::find(std::begin(PHASETOTALS), std::end(PHASETOTALS), step) != std::end(PHASETOTALS) ||
+                        step == EncKeygen || step == MainComputation || step == DecDecrypt;
+        if (reported) {
+            std::cout << "  " << std::left << std::setw(22) << STEPNAMES[step] << std::right;
+        }
+        for (size_t i = 0; i < sums.size(); i++) {
+            double speedup = sums[i].median > 0 ? sums[0].median / sums[i].median : 0;
+            double efficiency = speedup * threads[0] / threads[i];
+            out << ts << "," << p.depth << "," << p.modulus << "," << p.security << "," << STEPNAMES[step] << ","
+                << threads[i] << "," << sums[i].runs << std::fixed << std::setprecision(10) << "," << sums[i].median
+                << "," << sums[i].ciLow << "," << sums[i].ciHigh << std::setprecision(4) << "," << speedup << ","
+                << efficiency << "," << threads[knee] << "\n";
+            out.unsetf(std::ios::floatfield);
+            if (reported) {
+                std::cout << " " << threads[i] << ":" << std::fixed << std::setprecision(2) << speedup << "x";
+                std::cout.unsetf(std::ios::floatfield);
+            }
+        }
+        if (reported) std::cout << "  knee " << threads[knee] << std::endl;
+    }
+    std::cout << std::setprecision(6);
+}
+
+/////////////////////////////////////////////
+//                                         //
+//               |MAIN|                    //
+//                                         //
+/////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+    std::string gridFile = GRIDFILE;
+    std::string outputFile = RESULTSFILE;
+    std::string scalingFile = SCALINGFILE;
+    std::string threadSpec;
+    double minGain = 0.05;
+    StopRule rule;
+    int width = 1;
+    unsigned workers = 1;
+    int innerThreads = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--grid" && i + 1 < argc) {
+            gridFile = argv[++i];
+        } else if (arg == "--warmup" && i + 1 < argc) {
+            rule.warmup = std::max(0, std::stoi(argv[++i]));
+        } else if (arg == "--min-runs" && i + 1 < argc) {
+            rule.minRuns = std::max(2, std::stoi(argv[++i]));
+        } else if (arg == "--max-runs" && i + 1 < argc) {
+            rule.maxRuns = std::stoi(argv[++i]);
+        } else if (arg == "--ci" && i + 1 < argc) {
+            rule.ciTarget = std::stod(argv[++i]);
+        } else if (arg == "--max-seconds" && i + 1 < argc) {
+            rule.maxSeconds = std::stod(argv[++i]);
+        } else if (arg == "--output" && i + 1 < argc) {
+            outputFile = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threadSpec = argv[++i];
+        } else if (arg == "--min-gain" && i + 1 < argc) {
+            minGain = std::stod(argv[++i]);
+        } else if (arg == "--scaling-output" && i + 1 < argc) {
+            scalingFile = argv[++i];
+        } else if (arg == "--width" && i + 1 < argc) {
+            width = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--workers" && i + 1 < argc) {
+            workers = static_cast<unsigned>(std::max(1, std::stoi(argv[++i])));
+        } else if (arg == "--inner-threads" && i + 1 < argc) {
+            innerThreads = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--help") {
+            std::cout << "Usage: " << argv[0] << " [OPTIONS]\n"
+                      << "Options:\n"
+                      << "  --grid FILE        Parameter grid with depth, modulus and security columns (default: tests.csv)\n"
+                      << "  --warmup N         Untimed runs per configuration (default: 1)\n"
+                      << "  --min-runs N       Timed runs before checking convergence (default: 5)\n"
+                      << "  --max-runs N       Stop after N timed runs (default: 30)\n"
+                      << "  --ci F             Stop once every phase's 95% CI is within F of its mean (default: 0.02)\n"
+                      << "  --max-seconds S    Stop timing a configuration after S seconds (default: 600)\n"
+                      << "  --output FILE      Summary CSV, appended to (default: sweep_results.csv)\n"
+                      << "  --threads LIST     Repeat every configuration at these OpenMP thread counts, e.g. 1,2,4\n"
+                      << "                     or max (1, 2, 4, ... all cores), and report the scaling\n"
+                      << "  --min-gain F       Smallest speedup from the next thread count that still helps (default: 0.05)\n"
+                      << "  --scaling-output FILE  Scaling CSV, appended to (default: scaling_results.csv)\n"
+                      << "  --width W          Evaluate W chains of multiplications and sum them, as fhe-main (default: 1)\n"
+                      << "  --workers N        Run the circuit's operations on N workers, as fhe-main (default: 1)\n"
+                      << "  --inner-threads N  OpenMP threads per worker (default: the cores split between the workers)\n"
+                      << "  --help             Display this help message\n";
+            return 0;
+        }
+    }
+    rule.maxRuns = std::max(rule.maxRuns, rule.minRuns);
+
+    std::vector<int> threadCounts;
+    if (!threadSpec.empty()) {
+#ifndef _OPENMP
+        std::cerr << "Error: --threads needs OpenFHE and fhe-sweep built with OpenMP" << std::endl;
+        return 1;
+#endif
+        threadCounts = parseThreadCounts(threadSpec);
+        if (threadCounts.empty()) {
+            std::cerr << "Error: no thread counts in --threads " << threadSpec << std::endl;
+            return 1;
+        }
+        if (workers > 1) {
+            // Each worker sets its own OpenMP thread count
+            std::cerr << "Error: --threads cannot be combined with --workers; use --inner-threads" << std::endl;
+            return 1;
+        }
+    }
+    TaskRuntime runtime(workers, innerThreads);
+
+    std::vector<GridParams> grid = loadGrid(gridFile);
+    if (grid.empty()) return 1;
+    std::cout << "Sweeping " << grid.size() << " configurations from " << gridFile;
+    if (!threadCounts.empty()) std::cout << " at " << threadCounts.size() << " thread counts";
+    std::cout << " (" << availableCores() << " cores available)" << std::endl;
+
+    auto sweepStart = Clock::now();
+    int failures = 0;
+    for (size_t c = 0; c < grid.size(); c++) {
+        const GridParams& p = grid[c];
+        std::cout << "\n[" << c + 1 << "/" << grid.size() << "] depth=" << p.depth << " modulus=" << p.modulus
+                  << " security=" << p.security << std::endl;
+
+        // Without --threads: once, at OpenFHE's default thread count
+        std::vector<int> counts = threadCounts.empty() ? std::vector<int>{0} : threadCounts;
+        std::vector<std::vector<Sample>> perCount;
+        bool ok = true;
+        for (int count : counts) {
+            int threads = setThreads(count);
+            std::vector<Sample> samples;
+            bool converged = false;
+            ok = measure(p, width, runtime, rule, samples, converged);
+            if (!ok) break;
+
+            std::cout << "  threads=" << threads << ": " << samples.size() << " runs, "
+                      << (converged ? "converged" : "not converged") << std::endl;
+            for (Step total : PHASETOTALS) {
+                Summary sum = summarize(column(samples, total));
+                std::cout << "  " << std::left << std::setw(16) << STEPNAMES[total] << std::right
+                          << " median " << std::setw(10) << sum.median << " s  p95 " << std::setw(10) << sum.p95
+                          << " s  sd " << std::setw(10) << sum.stddev << " s  ci95 +-"
+                          << std::setprecision(2) << 100 * sum.relativeCI() << std::setprecision(6) << "%" << std::endl;
+            }
+            saveSummary(outputFile, p, threads, samples);
+            perCount.push_back(std::move(samples));
+        }
+        if (!ok) {
+            std::cerr << "Error: the pipeline failed for depth=" << p.depth << " modulus=" << p.modulus
+                      << " security=" << p.security << std::endl;
+            failures++;
+            continue;
+        }
+        if (!threadCounts.empty()) {
+            std::cout << "  speedup over " << threadCounts[0] << " thread(s):" << std::endl;
+            saveScaling(scalingFile, p, threadCounts, perCount, minGain);
+        }
+    }
+
+    std::cout << "\nSweep finished in " << since(sweepStart) << " s, results appended to " << outputFile;
+    if (!threadCounts.empty()) std::cout << " and " << scalingFile;
+    std::cout << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,244 @@
+//WORK-STEALING RUNTIME FOR THE OPERATIONS OF A CIRCUIT
+//
+// A circuit is a TaskGraph: one task per homomorphic operation, run once all
+// the tasks it depends on have. TaskRuntime runs a graph on a fixed set of
+// workers (the calling thread is worker 0), each with its own deque: a worker
+// pushes the tasks its completions make ready onto its own deque and pops
+// them newest first, so a chain of operations stays on one core and in its
+// cache; an idle worker steals the oldest task of another.
+//
+// OpenFHE parallelizes inside each operation with OpenMP. Every worker sets
+// its own OpenMP thread count to innerThreads, so W workers running
+// operations side by side use W * innerThreads cores rather than W times the
+// machine. With one worker the graph runs on the calling thread in
+// dependency order, as a plain loop would, with OpenFHE's default threading.
+
+#ifndef FHE_TASK_RUNTIME_H
+#define FHE_TASK_RUNTIME_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// OpenMP threads the calling thread's parallel regions get from now on;
+// returns the previous setting (1 without OpenMP)
+inline int setInnerThreads(int n) {
+#ifdef _OPENMP
+    int previous = omp_get_max_threads();
+    if (n > 0) omp_set_num_threads(n);
+    return previous;
+#else
+    (void)n;
+    return 1;
+#endif
+}
+
+inline int availableCores() {
+#ifdef _OPENMP
+    return omp_get_num_procs();
+#else
+    return static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+#endif
+}
+
+class TaskGraph {
+public:
+    // Add a task that runs once every task in `deps` has; returns its id
+    size_t add(std::function<void()> fn, const std::vector<size_t>& deps = {}) {
+        size_t id = nodes_.size();
+        nodes_.push_back({std::move(fn), {}, static_cast<int>(deps.size())});
+        for (size_t dep : deps) nodes_[dep].successors.push_back(id);
+        return id;
+    }
+
+    size_t size() const { return nodes_.size(); }
+
+private:
+    friend class TaskRuntime;
+
+    struct Node {
+        std::function<void()> fn;
+        std::vector<size_t> successors;
+        int deps;
+    };
+    std::vector<Node> nodes_;
+};
+
+class TaskRuntime {
+public:
+    // innerThreads 0: split the cores evenly between the workers
+    explicit TaskRuntime(unsigned workers, int innerThreads = 0)
+        : workers_(std::max(1u, workers)),
+          inner_(innerThreads > 0 ? innerThreads : std::max(1, availableCores() / static_cast<int>(workers_))),
+          deques_(workers_) {
+        for (unsigned w = 1; w < workers_; w++) {
+            helpers_.emplace_back([this, w] { helperMain(w); });
+        }
+    }
+
+    ~TaskRuntime() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& t : helpers_) t.join();
+    }
+
+    TaskRuntime(const TaskRuntime&) = delete;
+    TaskRuntime& operator=(const TaskRuntime&) = delete;
+
+    unsigned workers() const { return workers_; }
+    int innerThreads() const { return inner_; }
+    uint64_t steals() const { return steals_.load(); }
+
+    // Run every task of the graph; rethrows the first exception a task threw
+    // (the tasks after it are skipped)
+    void run(TaskGraph& graph) {
+        const size_t n = graph.size();
+        if (n == 0) return;
+        graph_ = &graph;
+        pending_ = std::make_unique<std::atomic<int>[]>(n);
+        error_ = nullptr;
+        failed_ = false;
+        remaining_ = n;
+        unsigned next = 0;
+        for (size_t id = 0; id < n; id++) {
+            pending_[id] = graph.nodes_[id].deps;
+            if (graph.nodes_[id].deps == 0) push(next++ % workers_, id);
+        }
+
+        int outer = workers_ > 1 ? setInnerThreads(inner_) : 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            generation_++;
+        }
+        wake_.notify_all();
+        work(0);
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            idle_.wait(lock, [this] { return active_ == 0; });
+        }
+        if (workers_ > 1) setInnerThreads(outer);
+        graph_ = nullptr;
+        if (error_) std::rethrow_exception(error_);
+    }
+
+private:
+    struct Deque {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    void push(unsigned worker, size_t id) {
+        std::lock_guard<std::mutex> lock(deques_[worker].mutex);
+        deques_[worker].tasks.push_back(id);
+    }
+
+    bool pop(unsigned worker, size_t& id) {
+        std::lock_guard<std::mutex> lock(deques_[worker].mutex);
+        if (deques_[worker].tasks.empty()) return false;
+        id = deques_[worker].tasks.back();
+        deques_[worker].tasks.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned worker, size_t& id) {
+        for (unsigned k = 1; k < workers_; k++) {
+            Deque& victim = deques_[(worker + k) % workers_];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.tasks.empty()) continue;
+            id = victim.tasks.front();
+            victim.tasks.pop_front();
+            steals_++;
+            return true;
+        }
+        return false;
+    }
+
+    void execute(unsigned worker, size_t id) {
+        TaskGraph::Node& node = graph_->nodes_[id];
+        if (!failed_.load()) {
+            try {
+                node.fn();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_) error_ = std::current_exception();
+                failed_ = true;
+            }
+        }
+        for (size_t next : node.successors) {
+            if (pending_[next].fetch_sub(1) == 1) push(worker, next);
+        }
+        remaining_.fetch_sub(1);
+    }
+
+    // Take and run tasks until the whole graph is done
+    void work(unsigned worker) {
+        unsigned idleRounds = 0;
+        while (remaining_.load() > 0) {
+            size_t id;
+            if (pop(worker, id) || steal(worker, id)) {
+                execute(worker, id);
+                idleRounds = 0;
+            } else if (++idleRounds < 64) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+    }
+
+    void helperMain(unsigned worker) {
+        setInnerThreads(inner_);
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+                if (stopping_) return;
+                seen = generation_;
+                active_++;
+            }
+            work(worker);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (--active_ == 0) idle_.notify_all();
+            }
+        }
+    }
+
+    const unsigned workers_;
+    const int inner_;
+    std::vector<Deque> deques_;
+    std::vector<std::thread> helpers_;
+
+    TaskGraph* graph_ = nullptr;
+    std::unique_ptr<std::atomic<int>[]> pending_;
+    std::atomic<size_t> remaining_{0};
+    std::atomic<bool> failed_{false};
+    std::exception_ptr error_;
+    std::atomic<uint64_t> steals_{0};
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    uint64_t generation_ = 0;
+    unsigned active_ = 0;
+    bool stopping_ = false;
+};
+
+#endif // FHE_TASK_RUNTIME_H
@@ -8,6 +8,8 @@
 #include "key/key-ser.h"
 #include "scheme/bgvrns/bgvrns-ser.h"
 
+#include "artifact-stream.h"
+
 using namespace lbcrypto;
 
 const std::string DATAFOLDER = "data";
@@ -15,11 +17,39 @@ const std::string RESULTSFOLDER = "results";
 const std::string CRYPTOCONTEXT = "cryptocontext";
 const std::string PRIVATEKEY = "private_data";
 
-int main()
+int main(int argc, char* argv[])
 {
+    std::string listenEndpoint;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--listen" && i + 1 < argc) {
+            listenEndpoint = argv[++i];
+        } else if (arg == "--help") {
+            std::cout << "Usage: " << argv[0] << " [OPTIONS]\n"
+                      << "Options:\n"
+                      << "  --listen EP     Receive the context and result from fhe-main (unix:PATH or tcp:HOST:PORT)\n"
+                      << "  --help          Display this help message\n"
+                      << "Without --listen the artifacts are read from the shared volumes.\n";
+            return 0;
+        }
+    }
+
+    // The secret key always comes from the private volume; only the public
+    // artifacts are streamed.
+    std::unique_ptr<ArtifactReceiver> receiver;
+    if (!listenEndpoint.empty()) {
+        receiver.reset(new ArtifactReceiver(listenEndpoint));
+        if (!receiver->ok()) {
+            std::cerr << "Error: " << receiver->error() << std::endl;
+            return 1;
+        }
+        std::cout << "Waiting for the result on " << listenEndpoint << std::endl;
+    }
+
 	//getting the crypto-context
 	CryptoContext<DCRTPoly> cc;
-    if (!Serial::DeserializeFromFile(CRYPTOCONTEXT + "/cryptocontext.txt", cc, SerType::BINARY)) {
+    if (receiver ? !deserializeArtifact(receiver->get("cryptocontext"), cc)
+                 : !Serial::DeserializeFromFile(CRYPTOCONTEXT + "/cryptocontext.txt", cc, SerType::BINARY)) {
         std::cerr << "I cannot read serialization from " << DATAFOLDER + "/cryptocontext.txt" << std::endl;
         return 1;
     }
@@ -35,7 +65,8 @@ int main()
     
     //getting the encrypted result
 	Ciphertext<DCRTPoly> output_ciphertext;
-    if (Serial::DeserializeFromFile(DATAFOLDER + "/output_ciphertext.txt", output_ciphertext, SerType::BINARY) == false) {
+    if (receiver ? !deserializeArtifact(receiver->get("output_ciphertext"), output_ciphertext)
+                 : Serial::DeserializeFromFile(DATAFOLDER + "/output_ciphertext.txt", output_ciphertext, SerType::BINARY) == false) {
         std::cerr << "Could not read the ciphertext" << std::endl;
         return 1;
     }
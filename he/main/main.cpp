@@ -13,6 +13,8 @@
 #include "key/key-ser.h"
 #include "scheme/bgvrns/bgvrns-ser.h"
 
+#include "artifact-stream.h"
+
 using namespace lbcrypto;
 namespace fs = std::filesystem;
 
@@ -53,6 +55,15 @@ const std::string CRYPTOCONTEXT = "cryptocontext";
 
 
 
+// Loads an artifact from the stream when listening, otherwise from the shared volume.
+template <typename T>
+bool loadArtifact(ArtifactReceiver* receiver, const std::string& name, const std::string& path, T& obj) {
+    if (receiver) {
+        return deserializeArtifact(receiver->get(name), obj);
+    }
+    return Serial::DeserializeFromFile(path, obj, SerType::BINARY);
+}
+
 //binary decision trees
 
 /////////////////////////////////////////////
@@ -61,7 +72,7 @@ const std::string CRYPTOCONTEXT = "cryptocontext";
 //                                         //
 /////////////////////////////////////////////
 
-int main()
+int main(int argc, char* argv[])
 {
     //auto [depth, modulus, security] = loadConfigParameters();
 	
@@ -69,22 +80,90 @@ int main()
 	//int depth = calculateDepth(DATAFOLDER);
 	//int depth = atoi(argv[1]);
 	
+    std::string listenEndpoint;
+    std::string sendEndpoint;
+    bool useShm = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--listen" && i + 1 < argc) {
+            listenEndpoint = argv[++i];
+        } else if (arg == "--send" && i + 1 < argc) {
+            sendEndpoint = argv[++i];
+        } else if (arg == "--shm") {
+            useShm = true;
+        } else if (arg == "--help") {
+            std::cout << "Usage: " << argv[0] << " [OPTIONS]\n"
+                      << "Options:\n"
+                      << "  --listen EP     Receive artifacts from fhe-enc (unix:PATH or tcp:HOST:PORT)\n"
+                      << "  --send EP       Stream the result to fhe-dec\n"
+                      << "  --shm           Hand the result over in shared memory (unix: endpoints)\n"
+                      << "  --help          Display this help message\n"
+                      << "Without --listen/--send the artifacts go through the shared volumes.\n";
+            return 0;
+        }
+    }
+
+    std::unique_ptr<ArtifactReceiver> receiver;
+    if (!listenEndpoint.empty()) {
+        receiver.reset(new ArtifactReceiver(listenEndpoint));
+        if (!receiver->ok()) {
+            std::cerr << "Error: " << receiver->error() << std::endl;
+            return 1;
+        }
+        std::cout << "Waiting for artifacts on " << listenEndpoint << std::endl;
+    }
+
 	//getting the crypto-context and the the public keys
 	CryptoContext<DCRTPoly> cc;
 
-    if (!Serial::DeserializeFromFile(CRYPTOCONTEXT + "/cryptocontext.txt", cc, SerType::BINARY)) {
+    std::unique_ptr<Artifact> ccArtifact;
+    if (receiver) {
+        ccArtifact = receiver->get("cryptocontext");
+    }
+    if (receiver ? !deserializeArtifact(ccArtifact, cc)
+                 : !Serial::DeserializeFromFile(CRYPTOCONTEXT + "/cryptocontext.txt", cc, SerType::BINARY)) {
         std::cerr << "I cannot read serialization from " << CRYPTOCONTEXT + "/cryptocontext.txt" << std::endl;
         return 1;
     }
     std::cout << "The cryptocontext has been deserialized." << std::endl;
 
+    // fhe-dec gets the context forwarded right away, so it can deserialize it
+    // while the evaluation runs here.
+    std::unique_ptr<ArtifactSender> sender;
+    if (!sendEndpoint.empty()) {
+        sender.reset(new ArtifactSender(sendEndpoint, useShm));
+        if (!sender->ok()) {
+            std::cerr << "Error: " << sender->error() << std::endl;
+            return 1;
+        }
+        if (ccArtifact) {
+            sender->send("cryptocontext", std::string(ccArtifact->data(), ccArtifact->size()));
+        } else {
+            sender->send("cryptocontext", serializeToBuffer(cc));
+        }
+    }
+    ccArtifact.reset();
+
     PublicKey<DCRTPoly> pk;
-    if (Serial::DeserializeFromFile(DATAFOLDER + "/key-public.txt", pk, SerType::BINARY) == false) {
+    if (loadArtifact(receiver.get(), "key-public", DATAFOLDER + "/key-public.txt", pk) == false) {
         std::cerr << "Could not read public key" << std::endl;
         return 1;
     }
     std::cout << "The public key has been deserialized." << std::endl;
     
+    if (receiver) {
+        std::unique_ptr<Artifact> emkeyArtifact = receiver->get("key-eval-mult");
+        if (!emkeyArtifact) {
+            std::cerr << "I cannot read serialization from the stream: " << receiver->error() << std::endl;
+            return 1;
+        }
+        MemoryStream emkeys(emkeyArtifact->data(), emkeyArtifact->size());
+        if (cc->DeserializeEvalMultKey(emkeys, SerType::BINARY) == false) {
+            std::cerr << "Could not deserialize the eval mult key file" << std::endl;
+            return 1;
+        }
+    }
+    else {
     std::ifstream emkeys(DATAFOLDER + "/key-eval-mult.txt", std::ios::in | std::ios::binary);
     if (!emkeys.is_open()) {
         std::cerr << "I cannot read serialization from " << DATAFOLDER + "/key-eval-mult.txt" << std::endl;
@@ -94,24 +173,32 @@ int main()
         std::cerr << "Could not deserialize the eval mult key file" << std::endl;
         return 1;
     }
+    }
     std::cout << "Deserialized the eval mult keys." << std::endl;
     
 	Ciphertext<DCRTPoly> ciphertext1;
 
-	if (Serial::DeserializeFromFile(DATAFOLDER + "/" + "enc_file1.txt", ciphertext1, SerType::BINARY) == false) {
+	if (loadArtifact(receiver.get(), "enc_file1", DATAFOLDER + "/" + "enc_file1.txt", ciphertext1) == false) {
         std::cerr << "Could not read the ciphertext" << std::endl;
     }
     std::cout << "a ciphertext has been deserialized." << std::endl;
 
 	Ciphertext<DCRTPoly> ciphertext2;
-	if (Serial::DeserializeFromFile(DATAFOLDER + "/" + "enc_file2.txt", ciphertext2, SerType::BINARY) == false) {
+	if (loadArtifact(receiver.get(), "enc_file2", DATAFOLDER + "/" + "enc_file2.txt", ciphertext2) == false) {
 		std::cerr << "Could not read the ciphertext" << std::endl;
 	}
 
 	auto ciphertextMultResult = cc->EvalMult(ciphertext1, ciphertext2);
 
 	//serializing the final result
-	if (!Serial::SerializeToFile(RESULTSFOLDER + "/" + "output_ciphertext.txt", ciphertextMultResult, SerType::BINARY)) {
+    if (sender) {
+        sender->send("output_ciphertext", serializeToBuffer(ciphertextMultResult));
+        if (!sender->finish()) {
+            std::cerr << "Error streaming output ciphertext: " << sender->error() << std::endl;
+            return 1;
+        }
+    }
+	else if (!Serial::SerializeToFile(RESULTSFOLDER + "/" + "output_ciphertext.txt", ciphertextMultResult, SerType::BINARY)) {
         std::cerr << "Error writing serialization of output ciphertext to output_ciphertext.txt" << std::endl;
         return 1;
     }
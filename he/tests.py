@@ -14,6 +14,13 @@ logger.configure(handlers=[
     {"sink": "test_results.txt", "format": "{time:YYYY-MM-DD HH:mm:ss.SSS} | {message}", "rotation": "10 MB", "mode": "a"}
 ])
 
+# How artifacts travel between the containers:
+#   volume - written to and re-read from the named volumes (default)
+#   unix   - streamed over Unix sockets placed on the volumes each pair shares
+#   shm    - like unix, but payloads are handed over as shared memory
+#   tcp    - streamed over TCP on soteria_network
+TRANSPORT = os.environ.get("FHE_TRANSPORT", "volume")
+
 
 def run_command(command, verbose=True):
     """Run a shell command and return output"""
@@ -136,6 +143,54 @@ def run_decryption():
     print(f"Decryption completed in {execution_time:.10f} seconds")
     return execution_time, result
 
+def stream_endpoints():
+    """Endpoints (enc send, main listen, main send, dec listen) for the chosen transport"""
+    if TRANSPORT == "tcp":
+        return ("tcp:fhe-main:7001", "tcp:*:7001", "tcp:fhe-dec:7002", "tcp:*:7002")
+    # fhe-enc and fhe-main share /bdt/build/data, fhe-main's results volume is fhe-dec's data
+    return ("unix:/bdt/build/data/main.sock", "unix:/bdt/build/data/main.sock",
+            "unix:/bdt/build/results/dec.sock", "unix:/bdt/build/data/dec.sock")
+
+def run_streamed_pipeline(security, depth, modulus):
+    """Run enc, main and dec concurrently with artifacts streamed between them.
+
+    The phases overlap, so each one is charged with the time it adds to the
+    pipeline: enc until it finishes, main from then until it finishes, and dec
+    for the remainder. The three still sum to the end-to-end time.
+    """
+    print(f"\nRunning streamed FHE pipeline ({TRANSPORT})...")
+    print("=============================")
+    enc_send, main_listen, main_send, dec_listen = stream_endpoints()
+    shm = " --shm" if TRANSPORT == "shm" else ""
+
+    dec = subprocess.Popen(f"docker exec fhe-dec ./fhe-dec --listen {dec_listen}",
+                           shell=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
+    main = subprocess.Popen(f"docker exec fhe-main ./fhe-main --listen {main_listen} --send {main_send}{shm}",
+                            shell=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
+
+    start_time = time.time()
+    try:
+        run_command(f"docker exec fhe-enc ./fhe-enc --security {security} --depth {depth} "
+                    f"--modulus {modulus} --send {enc_send}{shm}")
+    except Exception:
+        main.kill()
+        dec.kill()
+        raise
+    enc_end = time.time()
+    main_out, main_err = main.communicate()
+    main_end = time.time()
+    dec_out, dec_err = dec.communicate()
+    dec_end = time.time()
+
+    print(main_out)
+    if main.returncode != 0:
+        raise Exception(f"fhe-main failed with return code {main.returncode}: {main_err}")
+    if dec.returncode != 0:
+        raise Exception(f"fhe-dec failed with return code {dec.returncode}: {dec_err}")
+
+    print(f"Streamed pipeline completed in {dec_end - start_time:.10f} seconds")
+    return enc_end - start_time, main_end - enc_end, dec_end - main_end, dec_out
+
 def run_tests():
     """Run all tests from the CSV file"""
     # Check if tests.csv exists
@@ -192,26 +247,35 @@ def run_tests():
                     # Clean test environment
                     clean_test_environment()
                     
-                    # Run encryption
-                    enc_time = run_encryption(test['security'], test['depth'], test['modulus'])
-                    enc_times.append(enc_time)
+                    if TRANSPORT != "volume":
+                        # Nothing lands on the data volume, so no file sizes in this mode
+                        enc_time, main_time, dec_time, dec_results = run_streamed_pipeline(
+                            test['security'], test['depth'], test['modulus'])
+                        enc_times.append(enc_time)
+                        main_times.append(main_time)
+                        dec_times.append(dec_time)
+                        all_results.append(dec_results.strip())
+                    else:
+                        # Run encryption
+                        enc_time = run_encryption(test['security'], test['depth'], test['modulus'])
+                        enc_times.append(enc_time)
                     
-                    # Get file sizes after encryption (only for the first run - sizes should be the same across runs)
-                    if run == 0:
-                        file_sizes = get_file_sizes()
-                        test['public_size'] = file_sizes['public_size']
-                        test['eval_size'] = file_sizes['eval_size']
-                        test['enc1_size'] = file_sizes['enc1_size']
-                        test['enc2_size'] = file_sizes['enc2_size']
+                        # Get file sizes after encryption (only for the first run - sizes should be the same across runs)
+                        if run == 0:
+                            file_sizes = get_file_sizes()
+                            test['public_size'] = file_sizes['public_size']
+                            test['eval_size'] = file_sizes['eval_size']
+                            test['enc1_size'] = file_sizes['enc1_size']
+                            test['enc2_size'] = file_sizes['enc2_size']
                         
-                    # Run main computation
-                    main_time = run_main_computation()
-                    main_times.append(main_time)
+                        # Run main computation
+                        main_time = run_main_computation()
+                        main_times.append(main_time)
                     
-                    # Run decryption
-                    dec_time, dec_results = run_decryption()
-                    dec_times.append(dec_time)
-                    all_results.append(dec_results.strip())
+                        # Run decryption
+                        dec_time, dec_results = run_decryption()
+                        dec_times.append(dec_time)
+                        all_results.append(dec_results.strip())
                     
                     # Log individual run results
                     logger.info(f"Run #{run+1} - Encryption: {enc_time:.10f}s, Main: {main_time:.10f}s, Decryption: {dec_time:.10f}s")
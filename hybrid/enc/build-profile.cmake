@@ -0,0 +1,35 @@
+#BUILD PROFILE OF THE FHE-* BINARIES
+#
+#   cmake -DFHE_BUILD_PROFILE=release ..
+#
+#   debug     -O0 -g, as the images were built before there were profiles
+#   release   -O3 -march=native with link-time optimization (default)
+#   pgo-gen   release, instrumented to write profiles to FHE_PGO_DIR
+#   pgo-use   release, optimized with the profiles in FHE_PGO_DIR
+#
+# CMakeLists.User.txt sets CMAKE_CXX_FLAGS to OpenFHE's own flags, -fopenmp
+# included when OpenFHE was built with OpenMP; the profile adds to them.
+# build-profile.sh rebuilds OpenFHE with the same profile and trains pgo.
+# -march=native ties the binaries to the CPU they were built on.
+
+set(FHE_BUILD_PROFILE "release" CACHE STRING "debug, release, pgo-gen or pgo-use")
+set(FHE_PGO_DIR "/bdt/pgo" CACHE PATH "Profiles written by pgo-gen and read by pgo-use")
+
+set(FHE_OPT_FLAGS "-O3 -march=native -flto=auto")
+if(FHE_BUILD_PROFILE STREQUAL "debug")
+  set(FHE_PROFILE_FLAGS "-O0 -g")
+elseif(FHE_BUILD_PROFILE STREQUAL "release")
+  set(FHE_PROFILE_FLAGS "${FHE_OPT_FLAGS}")
+elseif(FHE_BUILD_PROFILE STREQUAL "pgo-gen")
+  # Atomic counters: OpenMP threads update them concurrently
+  set(FHE_PROFILE_FLAGS "${FHE_OPT_FLAGS} -fprofile-generate -fprofile-update=atomic -fprofile-dir=${FHE_PGO_DIR}")
+elseif(FHE_BUILD_PROFILE STREQUAL "pgo-use")
+  # Code the training never ran keeps its release optimization
+  set(FHE_PROFILE_FLAGS "${FHE_OPT_FLAGS} -fprofile-use -fprofile-partial-training -fprofile-dir=${FHE_PGO_DIR} -Wno-missing-profile")
+else()
+  message(FATAL_ERROR "FHE_BUILD_PROFILE must be debug, release, pgo-gen or pgo-use, not ${FHE_BUILD_PROFILE}")
+endif()
+
+set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${FHE_PROFILE_FLAGS}")
+set(CMAKE_EXE_LINKER_FLAGS "${CMAKE_EXE_LINKER_FLAGS} ${FHE_PROFILE_FLAGS}")
+message(STATUS "FHE build profile: ${FHE_BUILD_PROFILE} (${FHE_PROFILE_FLAGS})")
@@ -0,0 +1,133 @@
+#!/bin/sh
+#REBUILD OPENFHE AND THE FHE-* BINARIES WITH ONE BUILD PROFILE
+#
+#   cd /bdt/build && ../build-profile.sh debug|release|pgo [GRID]
+#
+# debug and release reconfigure the OpenFHE build tree the base image was
+# built from (every other option, CUDA included, stays as it was; release and
+# pgo also turn OpenMP on, which the base images may have built without),
+# install it over /usr/local and rebuild the binaries with the matching
+# FHE_BUILD_PROFILE of build-profile.cmake: debug is the Debug build the
+# images used to ship, release is -O3 -march=native with LTO.
+#
+# pgo builds both instrumented, trains them with one fhe-enc, fhe-main and
+# fhe-dec run per row of GRID (default tests.csv), then rebuilds both with the
+# profiles gathered in /bdt/pgo. Where the SGX manifests are built here they
+# are signed again, as they hash the binaries and libraries.
+
+set -e
+
+PROFILE=${1:-release}
+GRID=${2:-tests.csv}
+OPENFHE_BUILD=${OPENFHE_BUILD:-/usr/src/app/openfhe-uniman/cmake-build-debug-cuda}
+PGO_DIR=/bdt/pgo
+JOBS=$(nproc)
+
+# OpenFHE's Release flags are -O3; WITH_NATIVEOPT adds -march=native. The
+# fhe-* binaries split their cores between OpenMP teams, which a serial
+# OpenFHE would ignore, so the tuned builds set WITH_OPENMP explicitly
+build_openfhe() {
+    case "$1" in
+        debug) type=Debug native=OFF openmp= flags="" ;;
+        release) type=Release native=ON openmp=ON flags="-flto=auto" ;;
+        pgo-gen) type=Release native=ON openmp=ON
+                 flags="-flto=auto -fprofile-generate -fprofile-update=atomic -fprofile-dir=$PGO_DIR" ;;
+        pgo-use) type=Release native=ON openmp=ON
+                 flags="-flto=auto -fprofile-use -fprofile-partial-training -fprofile-dir=$PGO_DIR -Wno-missing-profile" ;;
+    esac
+    cmake -DCMAKE_BUILD_TYPE=$type -DWITH_NATIVEOPT=$native ${openmp:+-DWITH_OPENMP=$openmp} \
+          -DCMAKE_CXX_FLAGS="$flags" -DCMAKE_SHARED_LINKER_FLAGS="$flags" \
+          -B "$OPENFHE_BUILD"
+    cmake --build "$OPENFHE_BUILD" -- -j "$JOBS"
+    cmake --install "$OPENFHE_BUILD"
+}
+
+build_binaries() {
+    cmake -DFHE_BUILD_PROFILE="$1" ..
+    make -j "$JOBS"
+    if [ -f enc_Makefile ]; then
+        make -f enc_Makefile clean && make -f enc_Makefile SGX=1
+        make -f dec_Makefile clean && make -f dec_Makefile SGX=1
+        make -f keyd_Makefile clean && make -f keyd_Makefile SGX=1
+    fi
+}
+
+# depth modulus security of each distinct row of a tests.csv. The variants
+# order its columns differently, so they are found by name; the BOM and CRs
+# are dropped and of several moduli in a cell the first is kept, as
+# param-grid.h reads the grid.
+grid_rows() {
+    awk '
+        function split_csv(line, cells,    n, i, c, q) {
+            n = 1; cells[1] = ""; q = 0
+            for (i = 1; i <= length(line); i++) {
+                c = substr(line, i, 1)
+                if (c == "\"") q = !q
+                else if (c == "," && !q) cells[++n] = ""
+                else if (c != "\r") cells[n] = cells[n] c
+            }
+            return n
+        }
+        NR == 1 {
+            sub(/^\357\273\277/, "")
+            n = split_csv($0, header)
+            for (i = 1; i <= n; i++) col[header[i]] = i
+            if (!("depth" in col) || !("modulus" in col) || !("security" in col)) {
+                print "Error: " FILENAME " needs depth, modulus and security columns" > "/dev/stderr"
+                exit 1
+            }
+            next
+        }
+        {
+            delete row
+            split_csv($0, row)
+            d = row[col["depth"]] + 0; m = row[col["modulus"]] + 0; s = row[col["security"]] + 0
+            if (d > 0 && m > 0 && s > 0 && !seen[d " " m " " s]++) print d, m, s
+        }' "$1"
+}
+
+# One encrypt / evaluate / decrypt run per depth,modulus,security row, in a
+# scratch directory so the training leaves no timing results behind
+train() {
+    rows=$(grid_rows "$GRID")
+    bin=$(pwd)
+    run="$PGO_DIR/run"
+    mkdir -p "$run"
+    (
+        cd "$run"
+        mkdir -p results data private_data timing cryptocontext dec_results store metrics
+        echo "$rows" | while read -r depth modulus security; do
+            echo "Training on depth=$depth modulus=$modulus security=$security"
+            "$bin/fhe-enc" --security "$security" --depth "$depth" --modulus "$modulus" > /dev/null
+            "$bin/fhe-main" > /dev/null
+            "$bin/fhe-dec" > /dev/null
+        done
+    )
+    rm -rf "$run"
+}
+
+case "$PROFILE" in
+    debug|release)
+        build_openfhe "$PROFILE"
+        build_binaries "$PROFILE"
+        ;;
+    pgo)
+        if [ ! -f "$GRID" ]; then
+            echo "Error: training grid $GRID not found" >&2
+            exit 1
+        fi
+        rm -rf "$PGO_DIR"
+        mkdir -p "$PGO_DIR"
+        build_openfhe pgo-gen
+        build_binaries pgo-gen
+        train
+        build_openfhe pgo-use
+        build_binaries pgo-use
+        ;;
+    *)
+        echo "Usage: $0 debug|release|pgo [GRID]" >&2
+        exit 1
+        ;;
+esac
+
+echo "Built OpenFHE and the binaries with the $PROFILE profile"
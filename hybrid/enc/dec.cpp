@@ -4,9 +4,12 @@
 
 #include <iostream>
 #include <fstream>
+#include <filesystem>
 #include <chrono>
 #include <iomanip>
 #include <ctime>
+#include <map>
+#include <mutex>
 #include <sstream>
 
 // header files needed for serialization
@@ -14,6 +17,16 @@
 #include "cryptocontext-ser.h"
 #include "key/key-ser.h"
 #include "scheme/bgvrns/bgvrns-ser.h"
+#include "scheme/ckksrns/ckksrns-ser.h"
+
+#include "async-io.h"
+#include "result-output.h"
+#include "artifact-store.h"
+#include "profiling.h"
+#include "memory-stats.h"
+#include "metrics.h"
+#include "task-runtime.h"
+#include "scheme-config.h"
 
 using namespace lbcrypto;
 
@@ -21,20 +34,15 @@ const std::string DATAFOLDER = "results";
 const std::string RESULTSFOLDER = "dec_results";
 const std::string CRYPTOCONTEXT = "cryptocontext";
 const std::string PRIVATEKEY = "private_data";
+const std::string STOREFOLDER = "store";
 
-std::tuple<int, int, int> loadConfigParameters(const std::string& configFile = "data/config_params.txt") {
-    std::ifstream inFile(configFile);
-    if (!inFile.is_open()) {
-        std::cerr << "Error: Could not open configuration file for reading: " << configFile << std::endl;
-        return {8, 65537, 128}; // Return default values
-    }
-    
+std::tuple<int, int, int> parseConfigParameters(std::istream& in, scheme::Config* schemeConfig = nullptr) {
     int depth = 8;      // Default value
     int modulus = 65537; // Default value
     int security = 128;  // Default value
     
     std::string line;
-    while (std::getline(inFile, line)) {
+    while (std::getline(in, line)) {
         std::istringstream iss(line);
         std::string key;
         std::getline(iss, key, '=');
@@ -45,133 +53,481 @@ std::tuple<int, int, int> loadConfigParameters(const std::string& configFile = "
             iss >> modulus;
         } else if (key == "security") {
             iss >> security;
+        } else if (schemeConfig) {
+            std::string value;
+            std::getline(iss, value);
+            schemeConfig->set(key, value);
         }
     }
     
-    inFile.close();
     return {depth, modulus, security};
 }
 
-void saveTimingToCSV(const std::string& phase, 
-                     int depth, int modulus, int security,
-                     double deserialize_time, double decrypt_time, 
-                     double save_time, double total_time,
-                     const std::string& csvFile = "dec_timing_results.csv") {
-    
-    // Check if file exists to determine if we need to write headers
-    bool fileExists = false;
-    std::ifstream checkFile(csvFile);
-    if (checkFile.good()) {
-        fileExists = true;
-    }
-    checkFile.close();
-    
-    // Open file in append mode
-    std::ofstream outFile(csvFile, std::ios::app);
-    if (!outFile.is_open()) {
-        std::cerr << "Error: Could not open CSV file for writing: " << csvFile << std::endl;
-        return;
-    }
-    
-    // Write headers if file is new
-    if (!fileExists) {
-        outFile << "timestamp,phase,depth,modulus,security,deserialize_time,"
-                << "decrypt_time,save_time,total_time" << std::endl;
-    }
-    
-    // Get current timestamp
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto tm = *std::localtime(&time_t);
-    
-    // Write data row
-    outFile << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << ","
-            << phase << ","
-            << depth << ","
-            << modulus << ","
-            << security << ","
-            << std::fixed << std::setprecision(10) << deserialize_time << ","
-            << decrypt_time << ","
-            << save_time << ","
-            << total_time << std::endl;
-    
-    outFile.close();
-    std::cout << "Timing results saved to " << csvFile << std::endl;
+std::tuple<int, int, int> loadConfigParameters(const std::string& configFile = "data/config_params.txt",
+                                               scheme::Config* schemeConfig = nullptr) {
+    std::ifstream inFile(configFile);
+    if (!inFile.is_open()) {
+        std::cerr << "Error: Could not open configuration file for reading: " << configFile << std::endl;
+        return {8, 65537, 128}; // Return default values
+    }
+    
+    auto config = parseConfigParameters(inFile, schemeConfig);
+    inFile.close();
+    return config;
+}
+
+// Width of the circuit fhe-main evaluated, from its circuit_params
+int parseCircuitWidth(const std::string& text) {
+    std::istringstream in(text);
+    std::string line;
+    int width = 1;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 6, "width=") == 0) width = std::max(1, std::atoi(line.c_str() + 6));
+    }
+    return width;
 }
 
-int main()
+/////////////////////////////////////////////
+//                 BATCH                   //
+/////////////////////////////////////////////
+
+// Ciphertexts named by --batch: every regular file of a directory in name
+// order, or the paths listed one per line in a manifest ('#' starts a comment)
+std::vector<std::string> listBatch(const std::string& spec) {
+    std::vector<std::string> paths;
+    std::error_code ec;
+    if (std::filesystem::is_directory(spec, ec)) {
+        for (const auto& entry : std::filesystem::directory_iterator(spec, ec)) {
+            if (entry.is_regular_file()) paths.push_back(entry.path().string());
+        }
+        std::sort(paths.begin(), paths.end());
+        return paths;
+    }
+    std::ifstream in(spec);
+    if (!in.is_open()) {
+        std::cerr << "Error: Could not open batch manifest: " << spec << std::endl;
+        return paths;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos || line[begin] == '#') continue;
+        size_t end = line.find_last_not_of(" \t\r");
+        paths.push_back(line.substr(begin, end - begin + 1));
+    }
+    return paths;
+}
+
+struct BatchItem {
+    std::string input;
+    std::string output;
+    std::shared_future<std::string> bytes;
+    Ciphertext<DCRTPoly> ciphertext;
+    bool ok = false;
+};
+
+// Decrypt every ciphertext of the batch with one context and secret key.
+// Deserializations run one after the other (OpenFHE's context registry is not
+// thread-safe), each reading a few files ahead; the decryptions run on the
+// other workers meanwhile and every result is written as soon as it is
+// decoded. A deserialization waits for the decryption read-ahead items back,
+// so no more ciphertexts than that are held at once, however long the batch.
+// Returns the number of ciphertexts that failed.
+size_t decryptBatch(const CryptoContext<DCRTPoly>& cc, const PrivateKey<DCRTPoly>& sk, AsyncIO& io,
+                    std::vector<BatchItem>& items, TaskRuntime& runtime, result::Format format,
+                    const result::SlotRange& slots, const scheme::Config& schemeConfig, size_t& resultBytes) {
+    const size_t readAhead = 2 * runtime.workers();
+    for (size_t i = 0; i < items.size() && i < readAhead; i++) items[i].bytes = io.read(items[i].input);
+
+    std::mutex outputMutex;
+    size_t failed = 0;
+    resultBytes = 0;
+    TaskGraph batch;
+    std::vector<size_t> previous;
+    std::vector<size_t> decrypted;
+    for (size_t i = 0; i < items.size(); i++) {
+        if (i >= readAhead) previous.push_back(decrypted[i - readAhead]);
+        size_t load = batch.add([&, i] {
+            if (i + readAhead < items.size()) items[i + readAhead].bytes = io.read(items[i + readAhead].input);
+            FHE_SPAN("deserialize:ciphertext");
+            items[i].ok = deserializeAsync(items[i].bytes, items[i].ciphertext);
+            items[i].bytes = {};
+        }, previous);
+        decrypted.push_back(batch.add([&, i] {
+            BatchItem& item = items[i];
+            std::string bytes;
+            size_t count = 0;
+            if (item.ok) {
+                Plaintext plaintext;
+                {
+                    FHE_SPAN("Decrypt");
+                    cc->Decrypt(sk, item.ciphertext, &plaintext);
+                }
+                item.ciphertext = nullptr;
+                FHE_SPAN("format:result");
+                if (schemeConfig.ckks()) {
+                    plaintext->SetLength(schemeConfig.slotCount(cc));
+                    std::vector<double> values = plaintext->GetRealPackedValue();
+                    count = slots.count(values.size());
+                    bytes = result::format(values, slots, format);
+                } else {
+                    const std::vector<int64_t>& values = plaintext->GetPackedValue();
+                    count = slots.count(values.size());
+                    bytes = result::format(values, slots, format);
+                }
+            }
+            // One result at a time on the console and into the I/O queue
+            std::lock_guard<std::mutex> lock(outputMutex);
+            size_t size = bytes.size();
+            if (!item.ok || !io.write(item.output, std::move(bytes))) {
+                std::cerr << "Error: Could not decrypt " << item.input << " into " << item.output << std::endl;
+                failed++;
+                return;
+            }
+            resultBytes += size;
+            std::cout << "DEC_RESULT: " << item.input << " -> " << item.output << " slots=" << count << std::endl;
+        }, {load}));
+        previous = {load};
+    }
+    runtime.run(batch);
+    return failed;
+}
+
+/////////////////////////////////////////////
+//                                         //
+//               |MAIN|                    //
+//                                         //
+/////////////////////////////////////////////
+
+int main(int argc, char* argv[])
 {
     auto start_total = std::chrono::high_resolution_clock::now();
+
+    result::Format format = result::Format::Text;
+    result::SlotRange slots;
+    size_t printLimit = 16;
+    std::string filepath;
+    bool useStore = false;
+    std::string jobName = "default";
+    // --batch decrypts a directory or manifest of ciphertexts in one run,
+    // with --workers decryptions in flight (default: every core)
+    std::string batchSpec;
+    unsigned workers = static_cast<unsigned>(availableCores());
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--format" && i + 1 < argc) {
+            if (!result::parseFormat(argv[++i], format)) {
+                std::cerr << "Error: --format must be text, csv or binary" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--slots" && i + 1 < argc) {
+            if (!result::SlotRange::parse(argv[++i], slots)) {
+                std::cerr << "Error: --slots expects BEGIN:END[:STEP]" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--print" && i + 1 < argc) {
+            printLimit = std::stoul(argv[++i]);
+        } else if (arg == "--output" && i + 1 < argc) {
+            filepath = argv[++i];
+        } else if (arg == "--store") {
+            useStore = true;
+        } else if (arg == "--job" && i + 1 < argc) {
+            jobName = argv[++i];
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batchSpec = argv[++i];
+        } else if (arg == "--workers" && i + 1 < argc) {
+            workers = static_cast<unsigned>(std::max(1, std::stoi(argv[++i])));
+        } else if (arg == "--help") {
+            std::cout << "Usage: " << argv[0] << " [OPTIONS]\n"
+                      << "Options:\n"
+                      << "  --format F       Result format: text, csv or binary (default: text)\n"
+                      << "  --slots B:E[:S]  Only output slots B..E-1, every S-th (default: all)\n"
+                      << "  --print N        Print at most N slots to the console, 0 to disable (default: 16)\n"
+                      << "  --output PATH    Result file (default: dec_results/result.<txt|csv|bin>)\n"
+                      << "  --store          Decrypt a job from the content-addressed store\n"
+                      << "  --job NAME       Stored job to decrypt (default: default)\n"
+                      << "  --batch PATH     Decrypt every ciphertext of a directory, or listed in a manifest;\n"
+                      << "                   --output is then the results directory (default: dec_results)\n"
+                      << "  --workers N      Parallel decryptions in batch mode (default: all cores)\n"
+                      << "  --help           Display this help message\n";
+            return 0;
+        }
+    }
+    std::vector<BatchItem> batch;
+    if (!batchSpec.empty()) {
+        if (useStore) {
+            std::cerr << "Error: --batch decrypts ciphertext files and cannot be combined with --store" << std::endl;
+            return 1;
+        }
+        std::string outputDir = filepath.empty() ? RESULTSFOLDER : filepath;
+        std::error_code ec;
+        std::filesystem::create_directories(outputDir, ec);
+        // Results are named after their ciphertexts, so two inputs with the
+        // same stem would overwrite each other's result
+        std::map<std::string, std::string> outputs;
+        for (const std::string& input : listBatch(batchSpec)) {
+            BatchItem item;
+            item.input = input;
+            item.output = outputDir + "/" + std::filesystem::path(input).stem().string() + result::extension(format);
+            auto [it, added] = outputs.emplace(item.output, input);
+            if (!added) {
+                std::cerr << "Error: " << it->second << " and " << input << " would both be decrypted into "
+                          << item.output << std::endl;
+                return 1;
+            }
+            batch.push_back(std::move(item));
+        }
+        if (batch.empty()) {
+            std::cerr << "Error: no ciphertexts to decrypt in " << batchSpec << std::endl;
+            return 1;
+        }
+    }
+    if (filepath.empty()) {
+        filepath = RESULTSFOLDER + "/result" + result::extension(format);
+    }
     
-    // Load configuration parameters
-    auto [depth, modulus, security] = loadConfigParameters();
-    
+    prof::Session profile("decryption");
+    FHE_SPAN("decryption");
+    mem::Phase memory({"deserialize", "decrypt", "save"});
+
+    metrics::Exporter exporter("decryption");
+    AsyncIO io;
+    metrics::RunMetrics<AsyncIO> live("decryption", io, mem::liveBytes);
+    std::unique_ptr<ArtifactStore> store;
+    ArtifactRefs refs;
+    std::tuple<int, int, int> config;
+    scheme::Config schemeConfig;
+    if (useStore) {
+        store = std::make_unique<ArtifactStore>(io, STOREFOLDER);
+        if (!store->readRefs("jobs", jobName, refs) || !refs.has("output_ciphertext")) {
+            std::cerr << "Error: job " << jobName << " has no output ciphertext in " << STOREFOLDER << std::endl;
+            return 1;
+        }
+    } else {
+        config = loadConfigParameters("data/config_params.txt", &schemeConfig);
+    }
+
     // Time deserialization
+    memory.begin("deserialize");
     auto start_deserialize = std::chrono::high_resolution_clock::now();
     
+    // Issue all reads up front so they overlap with context deserialization.
+    // The secret key never leaves the private volume.
+    std::shared_future<std::string> ccBytes, skBytes, ctBytes;
+    if (store) {
+        auto configBytes = store->get(refs.hash("config_params"));
+        ccBytes = store->get(refs.hash("cryptocontext"));
+        skBytes = io.read(privateKeyPath(PRIVATEKEY, refs.hash("key-public")));
+        ctBytes = store->get(refs.hash("output_ciphertext"));
+        try {
+            MemoryStream in(configBytes.get());
+            config = parseConfigParameters(in, &schemeConfig);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    } else {
+        ccBytes = io.read(CRYPTOCONTEXT + "/cryptocontext.txt");
+        skBytes = io.read(PRIVATEKEY + "/key-private.txt");
+        if (batch.empty()) ctBytes = io.read(DATAFOLDER + "/output_ciphertext.txt");
+    }
+    auto [depth, modulus, security] = config;
+    profile.setParameters(depth, modulus, security);
+
+    // A CKKS result is checked against the exact one, which depends on the
+    // width of the circuit fhe-main evaluated
+    std::shared_future<std::string> circuitBytes;
+    if (schemeConfig.ckks() && batch.empty()) {
+        if (!store) {
+            circuitBytes = io.read(DATAFOLDER + "/circuit_params.txt");
+        } else if (refs.has("circuit_params")) {
+            circuitBytes = store->get(refs.hash("circuit_params"));
+        }
+    }
+
     //getting the crypto-context
     CryptoContext<DCRTPoly> cc;
-    if (!Serial::DeserializeFromFile(CRYPTOCONTEXT + "/cryptocontext.txt", cc, SerType::BINARY)) {
-        std::cerr << "I cannot read serialization from " << CRYPTOCONTEXT + "/cryptocontext.txt" << std::endl;
-        return 1;
+    {
+        FHE_SPAN("deserialize:cryptocontext");
+        if (!deserializeAsync(ccBytes, cc)) {
+            std::cerr << "I cannot read serialization from " << CRYPTOCONTEXT + "/cryptocontext.txt" << std::endl;
+            return 1;
+        }
     }
     std::cout << "The cryptocontext has been deserialized." << std::endl;
     
     //getting the secret key
     PrivateKey<DCRTPoly> sk;
-    if (Serial::DeserializeFromFile(PRIVATEKEY + "/key-private.txt", sk, SerType::BINARY) == false) {
-        std::cerr << "Could not read secret key" << std::endl;
-        return 1;
+    {
+        FHE_SPAN("deserialize:key-private");
+        if (deserializeAsync(skBytes, sk) == false) {
+            std::cerr << "Could not read secret key" << std::endl;
+            return 1;
+        }
     }
     std::cout << "The secret key has been deserialized." << std::endl;
+
+    if (!batch.empty()) {
+        auto end_deserialize = std::chrono::high_resolution_clock::now();
+        memory.end("deserialize");
+
+        memory.begin("decrypt");
+        auto start_batch = std::chrono::high_resolution_clock::now();
+        TaskRuntime runtime(std::min<size_t>(workers, batch.size()));
+        size_t result_bytes = 0;
+        size_t failed = decryptBatch(cc, sk, io, batch, runtime, format, slots, schemeConfig, result_bytes);
+        auto end_batch = std::chrono::high_resolution_clock::now();
+        memory.end("decrypt");
+
+        memory.begin("save");
+        bool drained = io.drain();
+        auto end_total = std::chrono::high_resolution_clock::now();
+        memory.end("save");
+        if (!drained) {
+            std::cerr << "Error: Could not write every decrypted result: " << io.lastError() << std::endl;
+        }
+
+        double deserialize_time = std::chrono::duration<double>(end_deserialize - start_deserialize).count();
+        double batch_time = std::chrono::duration<double>(end_batch - start_batch).count();
+        double save_time = std::chrono::duration<double>(end_total - end_batch).count();
+        double total_time = std::chrono::duration<double>(end_total - start_total).count();
+        double decrypted = static_cast<double>(batch.size() - failed);
+        double throughput = batch_time > 0 ? decrypted / batch_time : 0;
+
+        std::cout << "=== TIMING_RESULTS ===" << std::endl;
+        std::cout << "DEC_DESERIALIZE_TIME: " << deserialize_time << std::endl;
+        std::cout << "DEC_BATCH_TIME: " << batch_time << std::endl;
+        std::cout << "DEC_SAVE_TIME: " << save_time << std::endl;
+        std::cout << "DEC_TOTAL_TIME: " << total_time << std::endl;
+        std::cout << "DEC_IO_WAIT_TIME: " << io.waitSeconds() << std::endl;
+        std::cout << "DEC_IO_BACKEND: " << io.backendName() << std::endl;
+        memory.print(std::cout, "DEC");
+        std::cout << "DEC_BATCH_CIPHERTEXTS: " << batch.size() << std::endl;
+        std::cout << "DEC_BATCH_FAILED: " << failed << std::endl;
+        std::cout << "DEC_WORKERS: " << runtime.workers() << std::endl;
+        std::cout << "DEC_THROUGHPUT: " << throughput << " ciphertexts/s" << std::endl;
+        std::cout << "DEC_RESULT_BYTES: " << result_bytes << std::endl;
+
+        std::vector<std::pair<std::string, double>> columns = {{"ciphertexts", static_cast<double>(batch.size())},
+                                                               {"workers", static_cast<double>(runtime.workers())},
+                                                               {"deserialize_time", deserialize_time},
+                                                               {"batch_time", batch_time},
+                                                               {"save_time", save_time},
+                                                               {"total_time", total_time},
+                                                               {"throughput", throughput}};
+        schemeConfig.appendColumns(columns, schemeConfig.ckks() ? schemeConfig.slotCount(cc) : 0);
+        prof::saveTimingToCSV(schemeConfig.csvFile("dec_batch_results.csv"), "decryption", depth, modulus, security, columns);
+        metrics::recordPhase("decryption", columns);
+        metrics::add("fhe_serialized_bytes", "Bytes of serialized artifacts", {{"phase", "decryption"}, {"artifact", "result"}},
+                     static_cast<double>(result_bytes));
+        return failed == 0 && drained ? 0 : 1;
+    }
     
     //getting the encrypted result
     Ciphertext<DCRTPoly> output_ciphertext;
-    if (Serial::DeserializeFromFile(DATAFOLDER + "/output_ciphertext.txt", output_ciphertext, SerType::BINARY) == false) {
-        std::cerr << "Could not read the ciphertext" << std::endl;
-        return 1;
+    {
+        FHE_SPAN("deserialize:output_ciphertext");
+        if (deserializeAsync(ctBytes, output_ciphertext) == false) {
+            std::cerr << "Could not read the ciphertext" << std::endl;
+            return 1;
+        }
     }
     std::cout << "The encrypted result of the homomorphic evaluation has been deserialized." << std::endl;
     
     auto end_deserialize = std::chrono::high_resolution_clock::now();
+    memory.end("deserialize");
     
     // Time decryption
+    memory.begin("decrypt");
     auto start_decrypt = std::chrono::high_resolution_clock::now();
     
     //decrypting the result
     Plaintext final_output;
-    cc->Decrypt(sk, output_ciphertext, &final_output);
-    std::cout << "OUTPUT VALUE : " << final_output << std::endl;
+    {
+        FHE_SPAN("Decrypt");
+        cc->Decrypt(sk, output_ciphertext, &final_output);
+    }
+
+    // Work on the decoded slots directly; Decrypt always decodes the whole
+    // ring, the slot selection only limits what gets formatted and written.
+    // CKKS slots are decoded as reals, as many as were packed.
+    std::vector<double> realValues;
+    const std::vector<int64_t>* intValues = nullptr;
+    size_t slotCount;
+    if (schemeConfig.ckks()) {
+        final_output->SetLength(schemeConfig.slotCount(cc));
+        realValues = final_output->GetRealPackedValue();
+        slotCount = realValues.size();
+    } else {
+        intValues = &final_output->GetPackedValue();
+        slotCount = intValues->size();
+    }
+    if (printLimit > 0) {
+        std::cout << "OUTPUT VALUE : ";
+        if (intValues) {
+            result::preview(std::cout, *intValues, slots, printLimit);
+        } else {
+            result::preview(std::cout, realValues, slots, printLimit);
+        }
+        std::cout << std::endl;
+    }
     
     auto end_decrypt = std::chrono::high_resolution_clock::now();
+    memory.end("decrypt");
     
     // Time saving result
+    memory.begin("save");
     auto start_save = std::chrono::high_resolution_clock::now();
     
     //saving the decrypted result
-    std::string filepath = "dec_results/result.txt";
-    std::ofstream outfile(filepath);
-    if (!outfile) {
+    std::string resultBytes;
+    {
+        FHE_SPAN("format:result");
+        resultBytes = intValues ? result::format(*intValues, slots, format) : result::format(realValues, slots, format);
+    }
+    size_t result_bytes = resultBytes.size();
+    bool saved;
+    {
+        FHE_SPAN("io:write-result");
+        saved = io.write(filepath, std::move(resultBytes)) && io.drain();
+    }
+    if (!saved) {
        std::cout << "Could not open the target file for saving the decrypted result" << std::endl;
        return 1; 
     }
-    outfile << final_output << std::endl;
-    outfile.close();
     
     auto end_save = std::chrono::high_resolution_clock::now();
+    memory.end("save");
     auto end_total = std::chrono::high_resolution_clock::now();
+
+    // Error of every decrypted slot against the exact result, outside the timings
+    scheme::Accuracy accuracy;
+    if (schemeConfig.ckks()) {
+        int width = 0;
+        try {
+            if (circuitBytes.valid()) width = parseCircuitWidth(circuitBytes.get());
+        } catch (const std::exception&) {
+        }
+        if (width == 0) {
+            std::cerr << "Warning: no circuit_params from fhe-main, comparing with a circuit of width 1" << std::endl;
+            width = 1;
+        }
+        accuracy = scheme::compare(realValues, scheme::expected(depth, width, slotCount));
+    }
     
-    // Calculate durations in microseconds
-    auto deserialize_duration = std::chrono::duration_cast<std::chrono::microseconds>(end_deserialize - start_deserialize);
-    auto decrypt_duration = std::chrono::duration_cast<std::chrono::microseconds>(end_decrypt - start_decrypt);
-    auto save_duration = std::chrono::duration_cast<std::chrono::microseconds>(end_save - start_save);
-    auto total_duration = std::chrono::duration_cast<std::chrono::microseconds>(end_total - start_total);
+    // Calculate durations in nanoseconds
+    auto deserialize_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_deserialize - start_deserialize);
+    auto decrypt_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_decrypt - start_decrypt);
+    auto save_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_save - start_save);
+    auto total_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_total - start_total);
 
     // Convert to seconds
-    double deserialize_time = deserialize_duration.count() / 1000000.0;
-    double decrypt_time = decrypt_duration.count() / 1000000.0;
-    double save_time = save_duration.count() / 1000000.0;
-    double total_time = total_duration.count() / 1000000.0;
+    double deserialize_time = deserialize_duration.count() / 1e9;
+    double decrypt_time = decrypt_duration.count() / 1e9;
+    double save_time = save_duration.count() / 1e9;
+    double total_time = total_duration.count() / 1e9;
+    double io_wait_time = io.waitSeconds();
 
     // Output timing results in a parseable format
     std::cout << "=== TIMING_RESULTS ===" << std::endl;
@@ -179,10 +535,35 @@ int main()
     std::cout << "DEC_DECRYPT_TIME: " << decrypt_time << std::endl;
     std::cout << "DEC_SAVE_TIME: " << save_time << std::endl;
     std::cout << "DEC_TOTAL_TIME: " << total_time << std::endl;
+    std::cout << "DEC_IO_WAIT_TIME: " << io_wait_time << std::endl;
+    std::cout << "DEC_IO_BACKEND: " << io.backendName() << std::endl;
+    memory.print(std::cout, "DEC");
+    std::cout << "DEC_RESULT_SLOTS: " << slots.count(slotCount) << std::endl;
+    std::cout << "DEC_RESULT_BYTES: " << result_bytes << std::endl;
+    if (schemeConfig.ckks()) {
+        std::cout << "DEC_SCHEME: ckks " << scheme::scalingName(schemeConfig.scaling) << std::endl;
+        std::cout << "DEC_MAX_ABS_ERROR: " << accuracy.maxError << std::endl;
+        std::cout << "DEC_MEAN_ABS_ERROR: " << accuracy.meanError << std::endl;
+        std::cout << "DEC_PRECISION_BITS: " << accuracy.precisionBits() << std::endl;
+    }
     
     // Save to CSV
-    saveTimingToCSV("decryption", depth, modulus, security,
-                    deserialize_time, decrypt_time, save_time, total_time);
+    std::vector<std::pair<std::string, double>> columns = {{"deserialize_time", deserialize_time},
+                                                           {"decrypt_time", decrypt_time},
+                                                           {"save_time", save_time},
+                                                           {"total_time", total_time},
+                                                           {"io_wait_time", io_wait_time}};
+    memory.appendColumns(columns);
+    if (schemeConfig.ckks()) {
+        schemeConfig.appendColumns(columns, slotCount);
+        // As bits: the CSV has ten decimals, fewer than the errors need
+        columns.emplace_back("precision_bits", accuracy.precisionBits());
+        columns.emplace_back("mean_precision_bits", accuracy.meanPrecisionBits());
+    }
+    prof::saveTimingToCSV(schemeConfig.csvFile("dec_timing_results.csv"), "decryption", depth, modulus, security, columns);
+    metrics::recordPhase("decryption", columns);
+    metrics::add("fhe_serialized_bytes", "Bytes of serialized artifacts", {{"phase", "decryption"}, {"artifact", "result"}},
+                 static_cast<double>(result_bytes));
     
     //main return value
     return 0;
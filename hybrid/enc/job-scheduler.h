@@ -0,0 +1,230 @@
+//DEADLINE-AWARE ADMISSION AND SCHEDULING OF SERVED JOBS
+//
+// fhe-main --serve evaluates one job at a time, and jobs differ in cost by
+// orders of magnitude: a depth-48 job on a 65536 ring runs for minutes, a
+// depth-1 job for milliseconds. Served in arrival order, short jobs wait
+// behind long ones. The Scheduler instead runs the queued job with the
+// earliest deadline first.
+//
+// A job's cost is estimated before it runs, from what its refs tell without
+// deserializing anything: depth * width multiplications, each costing about
+// the size of a ciphertext (ring dimension times towers). CostModel turns
+// these units into seconds at a rate calibrated on the jobs already run.
+//
+// A job may carry a hard deadline; one that cannot finish in time behind the
+// work queued ahead of it is rejected at once rather than run late, and so is
+// any job that would push an admitted hard deadline queued behind it past its
+// time. Jobs without one get a soft deadline, slack * estimated cost after
+// arrival, with more slack for the batch class than for interactive jobs:
+// short jobs go first, and long ones still age to the front. Queues are
+// bounded per class; a job arriving at a full queue is rejected, or blocks the
+// submitter until there is room when backpressure is asked for, and only then
+// counts as arrived.
+
+#ifndef FHE_JOB_SCHEDULER_H
+#define FHE_JOB_SCHEDULER_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sched {
+
+using Clock = std::chrono::steady_clock;
+
+enum class Class { Interactive, Batch };
+
+inline const char* className(Class c) { return c == Class::Interactive ? "interactive" : "batch"; }
+
+inline bool parseClass(const std::string& s, Class& out) {
+    if (s == "interactive") {
+        out = Class::Interactive;
+    } else if (s == "batch") {
+        out = Class::Batch;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+class CostModel {
+public:
+    static double units(int depth, int width, uint64_t ciphertextBytes) {
+        // The +1 stands for deserializing and serializing, also linear in size
+        return (static_cast<double>(depth) * width + 1) * static_cast<double>(ciphertextBytes);
+    }
+
+    double seconds(double units) const { return units * rate_; }
+
+    // Calibrate on a finished job; recent jobs weigh most
+    void observe(double units, double seconds) {
+        if (units <= 0 || seconds <= 0) return;
+        double rate = seconds / units;
+        rate_ = samples_ == 0 ? rate : 0.8 * rate_ + 0.2 * rate;
+        samples_++;
+    }
+
+private:
+    double rate_ = 4e-8;  // about a 10 ms EvalMult on a 2-tower 8192 ring
+    uint64_t samples_ = 0;
+};
+
+struct Job {
+    std::string name;
+    Class cls = Class::Batch;
+    double units = 0;
+    double cost = 0;  // estimated seconds
+    bool hardDeadline = false;
+    Clock::time_point arrival;
+    Clock::time_point deadline;
+    uint64_t sequence = 0;
+};
+
+class Scheduler {
+public:
+    enum class Order { Deadline, Arrival };
+
+    struct Options {
+        size_t interactiveCapacity = 48;
+        size_t batchCapacity = 16;
+        double interactiveSlack = 10;
+        double batchSlack = 100;
+        bool block = false;  // backpressure instead of rejecting at a full queue
+        Order order = Order::Deadline;
+    };
+
+    explicit Scheduler(Options options) : options_(options) {}
+
+    // Queue a job; returns why it was rejected, or an empty string
+    std::string submit(Job job) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        size_t capacity = job.cls == Class::Interactive ? options_.interactiveCapacity : options_.batchCapacity;
+        if (options_.block) {
+            space_.wait(lock, [&] { return closed_ || queued(job.cls) < capacity; });
+        }
+        if (closed_) return "closed";
+        if (queued(job.cls) >= capacity) {
+            rejected_++;
+            return "queue-full";
+        }
+
+        // Time starts once there is room: a job held back by backpressure must
+        // not spend its soft slack, or be judged against its hard deadline, as
+        // if it had been queued all along
+        job.arrival = Clock::now();
+        job.cost = model_.seconds(job.units);
+        job.sequence = sequence_++;
+        if (!job.hardDeadline) {
+            double slack = job.cls == Class::Interactive ? options_.interactiveSlack : options_.batchSlack;
+            job.deadline = job.arrival + toDuration(slack * job.cost);
+        }
+        if (options_.order == Order::Deadline && !meetsHardDeadlines(job)) {
+            rejected_++;
+            return "deadline";
+        }
+        queue_.push_back(std::move(job));
+        ready_.notify_one();
+        return std::string();
+    }
+
+    // Wait for the next job to run; false once closed and drained
+    bool next(Job& out) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [&] { return closed_ || !queue_.empty(); });
+        if (queue_.empty()) return false;
+        auto first = std::min_element(queue_.begin(), queue_.end(), [&](const Job& a, const Job& b) {
+            return options_.order == Order::Deadline ? runsBefore(a, b) : a.sequence < b.sequence;
+        });
+        out = std::move(*first);
+        queue_.erase(first);
+        running_ = true;
+        runningCost_ = out.cost;
+        runningStart_ = Clock::now();
+        space_.notify_all();
+        return true;
+    }
+
+    // The job next() handed out is over, after `seconds`
+    void finished(const Job& job, double seconds) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        model_.observe(job.units, seconds);
+        running_ = false;
+    }
+
+    // No more submissions; next() drains what is queued
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        ready_.notify_all();
+        space_.notify_all();
+    }
+
+    size_t depth() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return queue_.size();
+    }
+
+    uint64_t rejected() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return rejected_;
+    }
+
+private:
+    static Clock::duration toDuration(double seconds) {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    }
+
+    size_t queued(Class cls) const {
+        return static_cast<size_t>(std::count_if(queue_.begin(), queue_.end(), [&](const Job& j) { return j.cls == cls; }));
+    }
+
+    static bool runsBefore(const Job& a, const Job& b) {
+        return a.deadline != b.deadline ? a.deadline < b.deadline : a.sequence < b.sequence;
+    }
+
+    // Whether, with `job` queued too, the new job (if hard) and every hard job
+    // it would run ahead of still finish by their deadlines, in EDF order
+    // behind what is running
+    bool meetsHardDeadlines(const Job& job) const {
+        std::vector<const Job*> order;
+        for (const Job& q : queue_) order.push_back(&q);
+        order.push_back(&job);
+        std::sort(order.begin(), order.end(), [](const Job* a, const Job* b) { return runsBefore(*a, *b); });
+
+        double finish = remainingRunning();
+        bool behind = false;  // past the new job
+        for (const Job* q : order) {
+            finish += q->cost;
+            if (q == &job) behind = true;
+            if (behind && q->hardDeadline && job.arrival + toDuration(finish) > q->deadline) return false;
+        }
+        return true;
+    }
+
+    double remainingRunning() const {
+        if (!running_) return 0;
+        double elapsed = std::chrono::duration<double>(Clock::now() - runningStart_).count();
+        return std::max(0.0, runningCost_ - elapsed);
+    }
+
+    Options options_;
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    std::condition_variable space_;
+    std::vector<Job> queue_;
+    CostModel model_;
+    uint64_t sequence_ = 0;
+    uint64_t rejected_ = 0;
+    bool closed_ = false;
+    bool running_ = false;
+    double runningCost_ = 0;
+    Clock::time_point runningStart_;
+};
+
+} // namespace sched
+
+#endif // FHE_JOB_SCHEDULER_H
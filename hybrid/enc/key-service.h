@@ -0,0 +1,281 @@
+//KEY SERVICE : REQUESTS TO A LONG-LIVED FHE-KEYD OVER A LOOPBACK SOCKET
+//
+// Every gramine-sgx enc or dec call builds an enclave, reads the keys through
+// the encrypted private_data mount and deserializes the context, all for a few
+// milliseconds of crypto. fhe-keyd pays for that once: it loads the context,
+// the public and the secret key at startup and then serves encrypt and
+// decrypt requests until told to stop, so a request costs its crypto alone.
+//
+// Requests are lines of text on a TCP connection to 127.0.0.1, the only
+// address fhe-keyd listens on (Gramine only connects UNIX sockets between
+// processes of the same Gramine instance, not to the host). Loopback still
+// lets every local process connect, so a connection starts with
+//
+//   auth TOKEN             "ok auth", or "error auth MESSAGE" and the end
+//
+// TOKEN being the random one fhe-keyd writes, owner-readable only, to its
+// --token-file (keyd/token) at startup. Artifacts stay files under
+// /bdt/build, as with the other binaries, and requests may only name them
+// under data/, results/, dec_results/ and keyd/ (outputs not under data/):
+//
+//   encrypt INPUT OUTPUT   whitespace-separated values of INPUT (integers, or
+//                          reals under CKKS) -> serialized ciphertext OUTPUT
+//   decrypt INPUT OUTPUT   serialized ciphertext INPUT -> result OUTPUT, in the
+//                          --format and --slots fhe-keyd was started with
+//   stats                  "stats requests=N failed=N batches=N busy_s=S"
+//   shutdown               "bye"; fhe-keyd exits once its connections close
+//
+// Encrypt and decrypt lines up to an empty line (or the end of the
+// connection) form a batch, run in parallel. One reply per request comes back
+// in request order, then the batch's summary:
+//
+//   ok OUTPUT SECONDS      the request's own time, reading to writing
+//   error INPUT MESSAGE
+//   end REQUESTS FAILED SECONDS
+
+#ifndef FHE_KEY_SERVICE_H
+#define FHE_KEY_SERVICE_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace keysvc {
+
+constexpr int DEFAULT_PORT = 7100;
+const std::string LOOPBACK = "127.0.0.1";
+const std::string DEFAULT_TOKEN_FILE = "keyd/token";
+
+struct Request {
+    enum class Op { Encrypt, Decrypt, Stats, Shutdown };
+    Op op = Op::Stats;
+    std::string input;
+    std::string output;
+
+    bool batched() const { return op == Op::Encrypt || op == Op::Decrypt; }
+
+    // One request line; false (with `error` set) if it is not one
+    static bool parse(const std::string& line, Request& out, std::string& error) {
+        std::istringstream fields(line);
+        std::string op, extra;
+        fields >> op;
+        Request r;
+        if (op == "encrypt" || op == "decrypt") {
+            r.op = op == "encrypt" ? Op::Encrypt : Op::Decrypt;
+            if (!(fields >> r.input >> r.output) || (fields >> extra)) {
+                error = op + " takes INPUT OUTPUT";
+                return false;
+            }
+        } else if (op == "stats" || op == "shutdown") {
+            r.op = op == "stats" ? Op::Stats : Op::Shutdown;
+        } else {
+            error = "unknown request " + op;
+            return false;
+        }
+        out = r;
+        return true;
+    }
+};
+
+// A connected socket read line by line and written a line at a time
+class Connection {
+public:
+    explicit Connection(int fd = -1) : fd_(fd) {}
+    ~Connection() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    bool open() const { return fd_ >= 0; }
+
+    // Next line without its newline; false at the end of the stream
+    bool readLine(std::string& line) {
+        for (;;) {
+            size_t nl = buffer_.find('\n');
+            if (nl != std::string::npos) {
+                line = buffer_.substr(0, nl);
+                buffer_.erase(0, nl + 1);
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                return true;
+            }
+            char buf[4096];
+            ssize_t n = ::recv(fd_, buf, sizeof(buf), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                if (buffer_.empty()) return false;
+                line.swap(buffer_);
+                buffer_.clear();
+                return true;
+            }
+            buffer_.append(buf, static_cast<size_t>(n));
+        }
+    }
+
+    bool write(const std::string& text) {
+        size_t off = 0;
+        while (off < text.size()) {
+            ssize_t n = ::send(fd_, text.data() + off, text.size() - off, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            off += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+private:
+    int fd_;
+    std::string buffer_;
+};
+
+inline bool socketAddress(const std::string& addr, int port, sockaddr_in& sa) {
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(static_cast<uint16_t>(port));
+    return port > 0 && port < 65536 && ::inet_pton(AF_INET, addr.c_str(), &sa.sin_addr) == 1;
+}
+
+// A fresh 256-bit token, in hex; empty if there is no randomness to be had
+inline std::string newToken() {
+    std::ifstream random("/dev/urandom", std::ios::binary);
+    unsigned char bytes[32];
+    if (!random.read(reinterpret_cast<char*>(bytes), sizeof(bytes))) return "";
+    static const char hex[] = "0123456789abcdef";
+    std::string token;
+    for (unsigned char b : bytes) {
+        token += hex[b >> 4];
+        token += hex[b & 15];
+    }
+    return token;
+}
+
+// Replace the token file with one only its owner can read
+inline bool writeToken(const std::string& path, const std::string& token) {
+    ::unlink(path.c_str());
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        std::cerr << "Error: cannot write " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    std::string text = token + "\n";
+    bool ok = ::write(fd, text.data(), text.size()) == static_cast<ssize_t>(text.size());
+    ::close(fd);
+    if (!ok) std::cerr << "Error: cannot write " << path << std::endl;
+    return ok;
+}
+
+inline bool readToken(const std::string& path, std::string& token) {
+    std::ifstream in(path);
+    if (!(in >> token)) {
+        std::cerr << "Error: cannot read the fhe-keyd token from " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Compares every byte whatever the first difference, so the time taken says
+// nothing about how much of a guess was right
+inline bool sameToken(const std::string& a, const std::string& b) {
+    unsigned char diff = a.size() != b.size();
+    for (size_t i = 0; i < a.size() && i < b.size(); i++) diff |= a[i] ^ b[i];
+    return diff == 0 && !a.empty();
+}
+
+// Whether a request may name this file: relative, without "..", under one of
+// the artifact directories (data/ only to read from) and, symlinks resolved,
+// still inside it. The token file itself is off limits.
+inline bool confinedPath(const std::string& path, bool output, const std::string& tokenFile, std::string& error) {
+    namespace fs = std::filesystem;
+    fs::path p(path);
+    if (p.empty() || p.is_absolute()) {
+        error = path + " is not a relative path";
+        return false;
+    }
+    for (const fs::path& part : p) {
+        if (part == "..") {
+            error = path + " leaves its directory";
+            return false;
+        }
+    }
+    std::string top = p.begin()->string();
+    bool allowed = top == "results" || top == "dec_results" || top == "keyd" || (top == "data" && !output);
+    if (allowed && std::next(p.begin()) == p.end()) {
+        error = path + " is a directory";
+        return false;
+    }
+    if (!allowed) {
+        error = path + (output ? " is not under results/, dec_results/ or keyd/"
+                               : " is not under data/, results/, dec_results/ or keyd/");
+        return false;
+    }
+    std::error_code ec;
+    fs::path root = fs::canonical(top, ec);
+    fs::path resolved = ec ? fs::path() : fs::weakly_canonical(p, ec);
+    if (ec || std::mismatch(root.begin(), root.end(), resolved.begin(), resolved.end()).first != root.end()) {
+        error = path + " resolves outside " + top + "/";
+        return false;
+    }
+    if (resolved == fs::weakly_canonical(tokenFile, ec)) {
+        error = path + " is the token file";
+        return false;
+    }
+    return true;
+}
+
+// Listening socket on addr:port, or -1 (the error has been printed)
+inline int listenOn(const std::string& addr, int port) {
+    sockaddr_in sa;
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int one = 1;
+    if (fd < 0 || !socketAddress(addr, port, sa) ||
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+        ::bind(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) != 0 || ::listen(fd, 16) != 0) {
+        std::cerr << "Error: cannot listen on " << addr << ":" << port << ": " << std::strerror(errno) << std::endl;
+        if (fd >= 0) ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Connection to addr:port, retried every 100 ms for up to waitSeconds while
+// the service is still starting; -1 if it never answered
+inline int connectTo(const std::string& addr, int port, double waitSeconds) {
+    sockaddr_in sa;
+    if (!socketAddress(addr, port, sa)) {
+        std::cerr << "Error: invalid address " << addr << ":" << port << std::endl;
+        return -1;
+    }
+    for (int attempt = 0;; attempt++) {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) break;
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) == 0) {
+            // Replies are single lines: send them as they are written
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            return fd;
+        }
+        ::close(fd);
+        if (attempt * 0.1 >= waitSeconds) break;
+        ::poll(nullptr, 0, 100);
+    }
+    std::cerr << "Error: cannot connect to " << addr << ":" << port << ": " << std::strerror(errno) << std::endl;
+    return -1;
+}
+
+} // namespace keysvc
+
+#endif // FHE_KEY_SERVICE_H
@@ -0,0 +1,172 @@
+//HOMOMORPHIC EVALUATION OF BINARY DECISION TREE FROM OPENFHE : KEY SERVICE CLIENT
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "key-service.h"
+
+// Send one batch (or a single stats/shutdown line) and print its replies;
+// false if the connection broke
+bool roundTrip(keysvc::Connection& connection, const std::vector<std::string>& lines, bool batched,
+               size_t& requests, size_t& failed) {
+    std::string text;
+    for (const std::string& line : lines) text += line + "\n";
+    if (batched) text += "\n";
+    if (!connection.write(text)) return false;
+
+    std::string reply;
+    while (connection.readLine(reply)) {
+        std::cout << reply << std::endl;
+        std::istringstream fields(reply);
+        std::string kind;
+        fields >> kind;
+        if (!batched) return true;
+        if (kind == "end") {
+            size_t n = 0, f = 0;
+            fields >> n >> f;
+            requests += n;
+            failed += f;
+            return true;
+        }
+    }
+    return false;
+}
+
+/////////////////////////////////////////////
+//                                         //
+//               |MAIN|                    //
+//                                         //
+/////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+    std::string addr = "127.0.0.1";
+    int port = keysvc::DEFAULT_PORT;
+    double wait = 0;
+    std::string batchFile;
+    std::string tokenFile = keysvc::DEFAULT_TOKEN_FILE;
+    int repeat = 1;
+    std::vector<std::string> words;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--port" && i + 1 < argc) {
+            port = std::stoi(argv[++i]);
+        } else if (arg == "--addr" && i + 1 < argc) {
+            addr = argv[++i];
+        } else if (arg == "--wait" && i + 1 < argc) {
+            wait = std::stod(argv[++i]);
+        } else if (arg == "--token-file" && i + 1 < argc) {
+            tokenFile = argv[++i];
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batchFile = argv[++i];
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--help") {
+            std::cout << "Usage: " << argv[0] << " [OPTIONS] [REQUEST...]\n"
+                      << "Send requests to fhe-keyd (see key-service.h), e.g.\n"
+                      << "  " << argv[0] << " decrypt results/output_ciphertext.txt dec_results/output_result.txt\n"
+                      << "  " << argv[0] << " stats\n"
+                      << "  " << argv[0] << " shutdown\n"
+                      << "Options:\n"
+                      << "  --port N       TCP port of fhe-keyd (default: " << keysvc::DEFAULT_PORT << ")\n"
+                      << "  --addr A       Address of fhe-keyd (default: 127.0.0.1)\n"
+                      << "  --token-file F Token fhe-keyd wrote at startup (default: " << keysvc::DEFAULT_TOKEN_FILE << ")\n"
+                      << "  --wait S       Retry connecting for S seconds while fhe-keyd starts (default: 0)\n"
+                      << "  --batch FILE   Send the request lines of FILE (- for stdin) as one batch\n"
+                      << "  --repeat N     Send the batch N times, one round trip each (default: 1)\n"
+                      << "  --help         Display this help message\n";
+            return 0;
+        } else {
+            words.push_back(arg);
+        }
+    }
+
+    std::vector<std::string> lines;
+    if (!batchFile.empty()) {
+        std::ifstream file;
+        std::istream& in = batchFile == "-" ? std::cin : (file.open(batchFile), file);
+        if (!in) {
+            std::cerr << "Error: cannot read " << batchFile << std::endl;
+            return 1;
+        }
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty()) lines.push_back(line);
+        }
+    }
+    if (!words.empty()) {
+        std::string line = words[0];
+        for (size_t i = 1; i < words.size(); i++) line += " " + words[i];
+        lines.push_back(line);
+    }
+    if (lines.empty()) {
+        std::cerr << "Error: no request given (see --help)" << std::endl;
+        return 1;
+    }
+
+    // stats and shutdown go alone, the rest as a batch
+    keysvc::Request request;
+    std::string error;
+    bool batched = true;
+    for (const std::string& line : lines) {
+        if (!keysvc::Request::parse(line, request, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
+        if (!request.batched()) batched = false;
+    }
+    if (!batched && lines.size() > 1) {
+        std::cerr << "Error: stats and shutdown cannot be batched" << std::endl;
+        return 1;
+    }
+
+    keysvc::Connection connection(keysvc::connectTo(addr, port, wait));
+    if (!connection.open()) return 1;
+
+    // The token is read once connected: fhe-keyd writes it before listening
+    std::string token, reply;
+    if (!keysvc::readToken(tokenFile, token)) return 1;
+    if (!connection.write("auth " + token + "\n") || !connection.readLine(reply) || reply != "ok auth") {
+        std::cerr << "Error: fhe-keyd refused the connection: " << reply << std::endl;
+        return 1;
+    }
+
+    size_t requests = 0, failed = 0;
+    std::vector<double> roundTrips;
+    for (int r = 0; r < repeat; r++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        if (!roundTrip(connection, lines, batched, requests, failed)) {
+            std::cerr << "Error: fhe-keyd closed the connection" << std::endl;
+            return 1;
+        }
+        roundTrips.push_back(
+            std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+    }
+    if (!batched) return 0;
+
+    double total = 0;
+    for (double t : roundTrips) total += t;
+    std::sort(roundTrips.begin(), roundTrips.end());
+    auto percentile = [&](double q) {
+        size_t rank = static_cast<size_t>(std::ceil(q * roundTrips.size()));
+        return roundTrips[std::min(roundTrips.size(), std::max<size_t>(1, rank)) - 1];
+    };
+
+    std::cout << "=== TIMING_RESULTS ===" << std::endl;
+    std::cout << "KEYCTL_REQUESTS: " << requests << std::endl;
+    std::cout << "KEYCTL_FAILED: " << failed << std::endl;
+    std::cout << "KEYCTL_ROUND_TRIPS: " << roundTrips.size() << std::endl;
+    std::cout << "KEYCTL_ROUND_TRIP_TIME: " << total / roundTrips.size() << std::endl;
+    std::cout << "KEYCTL_ROUND_TRIP_P50_MS: " << percentile(0.50) * 1e3 << std::endl;
+    std::cout << "KEYCTL_ROUND_TRIP_P99_MS: " << percentile(0.99) * 1e3 << std::endl;
+
+    //main return value
+    return failed ? 1 : 0;
+}
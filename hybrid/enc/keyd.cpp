@@ -0,0 +1,505 @@
+//HOMOMORPHIC EVALUATION OF BINARY DECISION TREE FROM OPENFHE : KEY SERVICE
+
+#include "openfhe.h"
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <atomic>
+#include <csignal>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+
+// header files needed for serialization
+#include "ciphertext-ser.h"
+#include "cryptocontext-ser.h"
+#include "key/key-ser.h"
+#include "scheme/bgvrns/bgvrns-ser.h"
+#include "scheme/ckksrns/ckksrns-ser.h"
+
+#include "async-io.h"
+#include "result-output.h"
+#include "artifact-store.h"
+#include "profiling.h"
+#include "memory-stats.h"
+#include "metrics.h"
+#include "op-profile.h"
+#include "task-runtime.h"
+#include "scheme-config.h"
+#include "key-service.h"
+
+using namespace lbcrypto;
+
+const std::string DATAFOLDER = "data";
+const std::string CRYPTOCONTEXT = "cryptocontext";
+const std::string PRIVATEKEY = "private_data";
+const std::string STOREFOLDER = "store";
+
+std::tuple<int, int, int> parseConfigParameters(std::istream& in, scheme::Config* schemeConfig = nullptr) {
+    int depth = 8;      // Default value
+    int modulus = 65537; // Default value
+    int security = 128;  // Default value
+
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream iss(line);
+        std::string key;
+        std::getline(iss, key, '=');
+
+        if (key == "depth") {
+            iss >> depth;
+        } else if (key == "modulus") {
+            iss >> modulus;
+        } else if (key == "security") {
+            iss >> security;
+        } else if (schemeConfig) {
+            std::string value;
+            std::getline(iss, value);
+            schemeConfig->set(key, value);
+        }
+    }
+
+    return {depth, modulus, security};
+}
+
+// SIGTERM (docker stop, Gramine's injected one) and SIGINT end the service
+// like a shutdown request, also closing connections that are idle
+std::atomic<bool> stopping{false};
+std::atomic<bool> interrupted{false};
+
+extern "C" void onSignal(int) {
+    stopping = true;
+    interrupted = true;
+}
+
+// What the service loaded once and every request uses
+struct Keys {
+    CryptoContext<DCRTPoly> cc;
+    PublicKey<DCRTPoly> pk;
+    PrivateKey<DCRTPoly> sk;
+    scheme::Config scheme;
+    size_t slots = 0;
+};
+
+struct BatchItem {
+    keysvc::Request request;
+    std::shared_future<std::string> bytes;
+    Ciphertext<DCRTPoly> ciphertext;
+    std::chrono::steady_clock::time_point start;
+    double seconds = 0;
+    std::string error;
+};
+
+// Values of an encrypt request's input file, in the scheme's slot type
+template <typename T>
+std::vector<T> parseValues(const std::string& text, size_t slots) {
+    std::istringstream in(text);
+    std::vector<T> values;
+    T v;
+    while (in >> v) values.push_back(v);
+    if (!in.eof()) throw std::runtime_error("input holds something other than numbers");
+    if (values.empty()) throw std::runtime_error("input holds no values");
+    if (values.size() > slots) {
+        throw std::runtime_error("input holds " + std::to_string(values.size()) + " values, more than the " +
+                                 std::to_string(slots) + " slots");
+    }
+    return values;
+}
+
+// Serve one batch with the loaded keys. Inputs are deserialized one after the
+// other (OpenFHE's context registry is not thread-safe), each read a few files
+// ahead; encryptions and decryptions run on the other workers meanwhile, and
+// their outputs are written as soon as they are ready. Returns the number of
+// requests that failed.
+size_t serveBatch(const Keys& keys, std::vector<BatchItem>& items, TaskRuntime& runtime, result::Format format,
+                  const result::SlotRange& slots) {
+    AsyncIO io;
+    const size_t readAhead = 2 * runtime.workers();
+    auto readInput = [&](BatchItem& item) {
+        if (item.error.empty()) item.bytes = io.read(item.request.input);
+    };
+    for (size_t i = 0; i < items.size() && i < readAhead; i++) readInput(items[i]);
+
+    std::mutex outputMutex;
+    TaskGraph batch;
+    std::vector<size_t> previous;
+    for (size_t i = 0; i < items.size(); i++) {
+        size_t load = batch.add([&, i] {
+            if (i + readAhead < items.size()) readInput(items[i + readAhead]);
+            BatchItem& item = items[i];
+            item.start = std::chrono::steady_clock::now();
+            if (!item.error.empty() || item.request.op != keysvc::Request::Op::Decrypt) return;
+            FHE_SPAN("deserialize:ciphertext");
+            if (!deserializeAsync(item.bytes, item.ciphertext)) item.error = "cannot read the ciphertext";
+            item.bytes = {};
+        }, previous);
+        batch.add([&, i] {
+            BatchItem& item = items[i];
+            if (!item.error.empty()) return;
+            std::string bytes;
+            try {
+                if (item.request.op == keysvc::Request::Op::Decrypt) {
+                    Plaintext plaintext;
+                    {
+                        FHE_SPAN("Decrypt");
+                        keys.cc->Decrypt(keys.sk, item.ciphertext, &plaintext);
+                    }
+                    item.ciphertext = nullptr;
+                    FHE_SPAN("format:result");
+                    if (keys.scheme.ckks()) {
+                        plaintext->SetLength(keys.slots);
+                        bytes = result::format(plaintext->GetRealPackedValue(), slots, format);
+                    } else {
+                        bytes = result::format(plaintext->GetPackedValue(), slots, format);
+                    }
+                } else {
+                    std::string text = item.bytes.get();
+                    item.bytes = {};
+                    Plaintext plaintext = keys.scheme.ckks()
+                        ? keys.cc->MakeCKKSPackedPlaintext(parseValues<double>(text, keys.slots))
+                        : keys.cc->MakePackedPlaintext(parseValues<int64_t>(text, keys.slots));
+                    Ciphertext<DCRTPoly> ciphertext;
+                    {
+                        FHE_SPAN("Encrypt");
+                        ciphertext = keys.cc->Encrypt(keys.pk, plaintext);
+                    }
+                    FHE_SPAN("serialize:ciphertext");
+                    bytes = serializeToBytes(ciphertext);
+                }
+            } catch (const std::exception& e) {
+                item.error = e.what();
+                return;
+            }
+            std::lock_guard<std::mutex> lock(outputMutex);
+            if (!io.write(item.request.output, std::move(bytes))) {
+                item.error = "cannot write " + item.request.output;
+                return;
+            }
+            item.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - item.start).count();
+        }, {load});
+        previous = {load};
+    }
+    runtime.run(batch);
+
+    // A reply says ok only once its output is on disk
+    bool drained = io.drain();
+    size_t failed = 0;
+    for (BatchItem& item : items) {
+        if (item.error.empty() && !drained) item.error = io.lastError();
+        if (!item.error.empty()) failed++;
+    }
+    return failed;
+}
+
+/////////////////////////////////////////////
+//                                         //
+//               |MAIN|                    //
+//                                         //
+/////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+    auto start_total = std::chrono::high_resolution_clock::now();
+
+    int port = keysvc::DEFAULT_PORT;
+    unsigned workers = static_cast<unsigned>(availableCores());
+    size_t maxConnections = 16;
+    result::Format format = result::Format::Text;
+    result::SlotRange slots;
+    bool useStore = false;
+    std::string keysetName;
+    std::string tokenFile = keysvc::DEFAULT_TOKEN_FILE;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--port" && i + 1 < argc) {
+            port = std::stoi(argv[++i]);
+        } else if (arg == "--token-file" && i + 1 < argc) {
+            tokenFile = argv[++i];
+        } else if (arg == "--max-connections" && i + 1 < argc) {
+            maxConnections = static_cast<size_t>(std::max(1, std::stoi(argv[++i])));
+        } else if (arg == "--workers" && i + 1 < argc) {
+            workers = static_cast<unsigned>(std::max(1, std::stoi(argv[++i])));
+        } else if (arg == "--format" && i + 1 < argc) {
+            if (!result::parseFormat(argv[++i], format)) {
+                std::cerr << "Error: --format must be text, csv or binary" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--slots" && i + 1 < argc) {
+            if (!result::SlotRange::parse(argv[++i], slots)) {
+                std::cerr << "Error: --slots expects BEGIN:END[:STEP]" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--store") {
+            useStore = true;
+        } else if (arg == "--keyset" && i + 1 < argc) {
+            keysetName = argv[++i];
+        } else if (arg == "--help") {
+            std::cout << "Usage: " << argv[0] << " [OPTIONS]\n"
+                      << "Load the keys once and serve encrypt and decrypt requests (see key-service.h)\n"
+                      << "Options:\n"
+                      << "  --port N         TCP port to serve on, on 127.0.0.1 (default: " << keysvc::DEFAULT_PORT << ")\n"
+                      << "  --token-file F   Where to write the token clients authenticate with (default: "
+                      << keysvc::DEFAULT_TOKEN_FILE << ")\n"
+                      << "  --workers N      Requests of a batch in flight (default: all cores)\n"
+                      << "  --max-connections N  Clients connected at once; more are turned away (default: 16)\n"
+                      << "  --format F       Decrypted result format: text, csv or binary (default: text)\n"
+                      << "  --slots B:E[:S]  Only output slots B..E-1, every S-th (default: all)\n"
+                      << "  --store          Load the keys of a keyset from the content-addressed store\n"
+                      << "  --keyset NAME    Stored keyset to load\n"
+                      << "  --help           Display this help message\n";
+            return 0;
+        }
+    }
+    if (useStore && keysetName.empty()) {
+        std::cerr << "Error: --store needs --keyset NAME" << std::endl;
+        return 1;
+    }
+
+    prof::Session profile("keyservice");
+    mem::Phase memory({"load", "serve"});
+    metrics::Exporter exporter("keyservice");
+
+    // Load the context, config and both keys, with all reads issued up front.
+    // The secret key never leaves the private volume.
+    memory.begin("load");
+    auto start_load = std::chrono::high_resolution_clock::now();
+    Keys keys;
+    std::tuple<int, int, int> config;
+    {
+        FHE_SPAN("load");
+        AsyncIO io;
+        std::shared_future<std::string> configBytes, ccBytes, pkBytes, skBytes;
+        if (useStore) {
+            ArtifactStore store(io, STOREFOLDER);
+            ArtifactRefs refs;
+            if (!store.readRefs("keysets", keysetName, refs) || !refs.has("cryptocontext") || !refs.has("key-public") ||
+                !refs.has("config_params")) {
+                std::cerr << "Error: keyset " << keysetName << " is not in " << STOREFOLDER << std::endl;
+                return 1;
+            }
+            configBytes = store.get(refs.hash("config_params"));
+            ccBytes = store.get(refs.hash("cryptocontext"));
+            pkBytes = store.get(refs.hash("key-public"));
+            skBytes = io.read(privateKeyPath(PRIVATEKEY, refs.hash("key-public")));
+        } else {
+            configBytes = io.read(DATAFOLDER + "/config_params.txt");
+            ccBytes = io.read(CRYPTOCONTEXT + "/cryptocontext.txt");
+            pkBytes = io.read(DATAFOLDER + "/key-public.txt");
+            skBytes = io.read(PRIVATEKEY + "/key-private.txt");
+        }
+        try {
+            MemoryStream in(configBytes.get());
+            config = parseConfigParameters(in, &keys.scheme);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        if (!deserializeAsync(ccBytes, keys.cc)) {
+            std::cerr << "I cannot read serialization from " << CRYPTOCONTEXT + "/cryptocontext.txt" << std::endl;
+            return 1;
+        }
+        if (!deserializeAsync(pkBytes, keys.pk)) {
+            std::cerr << "Could not read public key" << std::endl;
+            return 1;
+        }
+        if (!deserializeAsync(skBytes, keys.sk)) {
+            std::cerr << "Could not read secret key" << std::endl;
+            return 1;
+        }
+        keys.slots = keys.scheme.ckks() ? keys.scheme.slotCount(keys.cc) : keys.cc->GetRingDimension();
+    }
+    auto [depth, modulus, security] = config;
+    profile.setParameters(depth, modulus, security);
+    double load_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_load).count();
+    memory.end("load");
+    std::cout << "The cryptocontext and the keys have been loaded." << std::endl;
+
+    // A new token every start, written before the port opens so that a client
+    // which could connect can read it
+    const std::string token = keysvc::newToken();
+    if (token.empty()) {
+        std::cerr << "Error: no randomness for the fhe-keyd token" << std::endl;
+        return 1;
+    }
+    if (!keysvc::writeToken(tokenFile, token)) return 1;
+    int listenFd = keysvc::listenOn(keysvc::LOOPBACK, port);
+    if (listenFd < 0) return 1;
+
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onSignal;
+    sigaction(SIGTERM, &sa, nullptr);
+    sigaction(SIGINT, &sa, nullptr);
+
+    std::cout << "KEYD_LOAD_TIME: " << load_time << std::endl;
+    std::cout << "KEYD_READY: " << keysvc::LOOPBACK << ":" << port << std::endl;
+
+    // One thread per connection, up to --max-connections of them, joined once
+    // their connection is over; batches take turns on the workers
+    memory.begin("serve");
+    TaskRuntime runtime(workers);
+    std::mutex serviceMutex;
+    uint64_t requests = 0, failures = 0, batches = 0;
+    double busy_time = 0;
+    LatencyHistogram latency;
+    std::mutex connectionsMutex;
+    std::set<int> openConnections;
+    std::map<uint64_t, std::thread> handlers;
+    std::vector<uint64_t> finished;
+    uint64_t connections = 0;
+
+    auto handle = [&](uint64_t id, int fd) {
+        keysvc::Connection connection(fd);
+        std::vector<BatchItem> items;
+        std::string line;
+        std::istringstream auth(connection.readLine(line) ? line : "");
+        std::string word, presented;
+        bool more = auth >> word >> presented && word == "auth" && keysvc::sameToken(presented, token);
+        if (!more) {
+            metrics::add("fhe_key_auth_failed", "Key service connections refused for a wrong token", {});
+            connection.write("error auth wrong or missing token\n");
+        } else {
+            more = connection.write("ok auth\n");
+        }
+        while (more) {
+            more = connection.readLine(line);
+            if (more && !line.empty()) {
+                keysvc::Request request;
+                std::string error;
+                if (!keysvc::Request::parse(line, request, error)) {
+                    more = connection.write("error " + line + " " + error + "\n");
+                } else if (request.batched()) {
+                    BatchItem item;
+                    item.request = request;
+                    if (keysvc::confinedPath(request.input, false, tokenFile, error)) {
+                        keysvc::confinedPath(request.output, true, tokenFile, error);
+                    }
+                    item.error = error;
+                    items.push_back(std::move(item));
+                } else if (request.op == keysvc::Request::Op::Stats) {
+                    std::lock_guard<std::mutex> lock(serviceMutex);
+                    std::ostringstream reply;
+                    reply << "stats requests=" << requests << " failed=" << failures << " batches=" << batches
+                          << " busy_s=" << busy_time << "\n";
+                    more = connection.write(reply.str());
+                } else {
+                    stopping = true;
+                    more = connection.write("bye\n");
+                }
+                continue;
+            }
+            if (items.empty()) continue;
+
+            // An empty line or the end of the stream closes the batch
+            std::lock_guard<std::mutex> lock(serviceMutex);
+            auto start = std::chrono::steady_clock::now();
+            size_t failed;
+            {
+                FHE_SPAN("batch");
+                failed = serveBatch(keys, items, runtime, format, slots);
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::ostringstream reply;
+            for (const BatchItem& item : items) {
+                const char* op = item.request.op == keysvc::Request::Op::Encrypt ? "encrypt" : "decrypt";
+                if (item.error.empty()) {
+                    reply << "ok " << item.request.output << " " << item.seconds << "\n";
+                    latency.record(static_cast<uint64_t>(item.seconds * 1e9));
+                    metrics::observe("fhe_key_request_seconds", "Reading to writing of key service requests",
+                                     {{"op", op}}, item.seconds);
+                } else {
+                    reply << "error " << item.request.input << " " << item.error << "\n";
+                    metrics::add("fhe_key_requests_failed", "Key service requests that failed", {{"op", op}});
+                }
+            }
+            reply << "end " << items.size() << " " << failed << " " << seconds << "\n";
+            requests += items.size();
+            failures += failed;
+            batches++;
+            busy_time += seconds;
+            items.clear();
+            if (!connection.write(reply.str())) break;
+        }
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        openConnections.erase(fd);
+        finished.push_back(id);
+    };
+    auto reap = [&] {
+        std::vector<uint64_t> ids;
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            ids.swap(finished);
+        }
+        for (uint64_t id : ids) {
+            handlers[id].join();
+            handlers.erase(id);
+        }
+    };
+
+    while (!stopping) {
+        reap();
+        pollfd p{listenFd, POLLIN, 0};
+        if (::poll(&p, 1, 200) <= 0) continue;
+        int client = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) continue;
+        if (handlers.size() >= maxConnections) {
+            keysvc::Connection refused(client);
+            refused.write("error connection too many connections\n");
+            metrics::add("fhe_key_connections_refused", "Key service connections turned away at the limit", {});
+            continue;
+        }
+        int one = 1;
+        ::setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            openConnections.insert(client);
+        }
+        uint64_t id = connections++;
+        handlers.emplace(id, std::thread(handle, id, client));
+    }
+    ::close(listenFd);
+
+    // A signal does not wait for idle clients: their connections read EOF,
+    // after the batch they may be running
+    if (interrupted) {
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        for (int fd : openConnections) ::shutdown(fd, SHUT_RD);
+    }
+    for (auto& [id, t] : handlers) t.join();
+    memory.end("serve");
+
+    double total_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_total).count();
+    double mean_request_time = latency.count() ? latency.mean() / 1e9 : 0;
+
+    std::cout << "=== TIMING_RESULTS ===" << std::endl;
+    std::cout << "KEYD_LOAD_TIME: " << load_time << std::endl;
+    std::cout << "KEYD_TOTAL_TIME: " << total_time << std::endl;
+    std::cout << "KEYD_BUSY_TIME: " << busy_time << std::endl;
+    std::cout << "KEYD_REQUESTS: " << requests << std::endl;
+    std::cout << "KEYD_FAILED: " << failures << std::endl;
+    std::cout << "KEYD_BATCHES: " << batches << std::endl;
+    std::cout << "KEYD_WORKERS: " << runtime.workers() << std::endl;
+    std::cout << "KEYD_CONNECTIONS: " << connections << std::endl;
+    std::cout << "KEYD_REQUEST_MEAN_MS: " << mean_request_time * 1e3 << std::endl;
+    std::cout << "KEYD_REQUEST_P50_MS: " << latency.percentile(0.50) / 1e6 << std::endl;
+    std::cout << "KEYD_REQUEST_P99_MS: " << latency.percentile(0.99) / 1e6 << std::endl;
+    memory.print(std::cout, "KEYD");
+
+    std::vector<std::pair<std::string, double>> columns = {{"load_time", load_time},
+                                                           {"total_time", total_time},
+                                                           {"busy_time", busy_time},
+                                                           {"requests", static_cast<double>(requests)},
+                                                           {"failed", static_cast<double>(failures)},
+                                                           {"batches", static_cast<double>(batches)},
+                                                           {"mean_request_time", mean_request_time}};
+    memory.appendColumns(columns);
+    prof::saveTimingToCSV(keys.scheme.csvFile("keyd_results.csv"), "keyservice", depth, modulus, security, columns);
+    metrics::recordPhase("keyservice", columns);
+
+    //main return value
+    return 0;
+}
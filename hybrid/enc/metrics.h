@@ -0,0 +1,398 @@
+//OPENMETRICS EXPORT : COUNTERS, GAUGES AND HISTOGRAMS FOR PROMETHEUS
+//
+// The binaries record their metrics here as they run, whether or not they are
+// exported. Two exports, both optional and both in the OpenMetrics text
+// format:
+//
+//   FHE_METRICS_DIR=DIR      write DIR/fhe_<phase>.prom for the node exporter's
+//                            textfile collector, atomically, at the end of the
+//                            run and whenever flush() is called
+//   FHE_METRICS_PORT=N       serve GET /metrics on FHE_METRICS_ADDR:N
+//                            (default 127.0.0.1) for as long as the binary runs
+//
+// One-shot runs are better exported through the textfile; the endpoint is
+// meant for long-running modes that a scraper can reach between jobs. The
+// images create /bdt/build/metrics for the textfile, and it is the directory
+// the SGX manifests allow.
+
+#ifndef FHE_METRICS_H
+#define FHE_METRICS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace metrics {
+
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+enum class Type { Counter, Gauge, Histogram };
+
+// Latency buckets in seconds, from 100 us to 250 s
+inline const std::vector<double>& secondsBuckets() {
+    static const std::vector<double> bounds = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01,
+                                               0.025,  0.05,    0.1,    0.25,  0.5,    1,     2.5,
+                                               5,      10,      25,     50,    100,    250};
+    return bounds;
+}
+
+class Registry {
+public:
+    static Registry& get() {
+        static Registry registry;
+        return registry;
+    }
+
+    void add(const std::string& name, const std::string& help, const Labels& labels, double v) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        series(name, help, Type::Counter, labels).value += v;
+    }
+
+    void set(const std::string& name, const std::string& help, const Labels& labels, double v) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        series(name, help, Type::Gauge, labels).value = v;
+    }
+
+    void observe(const std::string& name, const std::string& help, const Labels& labels, double v) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Series& s = series(name, help, Type::Histogram, labels);
+        const auto& bounds = secondsBuckets();
+        if (s.buckets.empty()) s.buckets.assign(bounds.size(), 0);
+        for (size_t i = 0; i < bounds.size(); i++) {
+            if (v <= bounds[i]) s.buckets[i]++;
+        }
+        s.count++;
+        s.value += v;
+    }
+
+    // Counters and gauges computed when rendered (queue depths, live heap)
+    uint64_t addCallback(const std::string& name, const std::string& help, Type type, const Labels& labels,
+                         std::function<double()> fn) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Series& s = series(name, help, type, labels);
+        s.callback = std::move(fn);
+        s.callbackId = ++nextCallback_;
+        return s.callbackId;
+    }
+
+    // The last value is kept once the source goes away
+    void removeCallback(uint64_t id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& [name, family] : families_) {
+            for (auto& [key, s] : family.series) {
+                if (s.callbackId != id) continue;
+                s.value = s.callback();
+                s.callback = nullptr;
+                s.callbackId = 0;
+            }
+        }
+    }
+
+    std::string render() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::ostringstream out;
+        for (const auto& [name, family] : families_) {
+            static const char* typeNames[] = {"counter", "gauge", "histogram"};
+            out << "# TYPE " << name << " " << typeNames[static_cast<int>(family.type)] << "\n";
+            out << "# HELP " << name << " " << family.help << "\n";
+            for (const auto& [key, s] : family.series) {
+                double value = s.callback ? s.callback() : s.value;
+                switch (family.type) {
+                    case Type::Counter:
+                        out << name << "_total" << braces(key) << " " << number(value) << "\n";
+                        break;
+                    case Type::Gauge:
+                        out << name << braces(key) << " " << number(value) << "\n";
+                        break;
+                    case Type::Histogram: {
+                        const auto& bounds = secondsBuckets();
+                        std::string sep = key.empty() ? "" : ",";
+                        for (size_t i = 0; i < bounds.size(); i++) {
+                            out << name << "_bucket{" << key << sep << "le=\"" << bounds[i] << "\"} "
+                                << s.buckets[i] << "\n";
+                        }
+                        out << name << "_bucket{" << key << sep << "le=\"+Inf\"} " << s.count << "\n";
+                        out << name << "_count" << braces(key) << " " << s.count << "\n";
+                        out << name << "_sum" << braces(key) << " " << number(value) << "\n";
+                        break;
+                    }
+                }
+            }
+        }
+        out << "# EOF\n";
+        return out.str();
+    }
+
+private:
+    struct Series {
+        double value = 0;
+        uint64_t count = 0;
+        std::vector<uint64_t> buckets;
+        std::function<double()> callback;
+        uint64_t callbackId = 0;
+    };
+
+    struct Family {
+        Type type;
+        std::string help;
+        std::map<std::string, Series> series;
+    };
+
+    static std::string escape(const std::string& v) {
+        std::string out;
+        for (char c : v) {
+            if (c == '\\' || c == '"') out += '\\';
+            if (c == '\n') {
+                out += "\\n";
+                continue;
+            }
+            out += c;
+        }
+        return out;
+    }
+
+    static std::string key(const Labels& labels) {
+        std::string out;
+        for (const auto& [k, v] : labels) {
+            if (!out.empty()) out += ",";
+            out += k + "=\"" + escape(v) + "\"";
+        }
+        return out;
+    }
+
+    // Integers exactly (byte counts), everything else to ten significant digits
+    static std::string number(double v) {
+        char buf[32];
+        if (std::fabs(v) < 9007199254740992.0 && v == std::floor(v)) {
+            std::snprintf(buf, sizeof(buf), "%.0f", v);
+        } else {
+            std::snprintf(buf, sizeof(buf), "%.10g", v);
+        }
+        return buf;
+    }
+
+    static std::string braces(const std::string& key) { return key.empty() ? "" : "{" + key + "}"; }
+
+    Series& series(const std::string& name, const std::string& help, Type type, const Labels& labels) {
+        auto it = families_.find(name);
+        if (it == families_.end()) it = families_.emplace(name, Family{type, help, {}}).first;
+        return it->second.series[key(labels)];
+    }
+
+    std::mutex mutex_;
+    std::map<std::string, Family> families_;
+    uint64_t nextCallback_ = 0;
+};
+
+inline void add(const std::string& name, const std::string& help, const Labels& labels, double v = 1) {
+    Registry::get().add(name, help, labels, v);
+}
+
+inline void set(const std::string& name, const std::string& help, const Labels& labels, double v) {
+    Registry::get().set(name, help, labels, v);
+}
+
+inline void observe(const std::string& name, const std::string& help, const Labels& labels, double v) {
+    Registry::get().observe(name, help, labels, v);
+}
+
+inline bool endsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Record one run (or job) of a phase from the columns of its timing CSV row:
+// step durations become histograms, memory figures gauges and counters.
+inline void recordPhase(const std::string& phase, const std::vector<std::pair<std::string, double>>& columns) {
+    const double MB = 1024.0 * 1024.0;
+    add("fhe_runs", "Completed runs of the phase", {{"phase", phase}});
+    for (const auto& [column, v] : columns) {
+        if (endsWith(column, "_time")) {
+            observe("fhe_step_duration_seconds", "Duration of each timed step of a phase",
+                    {{"phase", phase}, {"step", column.substr(0, column.size() - 5)}}, v);
+        } else if (column == "peak_rss_mb") {
+            set("fhe_peak_rss_bytes", "Resident set high-water mark of the last run", {{"phase", phase}}, v * MB);
+        } else if (column == "peak_heap_mb") {
+            set("fhe_peak_heap_bytes", "Most heap bytes live at once in the last run", {{"phase", phase}}, v * MB);
+        } else if (column == "alloc_count") {
+            add("fhe_allocations", "Heap allocations", {{"phase", phase}}, v);
+        } else if (column == "alloc_mb") {
+            add("fhe_allocated_bytes", "Heap bytes allocated", {{"phase", phase}}, v * MB);
+        } else if (column == "minor_faults" || column == "major_faults") {
+            add("fhe_page_faults", "Page faults", {{"phase", phase}, {"kind", column.substr(0, 5)}}, v);
+        } else if (endsWith(column, "_peak_rss_mb")) {
+            set("fhe_step_peak_rss_bytes", "Resident set high-water mark of each step in the last run",
+                {{"phase", phase}, {"step", column.substr(0, column.size() - 12)}}, v * MB);
+        } else if (endsWith(column, "_peak_heap_mb")) {
+            set("fhe_step_peak_heap_bytes", "Most heap bytes live at once during each step in the last run",
+                {{"phase", phase}, {"step", column.substr(0, column.size() - 13)}}, v * MB);
+        }
+    }
+}
+
+// A value read from `fn` at every scrape, for as long as this object lives.
+// Declare it after the object `fn` reads from.
+class Callback {
+public:
+    Callback(const std::string& name, const std::string& help, Type type, const Labels& labels,
+             std::function<double()> fn)
+        : id_(Registry::get().addCallback(name, help, type, labels, std::move(fn))) {}
+    ~Callback() { Registry::get().removeCallback(id_); }
+
+    Callback(const Callback&) = delete;
+    Callback& operator=(const Callback&) = delete;
+
+private:
+    uint64_t id_;
+};
+
+// Live figures of a running phase, read at every scrape: the artifact I/O
+// queue and byte counts of `io`, and the bytes live on the heap.
+template <typename IO>
+class RunMetrics {
+public:
+    RunMetrics(const std::string& phase, IO& io, const std::atomic<uint64_t>& liveHeap)
+        : queue_("fhe_io_queue_depth", "Artifact reads and writes in flight", Type::Gauge, {{"phase", phase}},
+                 [&io] { return static_cast<double>(io.queueDepth()); }),
+          written_("fhe_io_written_bytes", "Artifact bytes written", Type::Counter, {{"phase", phase}},
+                   [&io] { return static_cast<double>(io.bytesWritten()); }),
+          read_("fhe_io_read_bytes", "Artifact bytes read", Type::Counter, {{"phase", phase}},
+                [&io] { return static_cast<double>(io.bytesRead()); }),
+          heap_("fhe_heap_live_bytes", "Heap bytes live now", Type::Gauge, {{"phase", phase}},
+                [&liveHeap] { return static_cast<double>(liveHeap.load(std::memory_order_relaxed)); }) {}
+
+private:
+    Callback queue_, written_, read_, heap_;
+};
+
+// Serves the registry over HTTP and writes the textfile, per the environment.
+class Exporter {
+public:
+    explicit Exporter(std::string phase) : phase_(std::move(phase)) {
+        if (const char* dir = std::getenv("FHE_METRICS_DIR")) {
+            if (dir[0] != '\0') file_ = std::string(dir) + "/fhe_" + phase_ + ".prom";
+        }
+        if (const char* port = std::getenv("FHE_METRICS_PORT")) {
+            const char* addr = std::getenv("FHE_METRICS_ADDR");
+            listen(addr ? addr : "127.0.0.1", std::atoi(port));
+        }
+    }
+
+    ~Exporter() {
+        flush();
+        if (listenFd_ >= 0) {
+            stopping_ = true;
+            server_.join();
+            ::close(listenFd_);
+        }
+    }
+
+    Exporter(const Exporter&) = delete;
+    Exporter& operator=(const Exporter&) = delete;
+
+    // Rewrite the textfile with the current values
+    void flush() {
+        if (file_.empty()) return;
+        std::string tmp = file_ + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::trunc);
+            if (!out.is_open()) {
+                std::cerr << "Error: Could not open metrics file for writing: " << tmp << std::endl;
+                return;
+            }
+            out << Registry::get().render();
+        }
+        // The collector must never see a half-written file
+        if (std::rename(tmp.c_str(), file_.c_str()) != 0) {
+            std::cerr << "Error: Could not publish metrics file " << file_ << std::endl;
+        }
+    }
+
+private:
+    void listen(const std::string& addr, int port) {
+        sockaddr_in sa;
+        std::memset(&sa, 0, sizeof(sa));
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons(static_cast<uint16_t>(port));
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int one = 1;
+        if (fd < 0 || port <= 0 || ::inet_pton(AF_INET, addr.c_str(), &sa.sin_addr) != 1 ||
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+            ::bind(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) != 0 || ::listen(fd, 8) != 0) {
+            std::cerr << "Warning: cannot serve metrics on " << addr << ":" << port << ": "
+                      << std::strerror(errno) << std::endl;
+            if (fd >= 0) ::close(fd);
+            return;
+        }
+        listenFd_ = fd;
+        server_ = std::thread([this] { serve(); });
+        std::cout << "Serving metrics on http://" << addr << ":" << port << "/metrics" << std::endl;
+    }
+
+    void serve() {
+        while (!stopping_) {
+            pollfd p{listenFd_, POLLIN, 0};
+            if (::poll(&p, 1, 200) <= 0) continue;
+            int client = ::accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0) continue;
+            timeval timeout{1, 0};
+            ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            respond(client);
+            ::close(client);
+        }
+    }
+
+    static void respond(int client) {
+        std::string request;
+        char buf[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+            ssize_t n = ::recv(client, buf, sizeof(buf), 0);
+            if (n <= 0) break;
+            request.append(buf, static_cast<size_t>(n));
+        }
+        bool found = request.rfind("GET /metrics ", 0) == 0 || request.rfind("GET /metrics?", 0) == 0;
+        std::string body = found ? Registry::get().render() : "not found\n";
+        std::ostringstream head;
+        head << "HTTP/1.1 " << (found ? "200 OK" : "404 Not Found") << "\r\n"
+             << "Content-Type: "
+             << (found ? "application/openmetrics-text; version=1.0.0; charset=utf-8" : "text/plain") << "\r\n"
+             << "Content-Length: " << body.size() << "\r\n"
+             << "Connection: close\r\n\r\n";
+        std::string response = head.str() + body;
+        size_t off = 0;
+        while (off < response.size()) {
+            ssize_t n = ::send(client, response.data() + off, response.size() - off, MSG_NOSIGNAL);
+            if (n <= 0) break;
+            off += static_cast<size_t>(n);
+        }
+    }
+
+    std::string phase_;
+    std::string file_;
+    int listenFd_ = -1;
+    std::atomic<bool> stopping_{false};
+    std::thread server_;
+};
+
+} // namespace metrics
+
+#endif // FHE_METRICS_H
@@ -0,0 +1,114 @@
+//PARAMETER GRID OF THE TEST CONFIGURATIONS
+//
+// The (depth, modulus, security) triples of a tests.csv, and the BGV
+// cryptocontext each one describes, for the drivers that sweep the grid in
+// one process (fhe-bench, fhe-sweep).
+
+#ifndef FHE_PARAM_GRID_H
+#define FHE_PARAM_GRID_H
+
+#include "openfhe.h"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+struct GridParams {
+    int depth;
+    int modulus;
+    int security;
+
+    std::string suffix() const {
+        return "/d" + std::to_string(depth) + "/m" + std::to_string(modulus) + "/s" + std::to_string(security);
+    }
+    bool operator<(const GridParams& o) const {
+        return std::tie(depth, modulus, security) < std::tie(o.depth, o.modulus, o.security);
+    }
+    bool operator==(const GridParams& o) const {
+        return std::tie(depth, modulus, security) == std::tie(o.depth, o.modulus, o.security);
+    }
+};
+
+// Split one CSV line, honouring double quotes (tests.csv quotes some cells)
+inline std::vector<std::string> splitCsvLine(const std::string& line) {
+    std::vector<std::string> cells(1);
+    bool quoted = false;
+    for (char c : line) {
+        if (c == '"') {
+            quoted = !quoted;
+        } else if (c == ',' && !quoted) {
+            cells.emplace_back();
+        } else if (c != '\r') {
+            cells.back().push_back(c);
+        }
+    }
+    return cells;
+}
+
+// Distinct parameter triples of a tests.csv, in file order. The variants order
+// their columns differently, so the columns are found by name.
+inline std::vector<GridParams> loadGrid(const std::string& gridFile) {
+    std::ifstream in(gridFile);
+    std::string line;
+    if (!in.is_open() || !std::getline(in, line)) {
+        std::cerr << "Warning: Could not read " << gridFile << ", using depth=1 modulus=65537 security=128" << std::endl;
+        return {{1, 65537, 128}};
+    }
+    if (line.compare(0, 3, "\xEF\xBB\xBF") == 0) line.erase(0, 3);
+
+    std::vector<std::string> header = splitCsvLine(line);
+    int depthCol = -1, modulusCol = -1, securityCol = -1;
+    for (size_t i = 0; i < header.size(); i++) {
+        if (header[i] == "depth") depthCol = static_cast<int>(i);
+        if (header[i] == "modulus") modulusCol = static_cast<int>(i);
+        if (header[i] == "security") securityCol = static_cast<int>(i);
+    }
+    if (depthCol < 0 || modulusCol < 0 || securityCol < 0) {
+        std::cerr << "Error: " << gridFile << " needs depth, modulus and security columns" << std::endl;
+        return {};
+    }
+
+    std::set<GridParams> seen;
+    std::vector<GridParams> grid;
+    while (std::getline(in, line)) {
+        std::vector<std::string> row = splitCsvLine(line);
+        if (static_cast<int>(row.size()) <= std::max({depthCol, modulusCol, securityCol})) continue;
+        try {
+            // A modulus cell may list several moduli; the first one is used
+            GridParams p{std::stoi(row[depthCol]), std::stoi(row[modulusCol]), std::stoi(row[securityCol])};
+            if (seen.insert(p).second) grid.push_back(p);
+        } catch (const std::exception&) {
+            continue;
+        }
+    }
+    return grid;
+}
+
+inline lbcrypto::SecurityLevel securityLevel(int security) {
+    switch (security) {
+        case 192: return lbcrypto::HEStd_192_classic;
+        case 256: return lbcrypto::HEStd_256_classic;
+        default:  return lbcrypto::HEStd_128_classic;
+    }
+}
+
+// The cryptocontext fhe-enc generates for these parameters
+inline lbcrypto::CryptoContext<lbcrypto::DCRTPoly> generateContext(const GridParams& p) {
+    lbcrypto::CCParams<lbcrypto::CryptoContextBGVRNS> parameters;
+    parameters.SetMultiplicativeDepth(p.depth);
+    parameters.SetPlaintextModulus(p.modulus);
+    parameters.SetSecurityLevel(securityLevel(p.security));
+
+    lbcrypto::CryptoContext<lbcrypto::DCRTPoly> cc = lbcrypto::GenCryptoContext(parameters);
+    cc->Enable(lbcrypto::PKE);
+    cc->Enable(lbcrypto::KEYSWITCH);
+    cc->Enable(lbcrypto::LEVELEDSHE);
+    return cc;
+}
+
+#endif // FHE_PARAM_GRID_H
@@ -0,0 +1,142 @@
+//CACHE OF DESERIALIZED TENANT CONTEXTS AND EVAL KEYS
+//
+// fhe-main serving many tenants keeps each tenant's cryptocontext and eval
+// mult keys deserialized between jobs, so a tenant pays for deserialization
+// once and not once per request. A tenant is identified by a fingerprint of
+// its artifacts: the store hashes of its cryptocontext and key-eval-mult
+// objects. Entries are charged the memory they take (measured by the caller)
+// and evicted least recently used first once the cache holds more than its
+// budget; the entry just inserted is never evicted, even if it alone exceeds
+// the budget.
+//
+// OpenFHE keeps eval keys in one process-wide map keyed by the tag of the
+// secret key they belong to, so a job's ciphertexts find their tenant's keys
+// by themselves; eviction erases the tenant's tags from that map. Contexts
+// are also registered process-wide, with no way to drop just one: evicting
+// releases the whole list and registers the surviving tenants' contexts again,
+// so ciphertexts deserialized later still attach to the cached objects.
+//
+// Only the thread running the jobs touches the entries; the counters are
+// atomics, so the metrics exporter can read them from its own thread.
+
+#ifndef FHE_TENANT_CACHE_H
+#define FHE_TENANT_CACHE_H
+
+#include "openfhe.h"
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+class TenantCache {
+public:
+    struct Tenant {
+        lbcrypto::CryptoContext<lbcrypto::DCRTPoly> cc;
+        std::vector<std::string> keyTags;  // eval mult key tags this tenant added
+        uint64_t bytes = 0;
+    };
+
+    explicit TenantCache(uint64_t budgetBytes) : budget_(budgetBytes) {}
+
+    static std::string fingerprint(const std::string& contextHash, const std::string& evalKeyHash) {
+        return contextHash + ":" + evalKeyHash;
+    }
+
+    // OpenFHE's process-wide eval key map has no lock of its own. fhe-main
+    // deserializes keys into it on a thread of its own, so every access from
+    // outside the circuit (which only relinearizes once the keys are in) holds
+    // this mutex.
+    static std::mutex& keyMapMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    // Eval mult key tags currently loaded; diff before and after deserializing
+    // a key file to learn which tags it brought
+    static std::set<std::string> loadedKeyTags() {
+        std::lock_guard<std::mutex> lock(keyMapMutex());
+        std::set<std::string> tags;
+        for (const auto& entry : lbcrypto::CryptoContextImpl<lbcrypto::DCRTPoly>::GetAllEvalMultKeys()) {
+            tags.insert(entry.first);
+        }
+        return tags;
+    }
+
+    // The tenant's entry, made most recently used, or nullptr (counted as a miss)
+    Tenant* lookup(const std::string& fp) {
+        auto it = index_.find(fp);
+        if (it == index_.end()) {
+            misses_++;
+            return nullptr;
+        }
+        hits_++;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return &it->second->second;
+    }
+
+    // Add a freshly deserialized tenant, evicting the least recently used
+    // others until the cache fits its budget again
+    Tenant& insert(const std::string& fp, Tenant tenant) {
+        used_ += tenant.bytes;
+        lru_.emplace_front(fp, std::move(tenant));
+        index_[fp] = lru_.begin();
+        count_++;
+
+        bool evicted = false;
+        while (used_ > budget_ && lru_.size() > 1) {
+            auto& [victimFp, victim] = lru_.back();
+            {
+                std::lock_guard<std::mutex> lock(keyMapMutex());
+                for (const std::string& tag : victim.keyTags) {
+                    lbcrypto::CryptoContextImpl<lbcrypto::DCRTPoly>::ClearEvalMultKeys(tag);
+                }
+            }
+            used_ -= victim.bytes;
+            index_.erase(victimFp);
+            lru_.pop_back();
+            count_--;
+            evictions_++;
+            evicted = true;
+        }
+        if (evicted) {
+            lbcrypto::CryptoContextFactory<lbcrypto::DCRTPoly>::ReleaseAllContexts();
+            for (auto& entry : lru_) {
+                entry.second.cc =
+                    lbcrypto::CryptoContextFactory<lbcrypto::DCRTPoly>::GetFullContextByDeserializedContext(entry.second.cc);
+            }
+        }
+        return lru_.front().second;
+    }
+
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+    uint64_t evictions() const { return evictions_; }
+    uint64_t bytes() const { return used_; }
+    uint64_t budget() const { return budget_; }
+    size_t size() const { return count_; }
+
+    double hitRate() const {
+        uint64_t lookups = hits_ + misses_;
+        return lookups ? static_cast<double>(hits_) / lookups : 0;
+    }
+
+private:
+    using Entry = std::pair<std::string, Tenant>;
+
+    uint64_t budget_;
+    std::atomic<uint64_t> used_{0};
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> evictions_{0};
+    std::atomic<size_t> count_{0};
+    std::list<Entry> lru_;
+    std::map<std::string, std::list<Entry>::iterator> index_;
+};
+
+#endif // FHE_TENANT_CACHE_H
@@ -0,0 +1,213 @@
+#!/usr/bin/env python3
+"""Performance regression gate for the FHE pipeline.
+
+After a tests.py run, record its timings and artifact sizes as a baseline:
+
+    python3 regress.py save [--baseline regress_baseline.json]
+
+and compare a later run (new OpenFHE, new build flags, ...) against it:
+
+    python3 regress.py check [--baseline regress_baseline.json] [--alpha 0.05] [--threshold 0.05]
+
+Every *_time column of enc/main/dec_timing_results.csv is compared per
+(depth, modulus, security) with a one-sided Mann-Whitney U test on the
+individual runs. A step counts as regressed when the new runs are slower with
+p < alpha and the median grew by more than the threshold; an artifact counts
+as regressed when it grew by more than --size-threshold. check exits with
+status 1 if anything regressed, 2 if the inputs are missing.
+"""
+
+import argparse
+import csv
+import json
+import math
+import os
+import statistics
+import sys
+from datetime import datetime
+
+PHASES = ("enc", "main", "dec")
+SIZE_COLUMNS = ("public_key_size_bytes", "eval_key_size_bytes", "enc1_size_bytes", "enc2_size_bytes")
+DEFAULT_BASELINE = "regress_baseline.json"
+
+
+def config_key(row):
+    return f"{row['depth']}_{row['modulus']}_{row['security']}"
+
+
+def read_results(results_dir):
+    """Per configuration: the runs of every phase step and the artifact sizes"""
+    configs = {}
+    for phase in PHASES:
+        path = os.path.join(results_dir, f"{phase}_timing_results.csv")
+        if not os.path.exists(path):
+            continue
+        with open(path, "r") as f:
+            for row in csv.DictReader(f):
+                entry = configs.setdefault(config_key(row), {"times": {}, "sizes": {}})
+                for column, value in row.items():
+                    if not column or not column.endswith("_time") or value in ("", None):
+                        continue
+                    try:
+                        entry["times"].setdefault(f"{phase}_{column}", []).append(float(value))
+                    except ValueError:
+                        continue
+
+    path = os.path.join(results_dir, "test_summary.csv")
+    if os.path.exists(path):
+        with open(path, "r") as f:
+            for row in csv.DictReader(f):
+                entry = configs.setdefault(config_key(row), {"times": {}, "sizes": {}})
+                for column in SIZE_COLUMNS:
+                    size = int(float(row.get(column) or 0))
+                    # Sizes are 0 when the artifacts lived in the store
+                    if size > 0:
+                        entry["sizes"][column] = size
+    return configs
+
+
+def mann_whitney_greater(new, base):
+    """One-sided p-value of 'new tends to be larger than base'.
+
+    Exact permutation distribution for small samples without ties, normal
+    approximation with tie and continuity correction otherwise.
+    """
+    n1, n2 = len(new), len(base)
+    ranked = sorted([(v, 0) for v in new] + [(v, 1) for v in base])
+    ranks = [0.0] * len(ranked)
+    ties = []
+    i = 0
+    while i < len(ranked):
+        j = i
+        while j + 1 < len(ranked) and ranked[j + 1][0] == ranked[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2 + 1
+        ties.append(j - i + 1)
+        i = j + 1
+    r1 = sum(r for r, (_, group) in zip(ranks, ranked) if group == 0)
+    u = r1 - n1 * (n1 + 1) / 2
+
+    if n1 * n2 <= 400 and all(t == 1 for t in ties):
+        # counts[k] = number of ways n1 of the n1+n2 ranks give U = k
+        counts = [[[0] * (a * b + 1) for b in range(n2 + 1)] for a in range(n1 + 1)]
+        for a in range(n1 + 1):
+            for b in range(n2 + 1):
+                if a == 0 or b == 0:
+                    counts[a][b][0] = 1
+                    continue
+                for k in range(a * b + 1):
+                    # the largest value is either one of the a (adds b to U) or one of the b
+                    with_a = counts[a - 1][b][k - b] if k >= b else 0
+                    with_b = counts[a][b - 1][k] if k <= a * (b - 1) else 0
+                    counts[a][b][k] = with_a + with_b
+        dist = counts[n1][n2]
+        return sum(dist[int(u):]) / sum(dist)
+
+    mean = n1 * n2 / 2
+    n = n1 + n2
+    variance = n1 * n2 / 12 * ((n + 1) - sum(t ** 3 - t for t in ties) / (n * (n - 1)))
+    if variance <= 0:
+        return 1.0
+    z = (u - mean - 0.5) / math.sqrt(variance)
+    return 0.5 * math.erfc(z / math.sqrt(2))
+
+
+def save_baseline(args):
+    configs = read_results(args.results)
+    if not any(entry["times"] for entry in configs.values()):
+        print(f"Error: no timing results found in {args.results}")
+        return 2
+    baseline = {
+        "created": datetime.now().isoformat(timespec="seconds"),
+        "label": args.label,
+        "configs": configs,
+    }
+    with open(args.baseline, "w") as f:
+        json.dump(baseline, f, indent=1, sort_keys=True)
+    runs = sum(len(v) for entry in configs.values() for v in entry["times"].values())
+    print(f"Baseline of {len(configs)} configurations ({runs} step timings) saved to {args.baseline}")
+    return 0
+
+
+def check_baseline(args):
+    if not os.path.exists(args.baseline):
+        print(f"Error: baseline {args.baseline} not found, record one with 'regress.py save'")
+        return 2
+    with open(args.baseline, "r") as f:
+        baseline = json.load(f)
+    current = read_results(args.results)
+    if not any(entry["times"] for entry in current.values()):
+        print(f"Error: no timing results found in {args.results}")
+        return 2
+
+    rows = []
+    regressions = []
+    for key in sorted(current, key=lambda k: [int(p) for p in k.split("_")]):
+        base = baseline["configs"].get(key)
+        if base is None:
+            continue
+        for metric, new_runs in sorted(current[key]["times"].items()):
+            base_runs = base["times"].get(metric)
+            if not base_runs:
+                continue
+            base_median = statistics.median(base_runs)
+            new_median = statistics.median(new_runs)
+            change = new_median / base_median - 1 if base_median > 0 else 0.0
+            p = mann_whitney_greater(new_runs, base_runs)
+            regressed = p < args.alpha and change > args.threshold
+            rows.append((key, metric, base_median, new_median, change, p, regressed))
+            if regressed:
+                regressions.append(f"{key} {metric}: {base_median:.6f}s -> {new_median:.6f}s "
+                                   f"(+{100 * change:.1f}%, p={p:.4f})")
+        for column, new_size in sorted(current[key]["sizes"].items()):
+            base_size = base["sizes"].get(column)
+            if not base_size:
+                continue
+            change = new_size / base_size - 1
+            if change > args.size_threshold:
+                regressions.append(f"{key} {column}: {base_size} -> {new_size} bytes (+{100 * change:.1f}%)")
+
+    if not rows:
+        print("Error: no configuration of this run is in the baseline")
+        return 2
+
+    label = f" ({baseline['label']})" if baseline.get("label") else ""
+    print(f"Comparing against {args.baseline} from {baseline.get('created', '?')}{label}")
+    print(f"{'config':<18} {'metric':<24} {'baseline':>12} {'current':>12} {'change':>8} {'p':>8}")
+    for key, metric, base_median, new_median, change, p, regressed in rows:
+        if args.verbose or regressed or metric.endswith("_total_time"):
+            flag = "  REGRESSED" if regressed else ""
+            print(f"{key:<18} {metric:<24} {base_median:>12.6f} {new_median:>12.6f} "
+                  f"{100 * change:>+7.1f}% {p:>8.4f}{flag}")
+
+    if regressions:
+        print(f"\n{len(regressions)} regression(s) against the baseline:")
+        for line in regressions:
+            print(f"  {line}")
+        return 1
+    print("\nNo significant regressions")
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare FHE timing results against a stored baseline")
+    parser.add_argument("command", choices=["save", "check"])
+    parser.add_argument("--baseline", default=DEFAULT_BASELINE, help="baseline file (default: %(default)s)")
+    parser.add_argument("--results", default=".", help="directory with the *_timing_results.csv and test_summary.csv")
+    parser.add_argument("--label", default="", help="note stored with a saved baseline, e.g. the OpenFHE version")
+    parser.add_argument("--alpha", type=float, default=0.05, help="significance level (default: %(default)s)")
+    parser.add_argument("--threshold", type=float, default=0.05,
+                        help="smallest median slowdown that fails the check (default: %(default)s)")
+    parser.add_argument("--size-threshold", type=float, default=0.0,
+                        help="largest tolerated artifact growth (default: %(default)s)")
+    parser.add_argument("--verbose", action="store_true", help="print every step, not only the phase totals")
+    args = parser.parse_args()
+
+    if args.command == "save":
+        return save_baseline(args)
+    return check_baseline(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())